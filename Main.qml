@@ -25,6 +25,55 @@ Window {
         }
     }
 
+    // Двоичный файл сцены (Ctrl+S / Ctrl+O)
+    FileDialog {
+        id: saveSceneDialog
+        title: "Сохранить сцену"
+        fileMode: FileDialog.SaveFile
+        defaultSuffix: "pssc"
+        nameFilters: ["Сцены (*.pssc)", "Все файлы (*)"]
+
+        onAccepted: canvas.saveScene(selectedFile)
+    }
+
+    FileDialog {
+        id: openSceneDialog
+        title: "Открыть сцену"
+        fileMode: FileDialog.OpenFile
+        nameFilters: ["Сцены (*.pssc)", "Все файлы (*)"]
+
+        onAccepted: canvas.loadScene(selectedFile)
+    }
+
+    FileDialog {
+        id: exportSvgDialog
+        title: "Экспорт в SVG"
+        fileMode: FileDialog.SaveFile
+        defaultSuffix: "svg"
+        nameFilters: ["SVG (*.svg)"]
+
+        onAccepted: canvas.exportSvg(selectedFile)
+    }
+
+    FileDialog {
+        id: exportImageDialog
+        title: "Экспорт в PNG"
+        fileMode: FileDialog.SaveFile
+        defaultSuffix: "png"
+        nameFilters: ["PNG (*.png)"]
+
+        onAccepted: canvas.exportImage(selectedFile)
+    }
+
+    FileDialog {
+        id: importDialog
+        title: "Импорт фигур"
+        fileMode: FileDialog.OpenFile
+        nameFilters: ["SVG и JSON (*.svg *.json)", "Все файлы (*)"]
+
+        onAccepted: canvas.importShapes(selectedFile)
+    }
+
     // Стилизованный компонент кнопки
     Component {
         id: styledButton
@@ -822,6 +871,10 @@ Window {
                 id: canvas
                 anchors.fill: parent
                 clip: true
+                threadedSimulation: true
+                autosave: true
+                // Большие сцены рисуются из растровых плиток
+                tiledRendering: shapeCount >= 20000
 
                 onSelectedShapeIdChanged: {
                     updateShapeInfo();
@@ -858,6 +911,140 @@ Window {
                     }
                 }
             }
+
+            Shortcut {
+                sequence: StandardKey.Undo
+                onActivated: canvas.undo()
+            }
+
+            Shortcut {
+                sequences: [StandardKey.Redo, "Ctrl+Shift+Z"]
+                onActivated: canvas.redo()
+            }
+
+            Shortcut {
+                sequence: StandardKey.Save
+                onActivated: saveSceneDialog.open()
+            }
+
+            Shortcut {
+                sequence: StandardKey.Open
+                onActivated: openSceneDialog.open()
+            }
+
+            Shortcut {
+                sequence: "Ctrl+E"
+                onActivated: exportSvgDialog.open()
+            }
+
+            Shortcut {
+                sequence: "Ctrl+Shift+E"
+                onActivated: exportImageDialog.open()
+            }
+
+            Shortcut {
+                sequence: "Ctrl+I"
+                onActivated: importDialog.open()
+            }
+
+            Shortcut {
+                sequence: "F3"
+                onActivated: canvas.profilerOverlay = !canvas.profilerOverlay
+            }
+
+            // Трасса Chrome/Perfetto: первое нажатие запускает запись,
+            // второе сохраняет файл в текущий каталог
+            Shortcut {
+                sequence: "F4"
+                onActivated: canvas.tracing ? canvas.stopTrace() : canvas.startTrace()
+            }
+
+            // Оверлей профилирования (F3): время кадра, стадии, счётчики
+            Rectangle {
+                id: profilerOverlay
+                visible: canvas.profilerOverlay
+                anchors.top: parent.top
+                anchors.left: parent.left
+                anchors.margins: 10
+                width: 300
+                height: profilerColumn.height + 16
+                radius: 4
+                color: "#cc1e1e1e"
+                border.color: "#404040"
+
+                property var stats: canvas.profileStats
+
+                Column {
+                    id: profilerColumn
+                    x: 8
+                    y: 8
+                    width: parent.width - 16
+                    spacing: 4
+
+                    Text {
+                        text: profilerOverlay.stats.frameMs !== undefined
+                              ? "Кадр: " + profilerOverlay.stats.frameMs.toFixed(2) + " мс (" + profilerOverlay.stats.fps.toFixed(0) + " FPS)"
+                              : "Кадр: —"
+                        color: "white"
+                        font.pixelSize: 12
+                        font.bold: true
+                    }
+
+                    Repeater {
+                        model: profilerOverlay.stats.stages || []
+
+                        Row {
+                            width: profilerColumn.width
+                            height: 16
+                            spacing: 6
+
+                            property var histogram: modelData.histogram
+                            property int histogramMax: Math.max.apply(null, histogram.concat([1]))
+
+                            Text {
+                                width: 150
+                                text: modelData.name + " " + modelData.avgMs.toFixed(2) + "/" + modelData.maxMs.toFixed(2) + " мс"
+                                color: modelData.count > 0 ? "#dddddd" : "#777777"
+                                font.pixelSize: 10
+                                anchors.verticalCenter: parent.verticalCenter
+                            }
+
+                            Row {
+                                height: 14
+                                spacing: 1
+                                anchors.verticalCenter: parent.verticalCenter
+
+                                Repeater {
+                                    model: histogram
+
+                                    Rectangle {
+                                        width: 10
+                                        height: Math.max(1, 14 * modelData / histogramMax)
+                                        anchors.bottom: parent.bottom
+                                        color: index < 4 ? "#4ec9b0" : index < 8 ? "#dcdcaa" : "#f44747"
+                                    }
+                                }
+                            }
+                        }
+                    }
+
+                    Text {
+                        property var counters: profilerOverlay.stats.counters || {}
+                        text: "На кадр: фигур " + (counters.shapesDrawn || 0).toFixed(0)
+                              + ", пар " + (counters.pairsTested || 0).toFixed(0)
+                              + ", узлов " + (counters.nodesAllocated || 0).toFixed(0)
+                              + "\nВыделений " + (counters.allocations || 0).toFixed(1)
+                              + " (" + ((counters.allocatedBytes || 0) / 1024).toFixed(1) + " КБ)"
+                              + ", арена " + ((counters.arenaBytes || 0) / 1024).toFixed(1) + " КБ"
+                              + (canvas.tiledRendering ? ", плиток " + (counters.tilesUploaded || 0).toFixed(1) : "")
+                              + (profilerOverlay.stats.dropped > 0 ? ", потеряно " + profilerOverlay.stats.dropped : "")
+                        color: "#aaaaaa"
+                        font.pixelSize: 10
+                        width: parent.width
+                        wrapMode: Text.WordWrap
+                    }
+                }
+            }
         }
 
         Rectangle {
@@ -1299,8 +1486,10 @@ Window {
                                 item.text = "Сбросить трансформацию";
                                 item.onClicked.connect(function() {
                                     if (canvas.selectedShapeId !== -1) {
+                                        canvas.beginEdit();
                                         canvas.setShapeRotation(canvas.selectedShapeId, 0);
                                         canvas.setShapeScale(canvas.selectedShapeId, 1.0);
+                                        canvas.endEdit();
                                         updateShapeInfo();
                                     }
                                 });
@@ -1316,12 +1505,14 @@ Window {
                                 item.text = "Сбросить всё";
                                 item.onClicked.connect(function() {
                                     if (canvas.selectedShapeId !== -1) {
+                                        canvas.beginEdit();
                                         canvas.setShapeRotation(canvas.selectedShapeId, 0);
                                         canvas.setShapeScale(canvas.selectedShapeId, 1.0);
                                         canvas.setShapePosition(canvas.selectedShapeId, 0, 0);
                                         canvas.setShapeSizeWidgth(canvas.selectedShapeId, 50.0);
                                         canvas.setShapeSizeHeight(canvas.selectedShapeId, 50.0);
                                         canvas.setShapeColor(canvas.selectedShapeId, "#0078d7");
+                                        canvas.endEdit();
                                         currentColor = "#0078d7";
                                         if (centerXLoader.item) centerXLoader.item.currentValue = 0;
                                         if (centerYLoader.item) centerYLoader.item.currentValue = 0;
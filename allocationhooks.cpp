@@ -0,0 +1,63 @@
+#include "framearena.h"
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+
+// Замещение malloc/calloc/realloc/aligned_alloc для AllocationCounter.
+// Исполняемый файл перекрывает эти символы и для разделяемых библиотек,
+// так что видны и operator new из libstdc++, и контейнеры Qt, и
+// QSGGeometry::allocate. Память выдаёт сама glibc через __libc_*,
+// поэтому free не замещается.
+
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+void* malloc(std::size_t size)
+{
+    AllocationCounter::record(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+    AllocationCounter::record(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, std::size_t size)
+{
+    AllocationCounter::record(size);
+    return __libc_realloc(pointer, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    AllocationCounter::record(size);
+    return __libc_memalign(alignment, size);
+}
+}
+
+#else
+
+// Без glibc перекрыть malloc переносимо нельзя, замещаются только
+// глобальные operator new/delete. Остальные формы, кроме выровненных
+// (массивы, nothrow, с размером), по стандарту реализованы через эти две.
+
+void* operator new(std::size_t size)
+{
+    AllocationCounter::record(size);
+    if (void* pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+#endif
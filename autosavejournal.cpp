@@ -0,0 +1,477 @@
+#include "autosavejournal.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include "scenefile.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 MAGIC = 0x4C4A5350; // "PSJL"
+const quint16 VERSION = 1;
+// magic, version, generation
+const qint64 HEADER_SIZE = 4 + 2 + 4;
+// Запись: размер полезной части, её CRC-16, полезная часть
+const qint64 FRAME_SIZE = 4 + 2;
+
+const char JOURNAL_NAME[] = "journal.bin";
+const char LOCK_NAME[] = "session.lock";
+
+void setError(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+}
+
+QString journalPath(const QString& directory)
+{
+    return QDir(directory).filePath(QLatin1StringView(JOURNAL_NAME));
+}
+
+QString snapshotPath(const QString& directory, quint32 generation)
+{
+    return QDir(directory).filePath(QStringLiteral("snapshot-%1.pssc").arg(generation));
+}
+
+bool readHeader(QDataStream& stream, quint32* generation)
+{
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version >> *generation;
+    return stream.status() == QDataStream::Ok && magic == MAGIC && version == VERSION;
+}
+
+// Ищет фигуру по индексу на момент записи, иначе по id
+int findShape(const QVector<Shape>& shapes, int id, int index)
+{
+    if (index >= 0 && index < shapes.size() && shapes[index].id() == id)
+        return index;
+    for (int i = 0; i < shapes.size(); ++i) {
+        if (shapes[i].id() == id)
+            return i;
+    }
+    return -1;
+}
+
+void encode(QDataStream& stream, const AutosaveJournal::Record& record)
+{
+    stream << quint8(record.type) << qint32(record.id) << qint32(record.index);
+    switch (record.type) {
+    case AutosaveJournal::Record::Transform:
+        stream << record.transform.position << record.transform.rotation << record.transform.scale;
+        break;
+    case AutosaveJournal::Record::Change:
+    case AutosaveJournal::Record::Insert:
+        stream << record.shape;
+        break;
+    case AutosaveJournal::Record::Snapshot:
+    case AutosaveJournal::Record::Remove:
+        break;
+    }
+}
+
+bool decode(QDataStream& stream, AutosaveJournal::Record* record)
+{
+    quint8 type = 0;
+    qint32 id = -1, index = -1;
+    stream >> type >> id >> index;
+    record->type = AutosaveJournal::Record::Type(type);
+    record->id = id;
+    record->index = index;
+    switch (record->type) {
+    case AutosaveJournal::Record::Transform:
+        stream >> record->transform.position >> record->transform.rotation >> record->transform.scale;
+        break;
+    case AutosaveJournal::Record::Change:
+    case AutosaveJournal::Record::Insert:
+        stream >> record->shape;
+        break;
+    case AutosaveJournal::Record::Remove:
+        break;
+    default:
+        return false;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+} // namespace
+
+AutosaveJournal::AutosaveJournal(const QString& directory, qint64 compactBytes)
+    : m_directory(directory), m_compactBytes(compactBytes),
+      m_lock(QDir(directory).filePath(QLatin1StringView(LOCK_NAME)))
+{
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+    stop();
+}
+
+bool AutosaveJournal::start(const QVector<Shape>& shapes, QString* error)
+{
+    if (m_thread)
+        return true;
+
+    if (!QDir().mkpath(m_directory)) {
+        setError(error, QStringLiteral("cannot create %1").arg(m_directory));
+        return false;
+    }
+    if (!m_lock.tryLock(0)) {
+        setError(error, QStringLiteral("%1 is used by another instance").arg(m_directory));
+        return false;
+    }
+
+    // Новое поколение больше оставшегося от прошлого сеанса: его снимок
+    // не перезаписывается, пока не готов наш
+    QFile journal(journalPath(m_directory));
+    if (journal.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&journal);
+        stream.setVersion(QDataStream::Qt_6_8);
+        quint32 generation = 0;
+        if (readHeader(stream, &generation))
+            m_generation = generation;
+    }
+
+    Record snapshot;
+    snapshot.type = Record::Snapshot;
+    snapshot.shapes = shapes;
+    m_queue.append(std::move(snapshot));
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("autosave"));
+    m_thread->start();
+    m_wake.release();
+    return true;
+}
+
+void AutosaveJournal::reset(const QVector<Shape>& shapes)
+{
+    Record record;
+    record.type = Record::Snapshot;
+    record.shapes = shapes;
+    post(std::move(record));
+}
+
+void AutosaveJournal::discard()
+{
+    stop();
+
+    QDir directory(m_directory);
+    directory.remove(QLatin1StringView(JOURNAL_NAME));
+    const QStringList snapshots = directory.entryList({ QStringLiteral("snapshot-*.pssc") }, QDir::Files);
+    for (const QString& name : snapshots)
+        directory.remove(name);
+    m_lock.unlock();
+}
+
+void AutosaveJournal::deltaRecorded(const UndoStack::Delta& delta, const Shape* after)
+{
+    Record record;
+    record.id = delta.id;
+    record.index = delta.index;
+    switch (delta.type) {
+    case UndoStack::Delta::ChangeTransform:
+        record.type = Record::Transform;
+        record.transform = delta.after;
+        break;
+    case UndoStack::Delta::ChangeShape:
+        record.type = Record::Change;
+        record.shape = *after;
+        break;
+    case UndoStack::Delta::InsertShape:
+        record.type = Record::Insert;
+        record.shape = *after;
+        break;
+    case UndoStack::Delta::RemoveShape:
+        record.type = Record::Remove;
+        break;
+    }
+    post(std::move(record));
+}
+
+// Тот же порядок и те же состояния, что в VKCanvas::applyHistory
+void AutosaveJournal::commandApplied(const UndoStack::Command& command, bool undo)
+{
+    const int count = command.deltas.size();
+    for (int step = 0; step < count; ++step) {
+        const UndoStack::Delta& delta = command.deltas[undo ? count - 1 - step : step];
+        Record record;
+        record.id = delta.id;
+        record.index = delta.index;
+        switch (delta.type) {
+        case UndoStack::Delta::ChangeTransform:
+            record.type = Record::Transform;
+            record.transform = undo ? delta.before : delta.after;
+            break;
+        case UndoStack::Delta::ChangeShape:
+            record.type = Record::Change;
+            record.shape = command.states[delta.state + (undo ? 0 : 1)];
+            break;
+        case UndoStack::Delta::InsertShape:
+        case UndoStack::Delta::RemoveShape:
+            if ((delta.type == UndoStack::Delta::InsertShape) != undo) {
+                record.type = Record::Insert;
+                record.shape = command.states[delta.state];
+            } else {
+                record.type = Record::Remove;
+            }
+            break;
+        }
+        post(std::move(record));
+    }
+}
+
+void AutosaveJournal::post(Record&& record)
+{
+    if (!m_thread)
+        return;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.append(std::move(record));
+    }
+    m_wake.release();
+}
+
+void AutosaveJournal::stop()
+{
+    if (!m_thread)
+        return;
+    m_running.store(false, std::memory_order_release);
+    m_wake.release();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_journal.reset();
+}
+
+void AutosaveJournal::run()
+{
+    QVector<Record> records;
+    QElapsedTimer sinceSync;
+    sinceSync.start();
+
+    while (true) {
+        // С несохранёнными на диск данными ждём не дольше очередного fsync
+        if (m_unsynced)
+            m_wake.tryAcquire(1, int(qMax<qint64>(0, SyncInterval - sinceSync.elapsed())));
+        else
+            m_wake.acquire();
+        m_wake.tryAcquire(m_wake.available());
+
+        // Флаг читается до разбора очереди: всё, что GUI положил до
+        // stop(), будет записано
+        const bool running = m_running.load(std::memory_order_acquire);
+        {
+            QMutexLocker locker(&m_mutex);
+            records.swap(m_queue);
+        }
+        if (!records.isEmpty()) {
+            writeRecords(records);
+            records.clear();
+        }
+
+        if (m_unsynced && (!running || sinceSync.elapsed() >= SyncInterval)) {
+            sync();
+            sinceSync.restart();
+        }
+        if (!running)
+            return;
+    }
+}
+
+bool AutosaveJournal::writeRecords(QVector<Record>& records)
+{
+    QByteArray batch;
+    QByteArray payload;
+    for (Record& record : records) {
+        if (record.type == Record::Snapshot) {
+            // Всё записанное до снимка им перекрывается
+            batch.clear();
+            m_shapes = std::move(record.shapes);
+            compact();
+            continue;
+        }
+
+        payload.clear();
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_6_8);
+        encode(stream, record);
+
+        QDataStream frame(&batch, QIODevice::WriteOnly | QIODevice::Append);
+        frame << quint32(payload.size()) << qChecksum(payload);
+        batch.append(payload);
+
+        apply(m_shapes, record);
+    }
+
+    if (!m_journal || batch.isEmpty())
+        return m_journal != nullptr;
+
+    if (m_journal->write(batch) != batch.size()) {
+        qWarning() << "Автосохранение: не удалось записать журнал" << m_journal->errorString();
+        return false;
+    }
+    m_unsynced = true;
+    m_journalBytes.store(m_journalBytes.load(std::memory_order_relaxed) + batch.size(), std::memory_order_relaxed);
+    if (journalBytes() > m_compactBytes)
+        return compact();
+    return true;
+}
+
+// Снимок пишется под новым поколением, затем журнал атомарно
+// заменяется пустым с этим поколением, и только потом удаляется
+// старый снимок: при сбое на любом шаге на диске остаётся согласованная
+// пара снимка и журнала
+bool AutosaveJournal::compact()
+{
+    const quint32 generation = m_generation + 1;
+    QString error;
+    if (!SceneFile::save(snapshotPath(m_directory, generation), m_shapes, &error)) {
+        qWarning() << "Автосохранение: не удалось записать снимок" << error;
+        return false;
+    }
+    if (!openJournal(generation))
+        return false;
+
+    QFile::remove(snapshotPath(m_directory, m_generation));
+    m_generation = generation;
+    return true;
+}
+
+bool AutosaveJournal::openJournal(quint32 generation)
+{
+    m_journal.reset();
+    m_journalBytes.store(0, std::memory_order_relaxed);
+    m_unsynced = false;
+
+    QSaveFile header(journalPath(m_directory));
+    if (header.open(QIODevice::WriteOnly)) {
+        QDataStream stream(&header);
+        stream.setVersion(QDataStream::Qt_6_8);
+        stream << MAGIC << VERSION << generation;
+    }
+    if (!header.commit()) {
+        qWarning() << "Автосохранение: не удалось создать журнал" << header.errorString();
+        return false;
+    }
+
+    auto journal = std::make_unique<QFile>(journalPath(m_directory));
+    if (!journal->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Автосохранение: не удалось открыть журнал" << journal->errorString();
+        return false;
+    }
+    m_journal = std::move(journal);
+    return true;
+}
+
+void AutosaveJournal::sync()
+{
+    m_unsynced = false;
+    if (!m_journal || !m_journal->flush())
+        return;
+#ifdef Q_OS_WIN
+    _commit(m_journal->handle());
+#else
+    ::fsync(m_journal->handle());
+#endif
+}
+
+bool AutosaveJournal::hasRecovery(const QString& directory)
+{
+    if (!QFile::exists(journalPath(directory)))
+        return false;
+
+    // Блокировка жива только у работающего процесса; оставшуюся после
+    // сбоя QLockFile считает устаревшей
+    QLockFile lock(QDir(directory).filePath(QLatin1StringView(LOCK_NAME)));
+    return lock.tryLock(0);
+}
+
+bool AutosaveJournal::recover(const QString& directory, QVector<Shape>* shapes, QString* error)
+{
+    QFile journal(journalPath(directory));
+    if (!journal.open(QIODevice::ReadOnly)) {
+        setError(error, journal.errorString());
+        return false;
+    }
+
+    QDataStream stream(&journal);
+    stream.setVersion(QDataStream::Qt_6_8);
+    quint32 generation = 0;
+    if (!readHeader(stream, &generation)) {
+        setError(error, QStringLiteral("not an autosave journal or unsupported version"));
+        return false;
+    }
+
+    SceneFile snapshot;
+    if (!snapshot.open(snapshotPath(directory, generation), error))
+        return false;
+    *shapes = snapshot.shapes();
+    snapshot.close();
+
+    // Запись, оборванная сбоем, не проходит проверку размера или CRC;
+    // она и всё после неё отбрасываются
+    qint64 position = HEADER_SIZE;
+    const qint64 size = journal.size();
+    QByteArray payload;
+    while (size - position >= FRAME_SIZE) {
+        quint32 length = 0;
+        quint16 checksum = 0;
+        stream >> length >> checksum;
+        if (stream.status() != QDataStream::Ok || length > quint64(size - position - FRAME_SIZE))
+            break;
+        payload.resize(length);
+        if (stream.readRawData(payload.data(), int(length)) != int(length) || qChecksum(payload) != checksum)
+            break;
+        position += FRAME_SIZE + length;
+
+        QDataStream recordStream(payload);
+        recordStream.setVersion(QDataStream::Qt_6_8);
+        Record record;
+        if (!decode(recordStream, &record))
+            break;
+        apply(*shapes, record);
+    }
+    return true;
+}
+
+void AutosaveJournal::apply(QVector<Shape>& shapes, Record& record)
+{
+    switch (record.type) {
+    case Record::Snapshot:
+        shapes = std::move(record.shapes);
+        break;
+    case Record::Transform: {
+        const int index = findShape(shapes, record.id, record.index);
+        if (index >= 0)
+            record.transform.applyTo(shapes[index]);
+        break;
+    }
+    case Record::Change: {
+        const int index = findShape(shapes, record.id, record.index);
+        if (index >= 0)
+            shapes[index] = record.shape;
+        break;
+    }
+    case Record::Insert:
+        shapes.insert(qBound(0, record.index, int(shapes.size())), record.shape);
+        break;
+    case Record::Remove: {
+        const int index = findShape(shapes, record.id, record.index);
+        if (index >= 0)
+            shapes.removeAt(index);
+        break;
+    }
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <QLockFile>
+#include <QMutex>
+#include <QPointF>
+#include <QSemaphore>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "shape.h"
+#include "undostack.h"
+
+class QFile;
+class QThread;
+
+// Журнал автосохранения. Получает изменения сцены теми же дельтами,
+// что и история правок (UndoStack::Observer), а не из сигналов
+// shapeUpdated: те несут только id. Все правки холста проходят через
+// UndoStack, кроме эха сеттеров во время отмены и повтора — его холст
+// передаёт в deltaRecorded() сам. Записи дописываются в файл
+// в отдельном потоке; fsync выполняется пачками не чаще SyncInterval.
+// Поток держит собственную копию сцены, применяя к ней те же записи,
+// и, когда журнал вырастает больше compactBytes, сам пишет полный
+// снимок (SceneFile) и начинает журнал заново. Поток GUI только кладёт
+// записи в очередь: автосохранение не блокирует ввод при любом размере
+// документа.
+//
+// Каталог: snapshot-<поколение>.pssc — снимок, journal.bin — заголовок
+// с поколением снимка и записи после него, session.lock — блокировка
+// сеанса. При штатном завершении discard() удаляет файлы; если они
+// остались, прошлый сеанс завершился аварийно и сцену можно
+// восстановить через recover().
+class AutosaveJournal : public UndoStack::Observer
+{
+public:
+    static constexpr qint64 DefaultCompactBytes = 16 * 1024 * 1024;
+    static constexpr int SyncInterval = 1000; // мс
+
+    struct Record
+    {
+        enum Type : quint8 {
+            Snapshot,   // заменить сцену на shapes
+            Transform,  // положение, поворот и масштаб фигуры id
+            Change,     // заменить фигуру shape
+            Insert,     // вставить shape по index
+            Remove      // удалить фигуру id
+        };
+
+        Type type = Transform;
+        int id = -1;
+        // Индекс на момент изменения; при несовпадении id фигура ищется по id
+        int index = -1;
+        UndoStack::Transform transform;
+        Shape shape;
+        QVector<Shape> shapes;
+    };
+
+    explicit AutosaveJournal(const QString& directory, qint64 compactBytes = DefaultCompactBytes);
+    ~AutosaveJournal() override;
+
+    AutosaveJournal(const AutosaveJournal&) = delete;
+    AutosaveJournal& operator=(const AutosaveJournal&) = delete;
+
+    // Захватывает каталог, пишет начальный снимок и запускает поток.
+    // false, если каталог занят другим экземпляром или недоступен.
+    bool start(const QVector<Shape>& shapes, QString* error = nullptr);
+    bool isStarted() const { return m_thread != nullptr; }
+    QString directory() const { return m_directory; }
+
+    // Документ заменён целиком (открытие файла, восстановление)
+    void reset(const QVector<Shape>& shapes);
+    // Штатное завершение: поток останавливается, файлы удаляются
+    void discard();
+
+    void deltaRecorded(const UndoStack::Delta& delta, const Shape* after) override;
+    void commandApplied(const UndoStack::Command& command, bool undo) override;
+
+    qint64 journalBytes() const { return m_journalBytes.load(std::memory_order_relaxed); }
+
+    // Остался ли в каталоге журнал незавершённого сеанса. Каталог,
+    // заблокированный работающим экземпляром, не считается.
+    static bool hasRecovery(const QString& directory);
+    // Снимок плюс записи журнала; оборванная последняя запись
+    // отбрасывается
+    static bool recover(const QString& directory, QVector<Shape>* shapes, QString* error = nullptr);
+
+    static void apply(QVector<Shape>& shapes, Record& record);
+
+private:
+    void post(Record&& record);
+    void stop();
+    void run();
+    bool writeRecords(QVector<Record>& records);
+    bool compact();
+    bool openJournal(quint32 generation);
+    void sync();
+
+    const QString m_directory;
+    const qint64 m_compactBytes;
+    QLockFile m_lock;
+
+    QMutex m_mutex;
+    QVector<Record> m_queue;
+    QSemaphore m_wake;
+    std::atomic<bool> m_running { false };
+    std::atomic<qint64> m_journalBytes { 0 };
+    QThread* m_thread = nullptr;
+
+    // Принадлежат потоку журнала
+    QVector<Shape> m_shapes;
+    std::unique_ptr<QFile> m_journal;
+    quint32 m_generation = 0;
+    bool m_unsynced = false;
+};
+
+#endif // AUTOSAVEJOURNAL_H
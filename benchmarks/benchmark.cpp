@@ -0,0 +1,176 @@
+#include "benchmark.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <cmath>
+
+namespace Benchmark {
+
+namespace {
+
+QString timeUnit(const QString& metric)
+{
+    if (metric == QLatin1String("WalltimeMilliseconds"))
+        return QStringLiteral("ms");
+    if (metric == QLatin1String("WalltimeNanoseconds"))
+        return QStringLiteral("ns");
+    return QString();
+}
+
+// Переводит XML-отчёт QtTest в JSON. Каждый <BenchmarkResult> становится
+// записью "Suite/функция/тег" со значением на одну итерацию.
+bool writeJson(const QString& xmlPath, const QString& jsonPath, const QString& suiteName)
+{
+    QFile xmlFile(xmlPath);
+    if (!xmlFile.open(QIODevice::ReadOnly))
+        return false;
+
+    QJsonArray benchmarks;
+    QString function;
+    QXmlStreamReader xml(&xmlFile);
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if (xml.name() == QLatin1String("TestFunction")) {
+            function = attributes.value(QLatin1String("name")).toString();
+        } else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            const QString tag = attributes.value(QLatin1String("tag")).toString();
+            const QString metric = attributes.value(QLatin1String("metric")).toString();
+            QString name = suiteName + QLatin1Char('/') + function;
+            if (!tag.isEmpty())
+                name += QLatin1Char('/') + tag;
+
+            QJsonObject entry;
+            entry.insert(QStringLiteral("name"), name);
+            entry.insert(QStringLiteral("run_type"), QStringLiteral("iteration"));
+            entry.insert(QStringLiteral("iterations"), attributes.value(QLatin1String("iterations")).toLongLong());
+            entry.insert(QStringLiteral("real_time"), attributes.value(QLatin1String("value")).toDouble());
+            entry.insert(QStringLiteral("metric"), metric);
+            const QString unit = timeUnit(metric);
+            if (!unit.isEmpty())
+                entry.insert(QStringLiteral("time_unit"), unit);
+            benchmarks.append(entry);
+        }
+    }
+    if (xml.hasError()) {
+        qWarning("Benchmark: cannot parse QtTest report: %s", qPrintable(xml.errorString()));
+        return false;
+    }
+
+    return writeReport(jsonPath, benchmarks);
+}
+
+} // namespace
+
+bool writeReport(const QString& path, const QJsonArray& benchmarks)
+{
+    QJsonObject context;
+    context.insert(QStringLiteral("date"), QDateTime::currentDateTime().toString(Qt::ISODate));
+    context.insert(QStringLiteral("executable"), QCoreApplication::applicationFilePath());
+    context.insert(QStringLiteral("host_name"), QSysInfo::machineHostName());
+    context.insert(QStringLiteral("cpu_architecture"), QSysInfo::currentCpuArchitecture());
+    context.insert(QStringLiteral("qt_version"), QString::fromLatin1(qVersion()));
+#ifdef QT_DEBUG
+    context.insert(QStringLiteral("library_build_type"), QStringLiteral("debug"));
+#else
+    context.insert(QStringLiteral("library_build_type"), QStringLiteral("release"));
+#endif
+
+    QJsonObject root;
+    root.insert(QStringLiteral("context"), context);
+    root.insert(QStringLiteral("benchmarks"), benchmarks);
+
+    QFile jsonFile(path);
+    if (!jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    jsonFile.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+void Samples::add(qint64 nanoseconds)
+{
+    m_values.append(nanoseconds);
+    m_sorted = false;
+}
+
+// Ближайший ранг: наименьшее значение, не меньшее доли p выборки
+double Samples::percentile(double p) const
+{
+    if (m_values.isEmpty())
+        return 0.0;
+    if (!m_sorted) {
+        std::sort(m_values.begin(), m_values.end());
+        m_sorted = true;
+    }
+    const int rank = qBound(1, int(std::ceil(p * m_values.size())), int(m_values.size()));
+    return m_values[rank - 1];
+}
+
+double Samples::mean() const
+{
+    if (m_values.isEmpty())
+        return 0.0;
+    double sum = 0.0;
+    for (qint64 value : m_values)
+        sum += value;
+    return sum / m_values.size();
+}
+
+QJsonObject Samples::toJson(const QString& name) const
+{
+    QJsonObject entry;
+    entry.insert(QStringLiteral("name"), name);
+    entry.insert(QStringLiteral("run_type"), QStringLiteral("aggregate"));
+    entry.insert(QStringLiteral("iterations"), count());
+    entry.insert(QStringLiteral("real_time"), percentile(0.5) / 1000.0);
+    entry.insert(QStringLiteral("p50"), percentile(0.5) / 1000.0);
+    entry.insert(QStringLiteral("p99"), percentile(0.99) / 1000.0);
+    entry.insert(QStringLiteral("mean"), mean() / 1000.0);
+    entry.insert(QStringLiteral("time_unit"), QStringLiteral("us"));
+    return entry;
+}
+
+int run(QObject* suite, int argc, char** argv)
+{
+    QStringList arguments;
+    QString jsonPath;
+    for (int i = 0; i < argc; ++i) {
+        const QString argument = QString::fromLocal8Bit(argv[i]);
+        if (argument == QLatin1String("--json") && i + 1 < argc)
+            jsonPath = QString::fromLocal8Bit(argv[++i]);
+        else
+            arguments.append(argument);
+    }
+
+    if (jsonPath.isEmpty())
+        return QTest::qExec(suite, arguments);
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qWarning("Benchmark: cannot create a temporary directory");
+        return 1;
+    }
+
+    const QString xmlPath = dir.filePath(QStringLiteral("report.xml"));
+    arguments << QStringLiteral("-o") << xmlPath + QStringLiteral(",xml")
+              << QStringLiteral("-o") << QStringLiteral("-,txt");
+
+    const int result = QTest::qExec(suite, arguments);
+    if (!writeJson(xmlPath, jsonPath, QString::fromLatin1(suite->metaObject()->className()))) {
+        qWarning("Benchmark: cannot write %s", qPrintable(jsonPath));
+        return result ? result : 1;
+    }
+    return result;
+}
+
+} // namespace Benchmark
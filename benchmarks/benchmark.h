@@ -0,0 +1,48 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QObject>
+#include <QVector>
+
+namespace Benchmark {
+
+// Выборка длительностей одной операции (нс) для макробенчмарков,
+// где важен хвост распределения, а не только медиана
+class Samples
+{
+public:
+    void reserve(int count) { m_values.reserve(count); }
+    void add(qint64 nanoseconds);
+    int count() const { return m_values.size(); }
+    double percentile(double p) const;
+    double mean() const;
+    // Запись для отчёта; времена в микросекундах
+    QJsonObject toJson(const QString& name) const;
+
+private:
+    mutable QVector<qint64> m_values;
+    mutable bool m_sorted = true;
+};
+
+// Пишет отчёт в формате Google Benchmark с контекстом запуска
+bool writeReport(const QString& path, const QJsonArray& benchmarks);
+
+// Запускает QtTest-набор с QBENCHMARK-замерами. Кроме обычных аргументов
+// QtTest понимает --json <файл>: результаты дополнительно пишутся в JSON
+// в формате Google Benchmark ({"context": ..., "benchmarks": [...]}).
+int run(QObject* suite, int argc, char** argv);
+
+} // namespace Benchmark
+
+#define PAINTSHAPE_BENCHMARK_MAIN(Suite) \
+    int main(int argc, char** argv) \
+    { \
+        QCoreApplication app(argc, argv); \
+        Suite suite; \
+        return Benchmark::run(&suite, argc, argv); \
+    }
+
+#endif // BENCHMARK_H
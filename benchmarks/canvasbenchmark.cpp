@@ -0,0 +1,315 @@
+#include "benchmark.h"
+#include "scenegenerator.h"
+#include "vkcanvas.h"
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QMouseEvent>
+#include <QRandomGenerator>
+#include <QSGNode>
+#include <QTextStream>
+#include <QWheelEvent>
+#include <cmath>
+
+// Макробенчмарк VKCanvas на синтетических сценах: пакетная вставка,
+// перетаскивание со столкновениями, выбор кликом, построение узлов
+// scene graph (в том числе при смене масштаба), пакетный сдвиг
+// с отменой и повтором и очистка. Ввод идёт через настоящие события
+// мыши, как в приложении. Для каждой фазы печатаются p50/p99.
+
+namespace {
+
+// Открывает updatePaintNode, чтобы строить узлы без окна и рендер-потока
+class BenchmarkCanvas : public VKCanvas
+{
+public:
+    using VKCanvas::updatePaintNode;
+};
+
+struct Settings
+{
+    QVector<int> sizes;
+    QVector<SceneGenerator::Distribution> distributions;
+    quint32 seed = 1;
+    double concaveRatio = 0.2;
+    int repetitions = 3;
+    int picks = 200;
+    int dragSteps = 200;
+    int frames = 10;
+};
+
+void sendMouse(QQuickItem* item, QEvent::Type type, const QPointF& position, Qt::MouseButtons buttons)
+{
+    QMouseEvent event(type, position, position, Qt::LeftButton, buttons, Qt::NoModifier);
+    QCoreApplication::sendEvent(item, &event);
+}
+
+void sendWheel(QQuickItem* item, const QPointF& position, int delta)
+{
+    QWheelEvent event(position, position, QPoint(), QPoint(0, delta), Qt::NoButton, Qt::NoModifier,
+                      Qt::NoScrollPhase, false);
+    QCoreApplication::sendEvent(item, &event);
+}
+
+class Scenario
+{
+public:
+    Scenario(const Settings& settings, int size, SceneGenerator::Distribution distribution)
+        : m_settings(settings), m_size(size), m_distribution(distribution)
+    {
+    }
+
+    void run()
+    {
+        SceneGenerator::Options options;
+        options.count = m_size;
+        options.seed = m_settings.seed;
+        options.distribution = m_distribution;
+        options.concaveRatio = m_settings.concaveRatio;
+        const QVector<Shape> shapes = SceneGenerator::generate(options);
+
+        for (int repetition = 0; repetition < m_settings.repetitions; ++repetition) {
+            BenchmarkCanvas canvas;
+            canvas.setSize(QSizeF(1920, 1080));
+            canvas.clear();
+
+            QElapsedTimer timer;
+            timer.start();
+            const int firstId = canvas.addShapes(shapes);
+            m_add.add(timer.nsecsElapsed());
+
+            QRandomGenerator random(m_settings.seed + repetition);
+            measurePicks(canvas, firstId, random);
+            measureDrag(canvas, firstId, random);
+            measureFrames(canvas);
+            measureHistory(canvas, firstId);
+
+            timer.restart();
+            canvas.clear();
+            m_clear.add(timer.nsecsElapsed());
+        }
+    }
+
+    void report(QTextStream& out, QJsonArray& benchmarks) const
+    {
+        const QString prefix = QStringLiteral("CanvasBenchmark/%1/shapes=%2/")
+                                   .arg(SceneGenerator::distributionName(m_distribution))
+                                   .arg(m_size);
+        const struct { const char* phase; const Benchmark::Samples& samples; } phases[] = {
+            { "add", m_add },
+            { "pick", m_pick },
+            { "drag", m_drag },
+            { "firstFrame", m_firstFrame },
+            { "frame", m_frame },
+            { "zoomFrame", m_zoomFrame },
+            { "bulkMove", m_bulkMove },
+            { "undo", m_undo },
+            { "redo", m_redo },
+            { "clear", m_clear },
+        };
+
+        for (const auto& phase : phases) {
+            const QString name = prefix + QLatin1String(phase.phase);
+            out << QStringLiteral("%1 %2 %3 %4 (n=%5)\n")
+                       .arg(name, -56)
+                       .arg(phase.samples.percentile(0.5) / 1000.0, 12, 'f', 1)
+                       .arg(phase.samples.percentile(0.99) / 1000.0, 12, 'f', 1)
+                       .arg(phase.samples.mean() / 1000.0, 12, 'f', 1)
+                       .arg(phase.samples.count());
+            benchmarks.append(phase.samples.toJson(name));
+        }
+        out.flush();
+    }
+
+private:
+    // Клик по центру случайной фигуры: выбор + снятие выделения отпусканием
+    void measurePicks(BenchmarkCanvas& canvas, int firstId, QRandomGenerator& random)
+    {
+        QElapsedTimer timer;
+        for (int i = 0; i < m_settings.picks; ++i) {
+            const int id = firstId + random.bounded(m_size);
+            const QPointF position = canvas.worldToScreen(canvas.getShapePosition(id));
+
+            timer.start();
+            sendMouse(&canvas, QEvent::MouseButtonPress, position, Qt::LeftButton);
+            m_pick.add(timer.nsecsElapsed());
+            sendMouse(&canvas, QEvent::MouseButtonRelease, position, Qt::NoButton);
+        }
+    }
+
+    // Перетаскивание одной фигуры по прямой через соседей; каждый шаг
+    // включает широкую и узкую фазы столкновений
+    void measureDrag(BenchmarkCanvas& canvas, int firstId, QRandomGenerator& random)
+    {
+        const int id = firstId + random.bounded(m_size);
+        QPointF position = canvas.worldToScreen(canvas.getShapePosition(id));
+        const double angle = random.generateDouble() * 6.283185307179586;
+        const QPointF step(std::cos(angle) * 4.0, std::sin(angle) * 4.0);
+
+        sendMouse(&canvas, QEvent::MouseButtonPress, position, Qt::LeftButton);
+        QElapsedTimer timer;
+        for (int i = 0; i < m_settings.dragSteps; ++i) {
+            position += step;
+            timer.start();
+            sendMouse(&canvas, QEvent::MouseMove, position, Qt::LeftButton);
+            m_drag.add(timer.nsecsElapsed());
+        }
+        sendMouse(&canvas, QEvent::MouseButtonRelease, position, Qt::NoButton);
+    }
+
+    void measureFrames(BenchmarkCanvas& canvas)
+    {
+        QElapsedTimer timer;
+        QSGNode* root = nullptr;
+        for (int i = 0; i < m_settings.frames; ++i) {
+            timer.start();
+            root = canvas.updatePaintNode(root, nullptr);
+            (i == 0 ? m_firstFrame : m_frame).add(timer.nsecsElapsed());
+        }
+
+        // Масштаб колесом туда и обратно: узлы фигур не перестраиваются,
+        // меняется только матрица вида
+        const QPointF center(canvas.width() / 2, canvas.height() / 2);
+        for (int i = 0; i < m_settings.frames; ++i) {
+            sendWheel(&canvas, center, i % 2 ? -120 : 120);
+            timer.start();
+            root = canvas.updatePaintNode(root, nullptr);
+            m_zoomFrame.add(timer.nsecsElapsed());
+        }
+        delete root;
+    }
+
+    // Сдвиг до 10 000 фигур одной командой; отмена и повтор должны
+    // стоить O(изменений), а не копии сцены
+    void measureHistory(BenchmarkCanvas& canvas, int firstId)
+    {
+        QList<int> ids;
+        const int count = qMin(m_size, 10000);
+        ids.reserve(count);
+        for (int i = 0; i < count; ++i)
+            ids.append(firstId + i);
+
+        QElapsedTimer timer;
+        timer.start();
+        canvas.moveShapes(ids, 25.0f, -10.0f);
+        m_bulkMove.add(timer.nsecsElapsed());
+
+        timer.restart();
+        canvas.undo();
+        m_undo.add(timer.nsecsElapsed());
+
+        timer.restart();
+        canvas.redo();
+        m_redo.add(timer.nsecsElapsed());
+    }
+
+    const Settings& m_settings;
+    const int m_size;
+    const SceneGenerator::Distribution m_distribution;
+    Benchmark::Samples m_add;
+    Benchmark::Samples m_pick;
+    Benchmark::Samples m_drag;
+    Benchmark::Samples m_firstFrame;
+    Benchmark::Samples m_frame;
+    Benchmark::Samples m_zoomFrame;
+    Benchmark::Samples m_bulkMove;
+    Benchmark::Samples m_undo;
+    Benchmark::Samples m_redo;
+    Benchmark::Samples m_clear;
+};
+
+bool parseSettings(const QCommandLineParser& parser, Settings& settings, QString& error)
+{
+    for (const QString& value : parser.value(QStringLiteral("sizes")).split(QLatin1Char(','))) {
+        bool ok = false;
+        const int size = value.toInt(&ok);
+        if (!ok || size <= 0) {
+            error = QStringLiteral("invalid scene size: %1").arg(value);
+            return false;
+        }
+        settings.sizes.append(size);
+    }
+
+    const QString distributions = parser.value(QStringLiteral("distributions"));
+    if (distributions == QLatin1String("all")) {
+        settings.distributions = { SceneGenerator::Uniform, SceneGenerator::Clustered,
+                                   SceneGenerator::Overlapping, SceneGenerator::MixedSize };
+    } else {
+        for (const QString& name : distributions.split(QLatin1Char(','))) {
+            SceneGenerator::Distribution distribution;
+            if (!SceneGenerator::distributionFromName(name, &distribution)) {
+                error = QStringLiteral("unknown distribution: %1").arg(name);
+                return false;
+            }
+            settings.distributions.append(distribution);
+        }
+    }
+
+    settings.seed = parser.value(QStringLiteral("seed")).toUInt();
+    settings.concaveRatio = qBound(0.0, parser.value(QStringLiteral("concave")).toDouble(), 1.0);
+    settings.repetitions = qMax(1, parser.value(QStringLiteral("repetitions")).toInt());
+    settings.picks = qMax(1, parser.value(QStringLiteral("picks")).toInt());
+    settings.dragSteps = qMax(1, parser.value(QStringLiteral("drag-steps")).toInt());
+    settings.frames = qMax(2, parser.value(QStringLiteral("frames")).toInt());
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("VKCanvas macro benchmark"));
+    parser.addHelpOption();
+    parser.addOptions({
+        { QStringLiteral("sizes"), QStringLiteral("Comma-separated scene sizes."), QStringLiteral("list"),
+          QStringLiteral("10000,50000,200000") },
+        { QStringLiteral("distributions"), QStringLiteral("uniform, clustered, overlapping, mixed or all."),
+          QStringLiteral("list"), QStringLiteral("all") },
+        { QStringLiteral("seed"), QStringLiteral("Scene generator seed."), QStringLiteral("n"), QStringLiteral("1") },
+        { QStringLiteral("concave"), QStringLiteral("Share of concave shapes, 0..1."), QStringLiteral("ratio"),
+          QStringLiteral("0.2") },
+        { QStringLiteral("repetitions"), QStringLiteral("Runs per scene."), QStringLiteral("n"), QStringLiteral("3") },
+        { QStringLiteral("picks"), QStringLiteral("Clicks per run."), QStringLiteral("n"), QStringLiteral("200") },
+        { QStringLiteral("drag-steps"), QStringLiteral("Mouse moves per drag."), QStringLiteral("n"),
+          QStringLiteral("200") },
+        { QStringLiteral("frames"), QStringLiteral("Paint node updates per run."), QStringLiteral("n"),
+          QStringLiteral("10") },
+        { QStringLiteral("json"), QStringLiteral("Write results to a JSON file."), QStringLiteral("file") },
+    });
+    parser.process(app);
+
+    Settings settings;
+    QString error;
+    if (!parseSettings(parser, settings, error)) {
+        qWarning("canvasbenchmark: %s", qPrintable(error));
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    out << QStringLiteral("%1 %2 %3 %4\n")
+               .arg(QStringLiteral("benchmark"), -56)
+               .arg(QStringLiteral("p50, us"), 12)
+               .arg(QStringLiteral("p99, us"), 12)
+               .arg(QStringLiteral("mean, us"), 12);
+
+    QJsonArray benchmarks;
+    for (int size : std::as_const(settings.sizes)) {
+        for (SceneGenerator::Distribution distribution : std::as_const(settings.distributions)) {
+            Scenario scenario(settings, size, distribution);
+            scenario.run();
+            scenario.report(out, benchmarks);
+        }
+    }
+
+    if (parser.isSet(QStringLiteral("json"))
+        && !Benchmark::writeReport(parser.value(QStringLiteral("json")), benchmarks)) {
+        qWarning("canvasbenchmark: cannot write %s", qPrintable(parser.value(QStringLiteral("json"))));
+        return 1;
+    }
+    return 0;
+}
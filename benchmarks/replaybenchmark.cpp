@@ -0,0 +1,115 @@
+#include "benchmark.h"
+#include "inputreplay.h"
+#include "vkcanvas.h"
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QMap>
+#include <QQuickWindow>
+#include <QTextStream>
+#include <QThread>
+
+// Воспроизводит запись ввода (PAINTSHAPE_RECORD_INPUT) и меряет время
+// обработки каждого события холстом. По умолчанию холст без окна и
+// события идут подряд; --realtime выдерживает записанные интервалы,
+// --window добавляет offscreen-окно, которое рендерит кадры между событиями.
+
+int main(int argc, char** argv)
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Input log replay benchmark"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("log"), QStringLiteral("Input log recorded by VKCanvas."));
+    parser.addOptions({
+        { QStringLiteral("repetitions"), QStringLiteral("Replays of the log."), QStringLiteral("n"), QStringLiteral("5") },
+        { QStringLiteral("realtime"), QStringLiteral("Keep the recorded pacing between events.") },
+        { QStringLiteral("window"), QStringLiteral("Show the canvas in an offscreen window and render between events.") },
+        { QStringLiteral("json"), QStringLiteral("Write results to a JSON file."), QStringLiteral("file") },
+    });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    const QString logPath = parser.positionalArguments().constFirst();
+    InputLog log;
+    QString error;
+    if (!log.load(logPath, &error)) {
+        qWarning("replaybenchmark: %s: %s", qPrintable(logPath), qPrintable(error));
+        return 1;
+    }
+
+    const int repetitions = qMax(1, parser.value(QStringLiteral("repetitions")).toInt());
+    const bool realtime = parser.isSet(QStringLiteral("realtime"));
+    const bool windowed = parser.isSet(QStringLiteral("window"));
+
+    VKCanvas canvas;
+    QScopedPointer<QQuickWindow> window;
+    if (windowed) {
+        window.reset(new QQuickWindow);
+        window->resize(log.state.size.toSize());
+        canvas.setParentItem(window->contentItem());
+        window->show();
+    }
+
+    InputReplay replay(&canvas);
+    Benchmark::Samples all;
+    QMap<quint8, Benchmark::Samples> byType;
+    all.reserve(log.events.size() * repetitions);
+
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+        replay.restore(log);
+        if (windowed)
+            QCoreApplication::processEvents();
+
+        QElapsedTimer clock;
+        clock.start();
+        for (const InputLog::Event& event : std::as_const(log.events)) {
+            if (realtime) {
+                const qint64 due = qint64(event.time) * 1000;
+                while (clock.nsecsElapsed() < due) {
+                    if (windowed)
+                        QCoreApplication::processEvents();
+                    else
+                        QThread::usleep(50);
+                }
+            }
+
+            const qint64 latency = replay.dispatch(event);
+            all.add(latency);
+            byType[event.type].add(latency);
+
+            if (windowed)
+                QCoreApplication::processEvents();
+        }
+    }
+
+    QTextStream out(stdout);
+    QJsonArray benchmarks;
+    const QString prefix = QStringLiteral("ReplayBenchmark/%1/").arg(QFileInfo(logPath).completeBaseName());
+    auto report = [&](const QString& name, const Benchmark::Samples& samples) {
+        out << QStringLiteral("%1 p50 %2 us  p99 %3 us  mean %4 us  (n=%5)\n")
+                   .arg(prefix + name, -48)
+                   .arg(samples.percentile(0.5) / 1000.0, 10, 'f', 1)
+                   .arg(samples.percentile(0.99) / 1000.0, 10, 'f', 1)
+                   .arg(samples.mean() / 1000.0, 10, 'f', 1)
+                   .arg(samples.count());
+        benchmarks.append(samples.toJson(prefix + name));
+    };
+    report(QStringLiteral("all"), all);
+    for (auto it = byType.cbegin(); it != byType.cend(); ++it)
+        report(InputLog::eventTypeName(it.key()), it.value());
+    out.flush();
+
+    if (parser.isSet(QStringLiteral("json"))
+        && !Benchmark::writeReport(parser.value(QStringLiteral("json")), benchmarks)) {
+        qWarning("replaybenchmark: cannot write %s", qPrintable(parser.value(QStringLiteral("json"))));
+        return 1;
+    }
+    return 0;
+}
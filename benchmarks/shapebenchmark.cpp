@@ -0,0 +1,515 @@
+#include "benchmark.h"
+#include "geometry.h"
+#include "rasterizer.h"
+#include "scenefile.h"
+#include "sceneimport.h"
+#include "scenesnapshot.h"
+#include "scenestore.h"
+#include "shape.h"
+#include "svgexport.h"
+#include "tilecache.h"
+#include <QSemaphore>
+#include <QTemporaryDir>
+#include <QTest>
+#include <cmath>
+
+// Микробенчмарки горячих путей геометрического ядра: трансформация,
+// столкновения, MTV и выбор точкой. Параметры: число вершин (3..20),
+// поворот и масштаб, степень перекрытия, размер сцены.
+class ShapeBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void getWorldPolygon_data();
+    void getWorldPolygon();
+    void checkCollision_data();
+    void checkCollision();
+    void findMTV_data();
+    void findMTV();
+    void findMTVFloat_data();
+    void findMTVFloat();
+    void resolveCollision_data();
+    void resolveCollision();
+    void pointInPolygon_data();
+    void pointInPolygon();
+    void updateWorldVertices_data();
+    void updateWorldVertices();
+    void hitTest_data();
+    void hitTest();
+    void openSceneFile_data();
+    void openSceneFile();
+    void loadSceneFile_data();
+    void loadSceneFile();
+    void exportSvg_data();
+    void exportSvg();
+    void importSvg_data();
+    void importSvg();
+    void importJson_data();
+    void importJson();
+    void rasterize_data();
+    void rasterize();
+    void fillTiles_data();
+    void fillTiles();
+
+private:
+    static void addVertexCountRows(bool withTransform);
+    static void addOverlapRows();
+    static void addSceneSizeRows();
+    static void addSceneFileRows();
+    static void addImportRows();
+    static Shape makeShape(int id, const QPointF& position, int sides, double rotation = 0.0, double scale = 1.0);
+    static QVector<Shape> makeGrid(int count);
+};
+
+static const int VERTEX_COUNTS[] = { 3, 4, 6, 8, 12, 16, 20 };
+static const double SHAPE_SIZE = 50.0;
+static const double GRID_STEP = 120.0;
+
+Shape ShapeBenchmark::makeShape(int id, const QPointF& position, int sides, double rotation, double scale)
+{
+    Shape shape(id, position, SHAPE_SIZE, SHAPE_SIZE);
+    shape.setSides(sides);
+    shape.updateVertices(sides, SHAPE_SIZE);
+    shape.setRotation(rotation);
+    shape.setScale(scale);
+    return shape;
+}
+
+QVector<Shape> ShapeBenchmark::makeGrid(int count)
+{
+    const int columns = qMax(1, int(std::ceil(std::sqrt(double(count)))));
+    QVector<Shape> shapes;
+    shapes.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QPointF position((i % columns) * GRID_STEP, (i / columns) * GRID_STEP);
+        shapes.append(makeShape(i, position, 3 + i % 18, (i * 37) % 360));
+    }
+    return shapes;
+}
+
+void ShapeBenchmark::addVertexCountRows(bool withTransform)
+{
+    QTest::addColumn<int>("sides");
+    QTest::addColumn<double>("rotation");
+    QTest::addColumn<double>("scale");
+
+    for (int sides : VERTEX_COUNTS) {
+        if (!withTransform) {
+            QTest::addRow("n=%d", sides) << sides << 0.0 << 1.0;
+            continue;
+        }
+        for (double rotation : { 0.0, 37.5 }) {
+            for (double scale : { 1.0, 2.5 })
+                QTest::addRow("n=%d/rot=%g/scale=%g", sides, rotation, scale) << sides << rotation << scale;
+        }
+    }
+}
+
+// overlap — доля перекрытия описанных окружностей: 0 — фигуры разнесены,
+// 1 — центры совпадают.
+void ShapeBenchmark::addOverlapRows()
+{
+    QTest::addColumn<int>("sides");
+    QTest::addColumn<double>("overlap");
+
+    for (int sides : VERTEX_COUNTS) {
+        for (double overlap : { 0.0, 0.25, 0.5, 1.0 })
+            QTest::addRow("n=%d/overlap=%g", sides, overlap) << sides << overlap;
+    }
+}
+
+void ShapeBenchmark::addSceneSizeRows()
+{
+    QTest::addColumn<int>("count");
+
+    for (int count : { 100, 1000, 10000, 50000 })
+        QTest::addRow("shapes=%d", count) << count;
+}
+
+// Файлы сцен крупнее: цель — документ в миллион фигур
+void ShapeBenchmark::addSceneFileRows()
+{
+    QTest::addColumn<int>("count");
+
+    for (int count : { 10000, 100000, 1000000 })
+        QTest::addRow("shapes=%d", count) << count;
+}
+
+void ShapeBenchmark::getWorldPolygon_data()
+{
+    addVertexCountRows(true);
+}
+
+void ShapeBenchmark::getWorldPolygon()
+{
+    QFETCH(int, sides);
+    QFETCH(double, rotation);
+    QFETCH(double, scale);
+
+    const Shape shape = makeShape(0, QPointF(10, 20), sides, rotation, scale);
+    QPolygonF polygon;
+    QBENCHMARK {
+        polygon = shape.getWorldPolygon();
+    }
+    QCOMPARE(polygon.size(), sides);
+}
+
+void ShapeBenchmark::checkCollision_data()
+{
+    addOverlapRows();
+}
+
+void ShapeBenchmark::checkCollision()
+{
+    QFETCH(int, sides);
+    QFETCH(double, overlap);
+
+    const double distance = 2.2 * SHAPE_SIZE * (1.0 - overlap);
+    const Shape a = makeShape(0, QPointF(0, 0), sides);
+    const Shape b = makeShape(1, QPointF(distance, 0), sides, 15.0);
+    bool hit = false;
+    QBENCHMARK {
+        hit = a.checkCollision(b);
+    }
+    if (overlap == 1.0)
+        QVERIFY(hit);
+}
+
+void ShapeBenchmark::findMTV_data()
+{
+    addOverlapRows();
+}
+
+void ShapeBenchmark::findMTV()
+{
+    QFETCH(int, sides);
+    QFETCH(double, overlap);
+
+    const double distance = 2.2 * SHAPE_SIZE * (1.0 - overlap);
+    const QPolygonF a = makeShape(0, QPointF(0, 0), sides).getWorldPolygon();
+    const QPolygonF b = makeShape(1, QPointF(distance, 0), sides, 15.0).getWorldPolygon();
+    const Geometry::PointFPolygon polygonA(a.constData(), a.size());
+    const Geometry::PointFPolygon polygonB(b.constData(), b.size());
+    Geometry::Vec2<double> mtv;
+    QBENCHMARK {
+        mtv = Geometry::separation<DoublePolicy>(polygonA, polygonB);
+    }
+    Q_UNUSED(mtv);
+}
+
+void ShapeBenchmark::findMTVFloat_data()
+{
+    addOverlapRows();
+}
+
+// Тот же MTV по float-пулу SceneStore, как в интерактивном перетаскивании
+void ShapeBenchmark::findMTVFloat()
+{
+    QFETCH(int, sides);
+    QFETCH(double, overlap);
+
+    const double distance = 2.2 * SHAPE_SIZE * (1.0 - overlap);
+    SceneStore store;
+    store.append(makeShape(0, QPointF(0, 0), sides));
+    store.append(makeShape(1, QPointF(distance, 0), sides, 15.0));
+    store.updateWorldVertices();
+    const Geometry::SoAPolygon<float> a = store.worldPolygon(0);
+    const Geometry::SoAPolygon<float> b = store.worldPolygon(1);
+    Geometry::Vec2<float> mtv;
+    QBENCHMARK {
+        mtv = Geometry::separation<FloatPolicy>(a, b);
+    }
+    Q_UNUSED(mtv);
+}
+
+void ShapeBenchmark::resolveCollision_data()
+{
+    addOverlapRows();
+}
+
+void ShapeBenchmark::resolveCollision()
+{
+    QFETCH(int, sides);
+    QFETCH(double, overlap);
+
+    const double distance = 2.2 * SHAPE_SIZE * (1.0 - overlap);
+    const Shape a = makeShape(0, QPointF(0, 0), sides);
+    const Shape b = makeShape(1, QPointF(distance, 0), sides, 15.0);
+    QBENCHMARK {
+        Shape moved = a;
+        moved.resolveCollision(b);
+    }
+}
+
+void ShapeBenchmark::pointInPolygon_data()
+{
+    QTest::addColumn<int>("sides");
+    QTest::addColumn<bool>("inside");
+
+    for (int sides : VERTEX_COUNTS) {
+        QTest::addRow("n=%d/inside", sides) << sides << true;
+        QTest::addRow("n=%d/outside", sides) << sides << false;
+    }
+}
+
+void ShapeBenchmark::pointInPolygon()
+{
+    QFETCH(int, sides);
+    QFETCH(bool, inside);
+
+    const QPolygonF polygon = makeShape(0, QPointF(0, 0), sides, 10.0).getWorldPolygon();
+    const Geometry::PointFPolygon view(polygon.constData(), polygon.size());
+    const QPointF point = inside ? QPointF(1.0, 2.0) : QPointF(SHAPE_SIZE * 0.99, SHAPE_SIZE * 0.99);
+    bool result = false;
+    QBENCHMARK {
+        result = Geometry::pointInPolygon<DoublePolicy>(view, point.x(), point.y());
+    }
+    QCOMPARE(result, inside);
+}
+
+void ShapeBenchmark::updateWorldVertices_data()
+{
+    addSceneSizeRows();
+}
+
+// Пересчёт всех мировых вершин и AABB после изменения каждой фигуры
+void ShapeBenchmark::updateWorldVertices()
+{
+    QFETCH(int, count);
+
+    const QVector<Shape> shapes = makeGrid(count);
+    SceneStore store;
+    store.rebuild(shapes);
+    QBENCHMARK {
+        for (int i = 0; i < count; ++i)
+            store.updateTransform(i, shapes[i]);
+        store.updateWorldVertices();
+    }
+}
+
+void ShapeBenchmark::hitTest_data()
+{
+    addSceneSizeRows();
+}
+
+// Выбор фигуры точкой, как в VKCanvas::findShapeAtPoint: 64 точки по сцене
+void ShapeBenchmark::hitTest()
+{
+    QFETCH(int, count);
+
+    SceneStore store;
+    store.rebuild(makeGrid(count));
+    store.updateWorldVertices();
+
+    const int columns = qMax(1, int(std::ceil(std::sqrt(double(count)))));
+    const double extent = columns * GRID_STEP;
+    QVector<QPointF> points;
+    for (int i = 0; i < 64; ++i)
+        points.append(QPointF(std::fmod(i * 0.618034, 1.0) * extent, std::fmod(i * 0.414214, 1.0) * extent));
+
+    int hits = 0;
+    QBENCHMARK {
+        hits = 0;
+        for (const QPointF& point : std::as_const(points))
+            hits += store.hitTest(point) >= 0;
+    }
+    Q_UNUSED(hits);
+}
+
+void ShapeBenchmark::openSceneFile_data()
+{
+    addSceneFileRows();
+}
+
+// Открытие с проверкой заголовка и чтение одной колонки из отображения
+void ShapeBenchmark::openSceneFile()
+{
+    QFETCH(int, count);
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("scene.pssc"));
+    QVERIFY(SceneFile::save(path, makeGrid(count)));
+
+    double sum = 0.0;
+    QBENCHMARK {
+        SceneFile file;
+        QVERIFY(file.open(path));
+        const double* positionsX = file.positionsX();
+        for (int i = 0; i < file.shapeCount(); ++i)
+            sum += positionsX[i];
+    }
+    Q_UNUSED(sum);
+}
+
+void ShapeBenchmark::loadSceneFile_data()
+{
+    addSceneFileRows();
+}
+
+// Полная загрузка документа, как в VKCanvas::loadScene
+void ShapeBenchmark::loadSceneFile()
+{
+    QFETCH(int, count);
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("scene.pssc"));
+    QVERIFY(SceneFile::save(path, makeGrid(count)));
+
+    QBENCHMARK {
+        SceneFile file;
+        QVERIFY(file.open(path));
+        SceneStore store;
+        QVector<Shape> shapes = file.shapes();
+        store.rebuild(shapes);
+        QCOMPARE(shapes.size(), count);
+    }
+}
+
+void ShapeBenchmark::exportSvg_data()
+{
+    QTest::addColumn<int>("count");
+
+    for (int count : { 10000, 200000 })
+        QTest::addRow("shapes=%d", count) << count;
+}
+
+// Экспорт в файл: память постоянна, время растёт линейно
+void ShapeBenchmark::exportSvg()
+{
+    QFETCH(int, count);
+
+    const QVector<Shape> shapes = makeGrid(count);
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("scene.svg"));
+    QBENCHMARK {
+        QVERIFY(SvgExport::save(path, shapes));
+    }
+}
+
+void ShapeBenchmark::addImportRows()
+{
+    QTest::addColumn<int>("count");
+
+    for (int count : { 10000, 200000 })
+        QTest::addRow("shapes=%d", count) << count;
+}
+
+void ShapeBenchmark::importSvg_data()
+{
+    addImportRows();
+}
+
+// Разбор файла, записанного SvgExport, вместе с построением фигур
+void ShapeBenchmark::importSvg()
+{
+    QFETCH(int, count);
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("scene.svg"));
+    QVERIFY(SvgExport::save(path, makeGrid(count)));
+
+    QVector<Shape> shapes;
+    QBENCHMARK {
+        QVERIFY(SceneImport::load(path, &shapes));
+    }
+    QCOMPARE(shapes.size(), count);
+}
+
+void ShapeBenchmark::importJson_data()
+{
+    addImportRows();
+}
+
+void ShapeBenchmark::importJson()
+{
+    QFETCH(int, count);
+
+    QByteArray json = "{\"shapes\": [\n";
+    const QVector<Shape> grid = makeGrid(count);
+    for (int i = 0; i < grid.size(); ++i) {
+        json += i > 0 ? ",\n{\"points\": [" : "{\"points\": [";
+        const QPolygonF polygon = grid[i].getWorldPolygon();
+        for (int k = 0; k < polygon.size(); ++k) {
+            if (k > 0)
+                json += ", ";
+            json += '[' + QByteArray::number(polygon[k].x(), 'f', 3) + ", " + QByteArray::number(polygon[k].y(), 'f', 3) + ']';
+        }
+        json += "], \"color\": \"#0078ff\"}";
+    }
+    json += "\n]}\n";
+
+    QVector<Shape> shapes;
+    QBENCHMARK {
+        QVERIFY(SceneImport::parse(json, SceneImport::Json, &shapes));
+    }
+    QCOMPARE(shapes.size(), count);
+}
+
+void ShapeBenchmark::rasterize_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("threads");
+
+    for (int count : { 10000, 100000 }) {
+        for (int width : { 1024, 7680 }) {
+            for (int threads : { 1, 0 })
+                QTest::addRow("shapes=%d/width=%d/threads=%d", count, width, threads) << count << width << threads;
+        }
+    }
+}
+
+// Вся сцена в изображение; threads = 0 — по числу ядер
+void ShapeBenchmark::rasterize()
+{
+    QFETCH(int, count);
+    QFETCH(int, width);
+    QFETCH(int, threads);
+
+    const QVector<Shape> shapes = makeGrid(count);
+    QBENCHMARK {
+        const QImage image = Rasterizer::renderScene(shapes, width, QColor(Qt::transparent), threads);
+        QCOMPARE(image.width(), width);
+    }
+}
+
+void ShapeBenchmark::fillTiles_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("level");
+
+    for (int count : { 10000, 100000 }) {
+        for (int level : { -2, 0 })
+            QTest::addRow("shapes=%d/level=%d", count, level) << count << level;
+    }
+}
+
+// Плитки экрана 1920x1080 с пустого кэша до готовности последней
+void ShapeBenchmark::fillTiles()
+{
+    QFETCH(int, count);
+    QFETCH(int, level);
+
+    const QVector<Shape> shapes = makeGrid(count);
+    SceneStore store;
+    store.rebuild(shapes);
+    SceneSnapshotBuilder builder;
+    const std::shared_ptr<const SceneSnapshot> snapshot = builder.publish(shapes, store, -1);
+    const double scale = TileCache::levelScale(level);
+    const QRectF view(0, 0, 1920 / scale, 1080 / scale);
+
+    QVector<TileCache::Key> keys;
+    QBENCHMARK {
+        QSemaphore ready;
+        TileCache cache(1.5f, [&ready]() { ready.release(); });
+        cache.setSnapshot(snapshot);
+        cache.request(view, scale, keys);
+        ready.acquire(keys.size());
+        QCOMPARE(cache.pendingCount(), 0);
+    }
+}
+
+PAINTSHAPE_BENCHMARK_MAIN(ShapeBenchmark)
+
+#include "shapebenchmark.moc"
@@ -0,0 +1,86 @@
+#include "framearena.h"
+#include <new>
+
+namespace {
+
+thread_local AllocationCounter::Scope* currentScope = nullptr;
+
+} // namespace
+
+FrameArena::FrameArena(std::size_t capacity)
+    : m_buffer(capacity)
+{
+    m_overflow.reserve(16);
+}
+
+FrameArena::~FrameArena()
+{
+    releaseOverflow();
+}
+
+void FrameArena::reset()
+{
+    if (m_overflowBytes > 0) {
+        const std::size_t needed = m_offset + m_overflowBytes;
+        releaseOverflow();
+        m_buffer.assign(needed * 2, std::byte {});
+    }
+    m_offset = 0;
+}
+
+void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t base = reinterpret_cast<std::size_t>(m_buffer.data());
+    const std::size_t aligned = (base + m_offset + alignment - 1) & ~(alignment - 1);
+    const std::size_t end = aligned - base + bytes;
+    if (end <= m_buffer.size()) {
+        m_offset = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void* pointer = ::operator new(bytes, std::align_val_t(alignment));
+    m_overflow.push_back({ pointer, bytes, alignment });
+    m_overflowBytes += bytes;
+    return pointer;
+}
+
+// Память из буфера возвращается только в reset()
+void FrameArena::do_deallocate(void*, std::size_t, std::size_t)
+{
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void FrameArena::releaseOverflow()
+{
+    for (const Overflow& block : m_overflow)
+        ::operator delete(block.pointer, block.bytes, std::align_val_t(block.alignment));
+    m_overflow.clear();
+    m_overflowBytes = 0;
+}
+
+AllocationCounter::Scope::Scope()
+    : m_previous(currentScope)
+{
+    currentScope = this;
+}
+
+AllocationCounter::Scope::~Scope()
+{
+    currentScope = m_previous;
+    if (m_previous) {
+        m_previous->m_count += m_count;
+        m_previous->m_bytes += m_bytes;
+    }
+}
+
+void AllocationCounter::record(std::size_t bytes)
+{
+    if (Scope* scope = currentScope) {
+        ++scope->m_count;
+        scope->m_bytes += qint64(bytes);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Монотонная арена для временных данных одного кадра. Память
+// выдаётся сдвигом указателя из собственного буфера, освобождение —
+// разом в reset(). Если кадру не хватило буфера, излишек берётся из
+// кучи, а при следующем reset() буфер вырастает, так что в
+// установившемся режиме арена не обращается к куче.
+class FrameArena : public std::pmr::memory_resource
+{
+public:
+    explicit FrameArena(std::size_t capacity = 16 * 1024);
+    ~FrameArena() override;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void reset();
+
+    std::size_t capacity() const { return m_buffer.size(); }
+    // Выдано с последнего reset(), включая излишек из кучи
+    std::size_t bytesUsed() const { return m_offset + m_overflowBytes; }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    struct Overflow
+    {
+        void* pointer;
+        std::size_t bytes;
+        std::size_t alignment;
+    };
+
+    void releaseOverflow();
+
+    std::vector<std::byte> m_buffer;
+    std::size_t m_offset = 0;
+    std::vector<Overflow> m_overflow;
+    std::size_t m_overflowBytes = 0;
+};
+
+// Счётчик выделений кучи в текущем потоке внутри Scope. Работает,
+// только если в исполняемый файл включён allocationhooks.cpp: с glibc
+// считаются malloc/calloc/realloc (а через них operator new, контейнеры
+// Qt и геометрия узлов), на остальных платформах — только operator new.
+class AllocationCounter
+{
+public:
+    class Scope
+    {
+    public:
+        Scope();
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        qint64 count() const { return m_count; }
+        qint64 bytes() const { return m_bytes; }
+
+    private:
+        friend class AllocationCounter;
+        Scope* m_previous;
+        qint64 m_count = 0;
+        qint64 m_bytes = 0;
+    };
+
+    // Вызывается из замещённых malloc или operator new; сам не выделяет
+    static void record(std::size_t bytes);
+};
+
+#endif // FRAMEARENA_H
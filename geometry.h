@@ -0,0 +1,390 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <QPointF>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "predicates.h"
+
+// Политики точности геометрического ядра.
+// FloatPolicy — интерактивные пути: рендер, выбор, столкновения при
+// перетаскивании (данные берутся из float-пула SceneStore).
+// DoublePolicy — точные операции над Shape и экспорт.
+// Топологические решения (пересечения, принадлежность, триангуляция)
+// принимаются через предикаты из predicates.h и от политики не зависят.
+struct FloatPolicy
+{
+    using Real = float;
+    static constexpr Real axisEpsilon = 1e-6f;
+};
+
+struct DoublePolicy
+{
+    using Real = double;
+    static constexpr Real axisEpsilon = 1e-6;
+};
+
+namespace Geometry {
+
+template<typename Real>
+struct Vec2
+{
+    Real x = 0;
+    Real y = 0;
+
+    bool isNull() const { return x == 0 && y == 0; }
+};
+
+template<typename Real>
+inline int orientation(const Vec2<Real>& a, const Vec2<Real>& b, const Vec2<Real>& c)
+{
+    return Predicates::sign(Predicates::orient2d(a.x, a.y, b.x, b.y, c.x, c.y));
+}
+
+// Многоугольник в раздельных массивах координат (пул SceneStore)
+template<typename Real>
+struct SoAPolygon
+{
+    const Real* xs = nullptr;
+    const Real* ys = nullptr;
+    int count = 0;
+
+    int size() const { return count; }
+    Real x(int i) const { return xs[i]; }
+    Real y(int i) const { return ys[i]; }
+};
+
+// Многоугольник из QPointF (QPolygonF, вершины Shape)
+struct PointFPolygon
+{
+    const QPointF* points = nullptr;
+    int count = 0;
+
+    PointFPolygon(const QPointF* data, int size) : points(data), count(size) {}
+
+    int size() const { return count; }
+    double x(int i) const { return points[i].x(); }
+    double y(int i) const { return points[i].y(); }
+};
+
+// Явные точки преобразования между точностями
+inline QPointF toPointF(const Vec2<float>& v) { return QPointF(v.x, v.y); }
+inline QPointF toPointF(const Vec2<double>& v) { return QPointF(v.x, v.y); }
+template<typename Real>
+inline Vec2<Real> fromPointF(const QPointF& p) { return { Real(p.x()), Real(p.y()) }; }
+
+template<typename Policy, typename Polygon>
+Vec2<typename Policy::Real> center(const Polygon& polygon)
+{
+    using Real = typename Policy::Real;
+
+    Real cx = 0;
+    Real cy = 0;
+    const int count = polygon.size();
+    for (int i = 0; i < count; ++i) {
+        cx += Real(polygon.x(i));
+        cy += Real(polygon.y(i));
+    }
+    return { cx / count, cy / count };
+}
+
+// Чётно-нечётное правило. Сторона пересечения луча определяется знаком
+// orient2d, без деления на (yj - yi).
+template<typename Policy, typename Polygon>
+bool pointInPolygon(const Polygon& polygon, typename Policy::Real px, typename Policy::Real py)
+{
+    using Real = typename Policy::Real;
+
+    bool inside = false;
+    const int count = polygon.size();
+
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+        const Real xi = Real(polygon.x(i));
+        const Real yi = Real(polygon.y(i));
+        const Real xj = Real(polygon.x(j));
+        const Real yj = Real(polygon.y(j));
+
+        if ((yi > py) == (yj > py))
+            continue;
+
+        const int side = Predicates::sign(Predicates::orient2d(xi, yi, xj, yj, px, py));
+        if (side == (yj > yi ? 1 : -1))
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+template<typename Real>
+inline bool withinBox(const Vec2<Real>& a, const Vec2<Real>& b, const Vec2<Real>& p)
+{
+    return p.x >= std::min(a.x, b.x) && p.x <= std::max(a.x, b.x) &&
+           p.y >= std::min(a.y, b.y) && p.y <= std::max(a.y, b.y);
+}
+
+// Отрезки [p1, p2] и [p3, p4] пересекаются или касаются
+template<typename Policy>
+bool segmentsIntersect(const Vec2<typename Policy::Real>& p1, const Vec2<typename Policy::Real>& p2,
+                       const Vec2<typename Policy::Real>& p3, const Vec2<typename Policy::Real>& p4)
+{
+    const int o1 = orientation(p1, p2, p3);
+    const int o2 = orientation(p1, p2, p4);
+    const int o3 = orientation(p3, p4, p1);
+    const int o4 = orientation(p3, p4, p2);
+
+    if (o1 * o2 < 0 && o3 * o4 < 0)
+        return true;
+
+    return (o1 == 0 && withinBox(p1, p2, p3)) ||
+           (o2 == 0 && withinBox(p1, p2, p4)) ||
+           (o3 == 0 && withinBox(p3, p4, p1)) ||
+           (o4 == 0 && withinBox(p3, p4, p2));
+}
+
+template<typename Policy, typename PolygonA, typename PolygonB>
+bool polygonsIntersect(const PolygonA& a, const PolygonB& b)
+{
+    using Real = typename Policy::Real;
+    using V = Vec2<Real>;
+
+    const int n1 = a.size();
+    const int n2 = b.size();
+    if (n1 == 0 || n2 == 0)
+        return false;
+
+    for (int i = 0; i < n1; ++i) {
+        const int ni = (i + 1) % n1;
+        const V p1 { Real(a.x(i)), Real(a.y(i)) };
+        const V p2 { Real(a.x(ni)), Real(a.y(ni)) };
+
+        for (int j = 0; j < n2; ++j) {
+            const int nj = (j + 1) % n2;
+            const V p3 { Real(b.x(j)), Real(b.y(j)) };
+            const V p4 { Real(b.x(nj)), Real(b.y(nj)) };
+
+            if (segmentsIntersect<Policy>(p1, p2, p3, p4))
+                return true;
+        }
+    }
+
+    const V centerB = center<Policy>(b);
+    if (pointInPolygon<Policy>(a, centerB.x, centerB.y))
+        return true;
+
+    const V centerA = center<Policy>(a);
+    return pointInPolygon<Policy>(b, centerA.x, centerA.y);
+}
+
+// Вектор минимального смещения по теореме о разделяющих осях.
+// Нулевой вектор, если найдена разделяющая ось.
+template<typename Policy, typename PolygonA, typename PolygonB>
+Vec2<typename Policy::Real> minimumTranslation(const PolygonA& a, const PolygonB& b)
+{
+    using Real = typename Policy::Real;
+
+    Real smallestOverlap = std::numeric_limits<Real>::infinity();
+    Vec2<Real> smallestAxis;
+
+    auto project = [](const auto& polygon, Real ax, Real ay, Real& min, Real& max) {
+        min = max = Real(polygon.x(0)) * ax + Real(polygon.y(0)) * ay;
+        const int count = polygon.size();
+        for (int i = 1; i < count; ++i) {
+            const Real proj = Real(polygon.x(i)) * ax + Real(polygon.y(i)) * ay;
+            min = std::min(min, proj);
+            max = std::max(max, proj);
+        }
+    };
+
+    auto testAxes = [&](const auto& polygon) {
+        const int count = polygon.size();
+        for (int i = 0; i < count; ++i) {
+            const int next = (i + 1) % count;
+            const Real ex = Real(polygon.x(next)) - Real(polygon.x(i));
+            const Real ey = Real(polygon.y(next)) - Real(polygon.y(i));
+
+            const Real length = std::sqrt(ex * ex + ey * ey);
+            if (length <= Policy::axisEpsilon)
+                continue;
+            const Real ax = -ey / length;
+            const Real ay = ex / length;
+
+            Real minA, maxA, minB, maxB;
+            project(a, ax, ay, minA, maxA);
+            project(b, ax, ay, minB, maxB);
+
+            const Real overlap = std::min(maxA, maxB) - std::max(minA, minB);
+            if (overlap < 0)
+                return false;
+
+            if (overlap < smallestOverlap) {
+                smallestOverlap = overlap;
+                smallestAxis = { ax, ay };
+            }
+        }
+        return true;
+    };
+
+    if (a.size() == 0 || b.size() == 0)
+        return {};
+    if (!testAxes(a) || !testAxes(b))
+        return {};
+    if (smallestAxis.isNull())
+        return {};
+
+    return { smallestAxis.x * smallestOverlap, smallestAxis.y * smallestOverlap };
+}
+
+// MTV, направленный так, чтобы выталкивать a из b
+template<typename Policy, typename PolygonA, typename PolygonB>
+Vec2<typename Policy::Real> separation(const PolygonA& a, const PolygonB& b)
+{
+    Vec2<typename Policy::Real> mtv = minimumTranslation<Policy>(a, b);
+    if (mtv.isNull())
+        return mtv;
+
+    const auto centerA = center<Policy>(a);
+    const auto centerB = center<Policy>(b);
+    if (mtv.x * (centerA.x - centerB.x) + mtv.y * (centerA.y - centerB.y) < 0) {
+        mtv.x = -mtv.x;
+        mtv.y = -mtv.y;
+    }
+    return mtv;
+}
+
+// Триангуляция простого многоугольника отсечением ушей. Пишет в out
+// тройки индексов вершин и возвращает их количество (3 * (n - 2)).
+// Для самопересекающихся контуров остаток досыпается веером.
+template<typename Polygon, typename Index>
+int triangulate(const Polygon& polygon, Index* out)
+{
+    using Real = decltype(polygon.x(0));
+    using V = Vec2<Real>;
+
+    const int count = polygon.size();
+    if (count < 3)
+        return 0;
+
+    auto point = [&polygon](int i) { return V { polygon.x(i), polygon.y(i) }; };
+
+    double area = 0;
+    for (int i = 0, j = count - 1; i < count; j = i++)
+        area += double(polygon.x(j)) * polygon.y(i) - double(polygon.x(i)) * polygon.y(j);
+    const int winding = area < 0 ? -1 : 1;
+
+    std::vector<int> remaining(count);
+    for (int i = 0; i < count; ++i)
+        remaining[i] = i;
+
+    int written = 0;
+    int guard = 0;
+    int i = 0;
+    while (remaining.size() > 3 && guard < int(remaining.size())) {
+        const int n = remaining.size();
+        const int prev = remaining[(i + n - 1) % n];
+        const int curr = remaining[i % n];
+        const int next = remaining[(i + 1) % n];
+        const V a = point(prev);
+        const V b = point(curr);
+        const V c = point(next);
+
+        bool isEar = orientation(a, b, c) == winding;
+        for (int k = 0; isEar && k < n; ++k) {
+            const int other = remaining[k];
+            if (other == prev || other == curr || other == next)
+                continue;
+            const V p = point(other);
+            if (orientation(a, b, p) != -winding && orientation(b, c, p) != -winding &&
+                orientation(c, a, p) != -winding)
+                isEar = false;
+        }
+
+        if (isEar) {
+            out[written++] = Index(prev);
+            out[written++] = Index(curr);
+            out[written++] = Index(next);
+            remaining.erase(remaining.begin() + (i % n));
+            guard = 0;
+        } else {
+            ++i;
+            ++guard;
+        }
+        if (!remaining.empty())
+            i %= int(remaining.size());
+    }
+
+    for (size_t k = 1; k + 1 < remaining.size(); ++k) {
+        out[written++] = Index(remaining[0]);
+        out[written++] = Index(remaining[k]);
+        out[written++] = Index(remaining[k + 1]);
+    }
+
+    return written;
+}
+
+// Стыки обводки замкнутого контура. Для каждой вершины пишет в out
+// восемь чисел — векторы смещения левой и правой стороны в конце
+// входящего ребра и в начале исходящего: L0, L1, R0, R1. Точка обводки
+// на расстоянии d от контура — вершина плюс вектор, умноженный на d.
+// Если миттер длиннее miterLimit, внешняя сторона угла срезается
+// (bevel), а внутренняя получает укороченный миттер. Оба прохода без
+// ветвлений в теле цикла и векторизуются компилятором.
+template<typename Polygon, typename Real>
+void outlineJoins(const Polygon& polygon, Real* out, Real miterLimit)
+{
+    const int count = polygon.size();
+    if (count < 2) {
+        std::fill(out, out + count * 8, Real(0));
+        return;
+    }
+
+    // Единичные левые нормали рёбер i -> i + 1
+    std::vector<Real> nx(count);
+    std::vector<Real> ny(count);
+    for (int i = 0; i < count; ++i) {
+        const int next = i + 1 < count ? i + 1 : 0;
+        const Real dx = polygon.x(next) - polygon.x(i);
+        const Real dy = polygon.y(next) - polygon.y(i);
+        const Real length = std::sqrt(dx * dx + dy * dy);
+        const Real inverse = length > 0 ? Real(1) / length : Real(0);
+        nx[i] = -dy * inverse;
+        ny[i] = dx * inverse;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const int prev = i > 0 ? i - 1 : count - 1;
+        const Real ax = nx[prev];
+        const Real ay = ny[prev];
+        const Real bx = nx[i];
+        const Real by = ny[i];
+
+        // Миттер (n0 + n1) / (1 + n0·n1) имеет длину 1 / cos(угол / 2)
+        const Real denominator = std::max(Real(1) + ax * bx + ay * by, Real(1e-6));
+        Real mx = (ax + bx) / denominator;
+        Real my = (ay + by) / denominator;
+        const Real length = std::sqrt(mx * mx + my * my);
+        const bool bevel = length > miterLimit;
+        const Real clamp = bevel ? miterLimit / length : Real(1);
+        mx *= clamp;
+        my *= clamp;
+
+        // При повороте направо внешняя сторона угла — левая
+        const bool leftOuter = ax * by - ay * bx <= 0;
+        const bool leftBevel = bevel && leftOuter;
+        const bool rightBevel = bevel && !leftOuter;
+        Real* joint = out + i * 8;
+        joint[0] = leftBevel ? ax : mx;
+        joint[1] = leftBevel ? ay : my;
+        joint[2] = leftBevel ? bx : mx;
+        joint[3] = leftBevel ? by : my;
+        joint[4] = rightBevel ? -ax : -mx;
+        joint[5] = rightBevel ? -ay : -my;
+        joint[6] = rightBevel ? -bx : -mx;
+        joint[7] = rightBevel ? -by : -my;
+    }
+}
+
+} // namespace Geometry
+
+#endif // GEOMETRY_H
@@ -0,0 +1,191 @@
+#include "gizmonode.h"
+#include <QMatrix4x4>
+#include <QSGVertexColorMaterial>
+#include <array>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.141592653589793;
+
+// Единичная окружность кольца поворота; считается один раз
+const std::array<QPointF, GizmoNode::RingSegments + 1> &ringTable()
+{
+    static const std::array<QPointF, GizmoNode::RingSegments + 1> table = [] {
+        std::array<QPointF, GizmoNode::RingSegments + 1> points;
+        for (int i = 0; i <= GizmoNode::RingSegments; ++i) {
+            const double angle = 2.0 * PI * i / GizmoNode::RingSegments;
+            points[i] = QPointF(std::cos(angle), std::sin(angle));
+        }
+        return points;
+    }();
+    return table;
+}
+
+// Единичный квадрат маркера из двух треугольников
+const QPointF QuadTable[6] = {
+    { -0.5, -0.5 }, { 0.5, -0.5 }, { 0.5, 0.5 },
+    { -0.5, -0.5 }, { 0.5, 0.5 }, { -0.5, 0.5 }
+};
+
+// QSGVertexColorMaterial ждёт цвет с домноженной прозрачностью
+struct VertexColor
+{
+    uchar r, g, b, a;
+
+    VertexColor(const QColor &color)
+    {
+        const QRgb rgb = qPremultiply(color.rgba());
+        r = qRed(rgb);
+        g = qGreen(rgb);
+        b = qBlue(rgb);
+        a = qAlpha(rgb);
+    }
+};
+
+QSGGeometry::ColoredPoint2D *point(QSGGeometry::ColoredPoint2D *out, const QPointF &p, const VertexColor &color)
+{
+    out->set(p.x(), p.y(), color.r, color.g, color.b, color.a);
+    return out + 1;
+}
+
+QSGGeometry::ColoredPoint2D *quad(QSGGeometry::ColoredPoint2D *out, const QPointF &center, float size,
+                                  const VertexColor &color)
+{
+    for (const QPointF &corner : QuadTable)
+        out = point(out, center + corner * size, color);
+    return out;
+}
+
+// Отрезок, выдавленный в прямоугольник толщиной width
+QSGGeometry::ColoredPoint2D *segment(QSGGeometry::ColoredPoint2D *out, const QPointF &start, const QPointF &end,
+                                     float width, const VertexColor &color)
+{
+    const QPointF direction = end - start;
+    const qreal length = std::hypot(direction.x(), direction.y());
+    const QPointF offset = length > 0 ? QPointF(-direction.y(), direction.x()) * (width / 2 / length) : QPointF();
+    out = point(out, start + offset, color);
+    out = point(out, start - offset, color);
+    out = point(out, end + offset, color);
+    out = point(out, start - offset, color);
+    out = point(out, end - offset, color);
+    return point(out, end + offset, color);
+}
+
+QSGGeometryNode *createBatchNode()
+{
+    QSGGeometryNode *node = new QSGGeometryNode();
+    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+    geometry->setVertexDataPattern(QSGGeometry::DynamicPattern);
+    node->setGeometry(geometry);
+    node->setMaterial(new QSGVertexColorMaterial());
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+} // namespace
+
+GizmoNode::GizmoNode()
+    : m_triangles(createBatchNode())
+{
+    appendChildNode(m_triangles);
+}
+
+float GizmoNode::ringRadius(float sizeWidth, float sizeHeight)
+{
+    return qMax(sizeWidth, sizeHeight) + 40.0f;
+}
+
+QSGGeometry::ColoredPoint2D *GizmoNode::resize(int vertexCount)
+{
+    // Буфер перевыделяется только при смене числа вершин
+    QSGGeometry *geometry = m_triangles->geometry();
+    if (geometry->vertexCount() != vertexCount)
+        geometry->allocate(vertexCount);
+    m_triangles->markDirty(QSGNode::DirtyGeometry);
+    return geometry->vertexDataAsColoredPoint2D();
+}
+
+void GizmoNode::clear()
+{
+    if (m_mode == Empty)
+        return;
+    resize(0);
+    m_mode = Empty;
+}
+
+void GizmoNode::setEditHandles(const QPointF *vertices, int count, int selectedVertex, int selectedEdge)
+{
+    if (count <= 0) {
+        clear();
+        return;
+    }
+    if (m_mode != Edit) {
+        setMatrix(QMatrix4x4());
+        m_mode = Edit;
+    }
+
+    const VertexColor edgeColor(QColor(255, 255, 255, 120));
+    const VertexColor selectedEdgeColor(QColor(255, 255, 0, 180));
+    const VertexColor vertexColor(QColor(255, 255, 255));
+    const VertexColor selectedVertexColor(QColor(255, 0, 0));
+
+    // Рёбра, затем квадраты вершин поверх них
+    QSGGeometry::ColoredPoint2D *vertex = resize(count * 12);
+    for (int i = 0; i < count; ++i)
+        vertex = segment(vertex, vertices[i], vertices[(i + 1) % count], EdgeWidth,
+                       i == selectedEdge ? selectedEdgeColor : edgeColor);
+    for (int i = 0; i < count; ++i)
+        vertex = quad(vertex, vertices[i], VertexSize, i == selectedVertex ? selectedVertexColor : vertexColor);
+}
+
+void GizmoNode::setObjectHandles(const QPointF &center, float rotation, float sizeWidth, float sizeHeight)
+{
+    QMatrix4x4 matrix;
+    matrix.translate(center.x(), center.y());
+    matrix.rotate(rotation, 0, 0, 1);
+    setMatrix(matrix);
+
+    if (m_mode == Object && m_objectWidth == sizeWidth && m_objectHeight == sizeHeight)
+        return;
+    m_mode = Object;
+    m_objectWidth = sizeWidth;
+    m_objectHeight = sizeHeight;
+
+    const float radius = ringRadius(sizeWidth, sizeHeight);
+    const std::array<QPointF, RingSegments + 1> &ring = ringTable();
+    const VertexColor ringColor(QColor(0, 200, 0, 150));
+
+    const float inner = radius - RingWidth / 2;
+    const float outer = radius + RingWidth / 2;
+
+    // Кольцо из четырёхугольников между внутренней и внешней окружностью,
+    // затем три ручки размеров и две стрелки перемещения
+    QSGGeometry::ColoredPoint2D *vertex = resize(RingSegments * 6 + 3 * 6 + 2 * 3);
+    for (int i = 0; i < RingSegments; ++i) {
+        vertex = point(vertex, ring[i] * outer, ringColor);
+        vertex = point(vertex, ring[i] * inner, ringColor);
+        vertex = point(vertex, ring[i + 1] * outer, ringColor);
+        vertex = point(vertex, ring[i] * inner, ringColor);
+        vertex = point(vertex, ring[i + 1] * inner, ringColor);
+        vertex = point(vertex, ring[i + 1] * outer, ringColor);
+    }
+
+    vertex = quad(vertex, QPointF(sizeWidth + 20, 0), HandleSize, QColor(200, 200, 200));
+    vertex = quad(vertex, QPointF(0, sizeHeight + 20), HandleSize, QColor(0, 0, 200));
+    vertex = quad(vertex, QPointF(-sizeWidth - 20, 0), HandleSize, QColor(200, 0, 0));
+
+    const VertexColor moveXColor(QColor(255, 0, 0));
+    const QPointF moveX(radius + 20, 0);
+    vertex = point(vertex, moveX, moveXColor);
+    vertex = point(vertex, moveX + QPointF(-ArrowSize, ArrowSize / 2), moveXColor);
+    vertex = point(vertex, moveX + QPointF(-ArrowSize, -ArrowSize / 2), moveXColor);
+
+    const VertexColor moveYColor(QColor(0, 0, 255));
+    const QPointF moveY(0, -radius - 20);
+    vertex = point(vertex, moveY, moveYColor);
+    vertex = point(vertex, moveY + QPointF(ArrowSize / 2, ArrowSize), moveYColor);
+    point(vertex, moveY + QPointF(-ArrowSize / 2, ArrowSize), moveYColor);
+}
@@ -0,0 +1,53 @@
+#ifndef GIZMONODE_H
+#define GIZMONODE_H
+
+#include <QColor>
+#include <QPointF>
+#include <QSGGeometryNode>
+#include <QSGTransformNode>
+
+// Маркеры выделенной фигуры. Узел живёт всё время работы холста: все
+// маркеры собраны в одну дочернюю геометрию из треугольников с цветом в
+// вершинах — рёбра и кольцо поворота тоже выдавлены в четырёхугольники
+// нужной толщины, поэтому не зависят от поддержки ширины линий в RHI, и
+// число вызовов отрисовки не зависит от числа вершин. Формы берутся из
+// заранее посчитанных единичных таблиц, буферы переиспользуются.
+//
+// В режиме объекта геометрия задаётся относительно центра фигуры без
+// поворота, а положение и поворот — матрица этого узла: перемещение,
+// вращение фигуры и прокрутка вида вершины не трогают. Геометрия
+// пересобирается только при смене экранных размеров фигуры.
+class GizmoNode : public QSGTransformNode
+{
+public:
+    static constexpr int RingSegments = 64;
+    static constexpr float VertexSize = 8.0f;
+    static constexpr float HandleSize = 10.0f;
+    static constexpr float ArrowSize = 10.0f;
+    static constexpr float EdgeWidth = 2.0f;
+    static constexpr float RingWidth = 3.0f;
+
+    GizmoNode();
+
+    // Ничего не выделено
+    void clear();
+    // Режим редактирования: вершины фигуры в экранных координатах
+    void setEditHandles(const QPointF *vertices, int count, int selectedVertex, int selectedEdge);
+    // Режим объекта: размеры фигуры на экране в пикселях, поворот в градусах
+    void setObjectHandles(const QPointF &center, float rotation, float sizeWidth, float sizeHeight);
+
+    // Радиус кольца поворота для фигуры с такими экранными размерами
+    static float ringRadius(float sizeWidth, float sizeHeight);
+
+private:
+    enum Mode { Empty, Edit, Object };
+
+    QSGGeometry::ColoredPoint2D *resize(int vertexCount);
+
+    QSGGeometryNode *m_triangles;
+    Mode m_mode = Empty;
+    float m_objectWidth = 0;
+    float m_objectHeight = 0;
+};
+
+#endif // GIZMONODE_H
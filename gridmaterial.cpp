@@ -0,0 +1,74 @@
+#include "gridmaterial.h"
+#include <QMatrix4x4>
+#include <cstring>
+
+namespace {
+
+class GridShader : public QSGMaterialShader
+{
+public:
+    GridShader()
+    {
+        setShaderFileName(VertexStage, QStringLiteral(":/paintshape/shaders/grid.vert.qsb"));
+        setShaderFileName(FragmentStage, QStringLiteral(":/paintshape/shaders/grid.frag.qsb"));
+    }
+
+    // Буфер: qt_Matrix (64 байта), qt_Opacity, scale, offset (со сдвига 72)
+    bool updateUniformData(RenderState &state, QSGMaterial *newMaterial, QSGMaterial *) override
+    {
+        QByteArray *buffer = state.uniformData();
+        if (state.isMatrixDirty()) {
+            const QMatrix4x4 matrix = state.combinedMatrix();
+            std::memcpy(buffer->data(), matrix.constData(), 64);
+        }
+        if (state.isOpacityDirty()) {
+            const float opacity = state.opacity();
+            std::memcpy(buffer->data() + 64, &opacity, 4);
+        }
+
+        // Вид меняется почти каждый кадр прокрутки; двенадцать байт
+        // дешевле, чем выяснять, тот ли это материал, что в прошлый раз
+        const GridMaterial *material = static_cast<const GridMaterial *>(newMaterial);
+        const float scale = material->scale();
+        const float offset[2] = { float(material->offset().x()), float(material->offset().y()) };
+        std::memcpy(buffer->data() + 68, &scale, 4);
+        std::memcpy(buffer->data() + 72, offset, 8);
+        return true;
+    }
+};
+
+} // namespace
+
+GridMaterial::GridMaterial()
+{
+    setFlag(Blending);
+}
+
+void GridMaterial::setView(const QPointF &offset, float scale)
+{
+    m_offset = offset;
+    m_scale = scale;
+}
+
+QSGMaterialType *GridMaterial::type() const
+{
+    static QSGMaterialType type;
+    return &type;
+}
+
+QSGMaterialShader *GridMaterial::createShader(QSGRendererInterface::RenderMode) const
+{
+    return new GridShader();
+}
+
+int GridMaterial::compare(const QSGMaterial *other) const
+{
+    const GridMaterial *grid = static_cast<const GridMaterial *>(other);
+    if (m_scale != grid->m_scale)
+        return m_scale < grid->m_scale ? -1 : 1;
+    if (m_offset.x() != grid->m_offset.x())
+        return m_offset.x() < grid->m_offset.x() ? -1 : 1;
+    if (m_offset.y() != grid->m_offset.y())
+        return m_offset.y() < grid->m_offset.y() ? -1 : 1;
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef GRIDMATERIAL_H
+#define GRIDMATERIAL_H
+
+#include <QPointF>
+#include <QSGMaterial>
+
+// Бесконечная сетка и оси одним прямоугольником на весь элемент.
+// Линии, затухание мелких уровней при отдалении и цвет осей считает
+// фрагментный шейдер по параметрам вида, поэтому стоимость сетки не
+// зависит от масштаба, а прокрутка меняет только два uniform.
+class GridMaterial : public QSGMaterial
+{
+public:
+    GridMaterial();
+
+    // offset — положение мирового нуля на экране, scale — пикселей на
+    // единицу мира (как c_offsetX/c_offsetY и c_globalScale холста)
+    void setView(const QPointF &offset, float scale);
+    QPointF offset() const { return m_offset; }
+    float scale() const { return m_scale; }
+
+    QSGMaterialType *type() const override;
+    QSGMaterialShader *createShader(QSGRendererInterface::RenderMode renderMode) const override;
+    int compare(const QSGMaterial *other) const override;
+
+private:
+    QPointF m_offset;
+    float m_scale = 1.0f;
+};
+
+#endif // GRIDMATERIAL_H
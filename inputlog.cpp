@@ -0,0 +1,172 @@
+#include "inputlog.h"
+#include <QFile>
+#include <QHoverEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
+
+namespace {
+
+const quint32 MAGIC = 0x5053494C; // "PSIL"
+const quint16 VERSION = 1;
+
+void setError(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+}
+
+} // namespace
+
+bool InputLog::save(const QString& path, QString* error) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setError(error, file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_8);
+    stream << MAGIC << VERSION;
+
+    stream << state.size << state.offset << state.globalScale << qint32(state.activeTab)
+           << state.showGrid << state.collisionsEnabled << qint32(state.selectedShapeId)
+           << state.shapes;
+
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << quint32(events.size());
+    for (const Event& event : events) {
+        stream << event.time << event.type << event.button << event.buttons << event.modifiers
+               << event.x << event.y;
+        if (event.type == Wheel)
+            stream << event.angleDeltaX << event.angleDeltaY;
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        setError(error, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool InputLog::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_8);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != MAGIC || version != VERSION) {
+        setError(error, QStringLiteral("not an input log or unsupported version"));
+        return false;
+    }
+
+    CanvasState loadedState;
+    qint32 activeTab, selectedShapeId;
+    stream >> loadedState.size >> loadedState.offset >> loadedState.globalScale >> activeTab
+           >> loadedState.showGrid >> loadedState.collisionsEnabled >> selectedShapeId
+           >> loadedState.shapes;
+    loadedState.activeTab = activeTab;
+    loadedState.selectedShapeId = selectedShapeId;
+
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 count = 0;
+    stream >> count;
+
+    QVector<Event> loadedEvents;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Event event;
+        stream >> event.time >> event.type >> event.button >> event.buttons >> event.modifiers
+               >> event.x >> event.y;
+        if (event.type == Wheel)
+            stream >> event.angleDeltaX >> event.angleDeltaY;
+        loadedEvents.append(event);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        setError(error, QStringLiteral("truncated input log"));
+        return false;
+    }
+
+    state = loadedState;
+    events = loadedEvents;
+    return true;
+}
+
+quint8 InputLog::packModifiers(Qt::KeyboardModifiers modifiers)
+{
+    return quint8((modifiers.toInt() >> 25) & 0x1F);
+}
+
+Qt::KeyboardModifiers InputLog::unpackModifiers(quint8 modifiers)
+{
+    return Qt::KeyboardModifiers::fromInt(int(modifiers & 0x1F) << 25);
+}
+
+QString InputLog::eventTypeName(quint8 type)
+{
+    switch (type) {
+    case MousePress: return QStringLiteral("press");
+    case MouseRelease: return QStringLiteral("release");
+    case MouseMove: return QStringLiteral("move");
+    case Wheel: return QStringLiteral("wheel");
+    case HoverMove: return QStringLiteral("hover");
+    }
+    return QStringLiteral("unknown");
+}
+
+InputRecorder::InputRecorder(const QString& path, const InputLog::CanvasState& state)
+    : m_path(path)
+{
+    m_log.state = state;
+    m_clock.start();
+}
+
+InputLog::Event InputRecorder::makeEvent(InputLog::EventType type, const QPointF& position,
+                                         Qt::KeyboardModifiers modifiers) const
+{
+    InputLog::Event event;
+    event.time = quint32(m_clock.nsecsElapsed() / 1000);
+    event.type = type;
+    event.modifiers = InputLog::packModifiers(modifiers);
+    event.x = position.x();
+    event.y = position.y();
+    return event;
+}
+
+void InputRecorder::record(const QMouseEvent* event)
+{
+    InputLog::EventType type;
+    switch (event->type()) {
+    case QEvent::MouseButtonPress: type = InputLog::MousePress; break;
+    case QEvent::MouseButtonRelease: type = InputLog::MouseRelease; break;
+    case QEvent::MouseMove: type = InputLog::MouseMove; break;
+    default: return;
+    }
+
+    InputLog::Event recorded = makeEvent(type, event->position(), event->modifiers());
+    recorded.button = quint8(event->button());
+    recorded.buttons = quint8(event->buttons().toInt());
+    m_log.events.append(recorded);
+}
+
+void InputRecorder::record(const QWheelEvent* event)
+{
+    InputLog::Event recorded = makeEvent(InputLog::Wheel, event->position(), event->modifiers());
+    recorded.buttons = quint8(event->buttons().toInt());
+    recorded.angleDeltaX = qint16(qBound(-32768, event->angleDelta().x(), 32767));
+    recorded.angleDeltaY = qint16(qBound(-32768, event->angleDelta().y(), 32767));
+    m_log.events.append(recorded);
+}
+
+void InputRecorder::record(const QHoverEvent* event)
+{
+    m_log.events.append(makeEvent(InputLog::HoverMove, event->position(), event->modifiers()));
+}
@@ -0,0 +1,92 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <QElapsedTimer>
+#include <QPointF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include "shape.h"
+
+class QMouseEvent;
+class QWheelEvent;
+class QHoverEvent;
+
+// Запись потока событий ввода холста для воспроизведения. Вместе с
+// событиями хранится состояние холста на момент начала записи, чтобы
+// повтор шёл по тем же фигурам и тому же виду.
+//
+// Формат файла (QDataStream, Qt 6.8, числа с плавающей точкой одинарной
+// точности для событий): магия, версия, состояние холста, число событий,
+// события. Событие — 16 байт, у колеса ещё 4 байта angleDelta.
+class InputLog
+{
+public:
+    enum EventType : quint8 {
+        MousePress,
+        MouseRelease,
+        MouseMove,
+        Wheel,
+        HoverMove
+    };
+
+    struct Event
+    {
+        quint32 time = 0;       // мкс от начала записи
+        quint8 type = MouseMove;
+        quint8 button = 0;      // Qt::MouseButton
+        quint8 buttons = 0;     // Qt::MouseButtons
+        quint8 modifiers = 0;   // Qt::KeyboardModifiers >> 25
+        float x = 0;            // позиция в координатах холста
+        float y = 0;
+        qint16 angleDeltaX = 0; // только Wheel
+        qint16 angleDeltaY = 0;
+    };
+
+    struct CanvasState
+    {
+        QSizeF size;
+        QPointF offset;
+        double globalScale = 1.0;
+        int activeTab = 0;
+        bool showGrid = true;
+        bool collisionsEnabled = true;
+        int selectedShapeId = -1;
+        QVector<Shape> shapes;
+    };
+
+    CanvasState state;
+    QVector<Event> events;
+
+    bool save(const QString& path, QString* error = nullptr) const;
+    bool load(const QString& path, QString* error = nullptr);
+
+    static quint8 packModifiers(Qt::KeyboardModifiers modifiers);
+    static Qt::KeyboardModifiers unpackModifiers(quint8 modifiers);
+    static QString eventTypeName(quint8 type);
+};
+
+// Пишет события в InputLog по мере их прихода в обработчики холста
+class InputRecorder
+{
+public:
+    InputRecorder(const QString& path, const InputLog::CanvasState& state);
+
+    const QString& path() const { return m_path; }
+    const InputLog& log() const { return m_log; }
+
+    void record(const QMouseEvent* event);
+    void record(const QWheelEvent* event);
+    void record(const QHoverEvent* event);
+    bool save(QString* error = nullptr) const { return m_log.save(m_path, error); }
+
+private:
+    InputLog::Event makeEvent(InputLog::EventType type, const QPointF& position,
+                              Qt::KeyboardModifiers modifiers) const;
+
+    QString m_path;
+    InputLog m_log;
+    QElapsedTimer m_clock;
+};
+
+#endif // INPUTLOG_H
@@ -0,0 +1,53 @@
+#include "inputreplay.h"
+#include "vkcanvas.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHoverEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
+
+void InputReplay::restore(const InputLog &log)
+{
+    m_canvas->restoreState(log.state);
+    m_lastHoverPosition = QPointF();
+}
+
+qint64 InputReplay::dispatch(const InputLog::Event &event)
+{
+    const QPointF position(event.x, event.y);
+    const QPointF globalPosition = m_canvas->mapToGlobal(position);
+    const Qt::KeyboardModifiers modifiers = InputLog::unpackModifiers(event.modifiers);
+    const Qt::MouseButton button = Qt::MouseButton(event.button);
+    const Qt::MouseButtons buttons = Qt::MouseButtons::fromInt(event.buttons);
+
+    QElapsedTimer timer;
+    switch (event.type) {
+    case InputLog::MousePress:
+    case InputLog::MouseRelease:
+    case InputLog::MouseMove: {
+        const QEvent::Type type = event.type == InputLog::MousePress ? QEvent::MouseButtonPress
+                                : event.type == InputLog::MouseRelease ? QEvent::MouseButtonRelease
+                                : QEvent::MouseMove;
+        QMouseEvent mouseEvent(type, position, globalPosition, button, buttons, modifiers);
+        timer.start();
+        QCoreApplication::sendEvent(m_canvas, &mouseEvent);
+        return timer.nsecsElapsed();
+    }
+    case InputLog::Wheel: {
+        QWheelEvent wheelEvent(position, globalPosition, QPoint(),
+                               QPoint(event.angleDeltaX, event.angleDeltaY),
+                               buttons, modifiers, Qt::NoScrollPhase, false);
+        timer.start();
+        QCoreApplication::sendEvent(m_canvas, &wheelEvent);
+        return timer.nsecsElapsed();
+    }
+    case InputLog::HoverMove: {
+        QHoverEvent hoverEvent(QEvent::HoverMove, position, globalPosition, m_lastHoverPosition, modifiers);
+        m_lastHoverPosition = position;
+        timer.start();
+        QCoreApplication::sendEvent(m_canvas, &hoverEvent);
+        return timer.nsecsElapsed();
+    }
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef INPUTREPLAY_H
+#define INPUTREPLAY_H
+
+#include "inputlog.h"
+
+class VKCanvas;
+
+// Воспроизводит InputLog на холсте через его настоящие обработчики
+// событий (mousePressEvent, mouseMoveEvent, ...). Окно не требуется:
+// события отправляются прямо элементу.
+class InputReplay
+{
+public:
+    explicit InputReplay(VKCanvas *canvas) : m_canvas(canvas) {}
+
+    // Возвращает холст к состоянию на момент начала записи
+    void restore(const InputLog &log);
+    // Отправляет событие и возвращает время его обработки, нс
+    qint64 dispatch(const InputLog::Event &event);
+
+private:
+    VKCanvas *m_canvas;
+    QPointF m_lastHoverPosition;
+};
+
+#endif // INPUTREPLAY_H
@@ -0,0 +1,79 @@
+#include "outlinematerial.h"
+#include <QMatrix4x4>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+class OutlineShader : public QSGMaterialShader
+{
+public:
+    OutlineShader()
+    {
+        setShaderFileName(VertexStage, QStringLiteral(":/paintshape/shaders/outline.vert.qsb"));
+        setShaderFileName(FragmentStage, QStringLiteral(":/paintshape/shaders/outline.frag.qsb"));
+    }
+
+    // Буфер: qt_Matrix (64 байта), qt_Opacity, pixelSize
+    bool updateUniformData(RenderState &state, QSGMaterial *, QSGMaterial *) override
+    {
+        QByteArray *buffer = state.uniformData();
+        bool changed = false;
+        if (state.isMatrixDirty()) {
+            const QMatrix4x4 matrix = state.combinedMatrix();
+            std::memcpy(buffer->data(), matrix.constData(), 64);
+            // Вид — равномерный масштаб без поворота. Если рендерер слил
+            // узлы в пачку, вершины уже в экранных координатах и масштаб 1.
+            const QMatrix4x4 modelView = state.modelViewMatrix();
+            const float scale = std::hypot(modelView(0, 0), modelView(1, 0));
+            const float pixelSize = scale > 0 ? 1.0f / scale : 1.0f;
+            std::memcpy(buffer->data() + 68, &pixelSize, 4);
+            changed = true;
+        }
+        if (state.isOpacityDirty()) {
+            const float opacity = state.opacity();
+            std::memcpy(buffer->data() + 64, &opacity, 4);
+            changed = true;
+        }
+        return changed;
+    }
+};
+
+} // namespace
+
+OutlineMaterial::OutlineMaterial()
+{
+    setFlag(Blending);
+}
+
+const QSGGeometry::AttributeSet &OutlineMaterial::attributes()
+{
+    // Смещение — отдельный атрибут: при слиянии узлов в пачку рендерер
+    // пересчитывает только позицию
+    static const QSGGeometry::Attribute data[] = {
+        QSGGeometry::Attribute::createWithAttributeType(0, 2, QSGGeometry::FloatType,
+                                                        QSGGeometry::PositionAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(1, 2, QSGGeometry::FloatType,
+                                                        QSGGeometry::TexCoordAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(2, 4, QSGGeometry::UnsignedByteType,
+                                                        QSGGeometry::ColorAttribute)
+    };
+    static const QSGGeometry::AttributeSet set = { 3, sizeof(Vertex), data };
+    return set;
+}
+
+QSGMaterialType *OutlineMaterial::type() const
+{
+    static QSGMaterialType type;
+    return &type;
+}
+
+QSGMaterialShader *OutlineMaterial::createShader(QSGRendererInterface::RenderMode) const
+{
+    return new OutlineShader();
+}
+
+int OutlineMaterial::compare(const QSGMaterial *) const
+{
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef OUTLINEMATERIAL_H
+#define OUTLINEMATERIAL_H
+
+#include <QSGGeometry>
+#include <QSGMaterial>
+
+// Материал обводки фигур. Вершина — точка контура в координатах узла
+// (мировых) плюс смещение в пикселях экрана и цвет с домноженной
+// прозрачностью. Шейдер переводит смещение в координаты узла по
+// текущему масштабу, поэтому толщина обводки не зависит от зума, а
+// прокрутка и масштаб вида не требуют пересчёта вершин.
+//
+// Все экземпляры равны между собой (compare), так что узлы обводки
+// объединяются рендерером в общие пачки.
+class OutlineMaterial : public QSGMaterial
+{
+public:
+    struct Vertex
+    {
+        float x;
+        float y;
+        float offsetX;
+        float offsetY;
+        uchar r;
+        uchar g;
+        uchar b;
+        uchar a;
+
+        void set(float nx, float ny, float nOffsetX, float nOffsetY, uchar nr, uchar ng, uchar nb, uchar na)
+        {
+            x = nx;
+            y = ny;
+            offsetX = nOffsetX;
+            offsetY = nOffsetY;
+            r = nr;
+            g = ng;
+            b = nb;
+            a = na;
+        }
+    };
+
+    OutlineMaterial();
+
+    static const QSGGeometry::AttributeSet &attributes();
+
+    QSGMaterialType *type() const override;
+    QSGMaterialShader *createShader(QSGRendererInterface::RenderMode renderMode) const override;
+    int compare(const QSGMaterial *other) const override;
+};
+
+#endif // OUTLINEMATERIAL_H
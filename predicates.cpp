@@ -0,0 +1,161 @@
+#include "predicates.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+using Expansion = std::vector<double>;
+
+// Половина ulp единицы и априорная граница погрешности быстрой оценки
+const double EPSILON = 0.5 * 2.220446049250313e-16;
+const double ORIENT_ERRBOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+
+inline void twoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    const double bVirtual = x - a;
+    const double aVirtual = x - bVirtual;
+    y = (a - aVirtual) + (b - bVirtual);
+}
+
+inline void fastTwoSum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    y = b - (x - a);
+}
+
+inline void twoDiff(double a, double b, double& x, double& y)
+{
+    x = a - b;
+    const double bVirtual = a - x;
+    const double aVirtual = x + bVirtual;
+    y = (a - aVirtual) + (bVirtual - b);
+}
+
+inline void twoProduct(double a, double b, double& x, double& y)
+{
+    x = a * b;
+    y = std::fma(a, b, -x);
+}
+
+Expansion difference(double a, double b)
+{
+    double x, y;
+    twoDiff(a, b, x, y);
+    return { y, x };
+}
+
+// Компоненты упорядочены по возрастанию модуля и не перекрываются,
+// нули отбрасываются.
+Expansion grow(const Expansion& e, double b)
+{
+    Expansion h;
+    h.reserve(e.size() + 1);
+    double q = b;
+    for (double component : e) {
+        double sum, error;
+        twoSum(q, component, sum, error);
+        if (error != 0.0)
+            h.push_back(error);
+        q = sum;
+    }
+    if (q != 0.0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+Expansion sum(const Expansion& e, const Expansion& f)
+{
+    Expansion h = e;
+    for (double component : f)
+        h = grow(h, component);
+    return h;
+}
+
+Expansion scale(const Expansion& e, double b)
+{
+    Expansion h;
+    h.reserve(e.size() * 2);
+
+    double q, error;
+    twoProduct(e[0], b, q, error);
+    if (error != 0.0)
+        h.push_back(error);
+
+    for (size_t i = 1; i < e.size(); ++i) {
+        double product1, product0, partial;
+        twoProduct(e[i], b, product1, product0);
+        twoSum(q, product0, partial, error);
+        if (error != 0.0)
+            h.push_back(error);
+        fastTwoSum(product1, partial, q, error);
+        if (error != 0.0)
+            h.push_back(error);
+    }
+    if (q != 0.0 || h.empty())
+        h.push_back(q);
+    return h;
+}
+
+Expansion product(const Expansion& e, const Expansion& f)
+{
+    Expansion h { 0.0 };
+    for (double component : f)
+        h = sum(h, scale(e, component));
+    return h;
+}
+
+Expansion negate(Expansion e)
+{
+    for (double& component : e)
+        component = -component;
+    return e;
+}
+
+// Старшая компонента несёт знак всего разложения
+double mostSignificant(const Expansion& e)
+{
+    return e.back();
+}
+
+double orient2dExact(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const Expansion acx = difference(ax, cx);
+    const Expansion acy = difference(ay, cy);
+    const Expansion bcx = difference(bx, cx);
+    const Expansion bcy = difference(by, cy);
+
+    return mostSignificant(sum(product(acx, bcy), negate(product(acy, bcx))));
+}
+
+} // namespace
+
+namespace Predicates {
+
+double orient2d(double ax, double ay, double bx, double by, double cx, double cy)
+{
+    const double detLeft = (ax - cx) * (by - cy);
+    const double detRight = (ay - cy) * (bx - cx);
+    const double det = detLeft - detRight;
+
+    double detSum;
+    if (detLeft > 0.0) {
+        if (detRight <= 0.0)
+            return det;
+        detSum = detLeft + detRight;
+    } else if (detLeft < 0.0) {
+        if (detRight >= 0.0)
+            return det;
+        detSum = -detLeft - detRight;
+    } else {
+        return det;
+    }
+
+    const double errBound = ORIENT_ERRBOUND * detSum;
+    if (det >= errBound || -det >= errBound)
+        return det;
+
+    return orient2dExact(ax, ay, bx, by, cx, cy);
+}
+
+} // namespace Predicates
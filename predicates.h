@@ -0,0 +1,22 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+// Устойчивые геометрические предикаты (по Shewchuk): сначала быстрая
+// оценка в double с априорной границей погрешности, и только если знак
+// не определён — точный пересчёт на разложениях (expansion arithmetic).
+// Координаты float приводятся к double без потерь, поэтому предикаты
+// точны для обеих политик точности.
+namespace Predicates {
+
+// > 0, если a, b, c идут против часовой стрелки (в осях с y вверх),
+// < 0 — по часовой, 0 — точки на одной прямой. Знак всегда точный.
+double orient2d(double ax, double ay, double bx, double by, double cx, double cy);
+
+inline int sign(double value)
+{
+    return (value > 0) - (value < 0);
+}
+
+} // namespace Predicates
+
+#endif // PREDICATES_H
@@ -0,0 +1,267 @@
+#include "profiler.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QVariantList>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Кольцо одного потока. head двигает только поток-владелец, tail —
+// только читатель в drain(); переполнение отбрасывает новые записи.
+struct ThreadBuffer
+{
+    static constexpr quint32 Capacity = 4096;
+
+    std::array<Profiler::Record, Capacity> records;
+    std::atomic<quint32> head { 0 };
+    std::atomic<quint32> tail { 0 };
+    std::atomic<qint64> dropped { 0 };
+    quint16 index = 0;
+    QString name;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    // Буферы живут до выхода из программы: поток может завершиться
+    // раньше, чем читатель заберёт его последние записи
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<Profiler::Sink*> sinks;
+    // collect() — единственный читатель буферов
+    std::mutex collectMutex;
+    QElapsedTimer clock;
+
+    Registry() { clock.start(); }
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+ThreadBuffer* threadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = r.buffers.back().get();
+        buffer->index = quint16(r.buffers.size() - 1);
+        QThread* thread = QThread::currentThread();
+        buffer->name = thread->objectName();
+        if (buffer->name.isEmpty() && QCoreApplication::instance()
+            && QCoreApplication::instance()->thread() == thread)
+            buffer->name = QStringLiteral("GUI");
+        if (buffer->name.isEmpty())
+            buffer->name = QStringLiteral("thread %1").arg(buffer->index);
+    }
+    return buffer;
+}
+
+int bucketFor(qint64 duration)
+{
+    qint64 micros = duration / 1000;
+    int bucket = 0;
+    while (micros >= 2 && bucket < ProfileStats::BucketCount - 1) {
+        micros >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace
+
+std::atomic<bool> Profiler::s_enabled { false };
+std::atomic<qint64> Profiler::s_counters[Profiler::CounterCount] {};
+
+void Profiler::addSink(Sink* sink)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (std::find(r.sinks.begin(), r.sinks.end(), sink) == r.sinks.end())
+        r.sinks.push_back(sink);
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::removeSink(Sink* sink)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.sinks.erase(std::remove(r.sinks.begin(), r.sinks.end(), sink), r.sinks.end());
+    s_enabled.store(!r.sinks.empty(), std::memory_order_relaxed);
+}
+
+void Profiler::collect()
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> collectLock(r.collectMutex);
+
+    QVector<Record> records;
+    Counters counters {};
+    const qint64 dropped = drain(records, counters);
+
+    std::vector<Sink*> sinks;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        sinks = r.sinks;
+    }
+    for (Sink* sink : sinks)
+        sink->consume(records, counters, dropped);
+}
+
+qint64 Profiler::now()
+{
+    return registry().clock.nsecsElapsed();
+}
+
+void Profiler::submit(Stage stage, qint64 start, qint64 duration)
+{
+    ThreadBuffer* buffer = threadBuffer();
+    const quint32 head = buffer->head.load(std::memory_order_relaxed);
+    const quint32 tail = buffer->tail.load(std::memory_order_acquire);
+    if (head - tail >= ThreadBuffer::Capacity) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = buffer->records[head % ThreadBuffer::Capacity];
+    record.start = start;
+    record.duration = duration;
+    record.stage = stage;
+    record.thread = buffer->index;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+qint64 Profiler::drain(QVector<Record>& records, Counters& counters)
+{
+    std::vector<ThreadBuffer*> buffers;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        buffers.reserve(r.buffers.size());
+        for (const auto& buffer : r.buffers)
+            buffers.push_back(buffer.get());
+    }
+
+    qint64 dropped = 0;
+    for (ThreadBuffer* buffer : buffers) {
+        const quint32 head = buffer->head.load(std::memory_order_acquire);
+        quint32 tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail)
+            records.append(buffer->records[tail % ThreadBuffer::Capacity]);
+        buffer->tail.store(tail, std::memory_order_release);
+        dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < CounterCount; ++i)
+        counters[i] = s_counters[i].exchange(0, std::memory_order_relaxed);
+
+    return dropped;
+}
+
+const char* Profiler::stageName(int stage)
+{
+    switch (stage) {
+    case Frame: return "frame";
+    case Input: return "input";
+    case Collision: return "collision";
+    case PaintNode: return "paintNode";
+    case Grid: return "grid";
+    case ModelRefresh: return "modelRefresh";
+    case Sync: return "sync";
+    case Render: return "render";
+    }
+    return "unknown";
+}
+
+const char* Profiler::counterName(int counter)
+{
+    switch (counter) {
+    case ShapesDrawn: return "shapesDrawn";
+    case PairsTested: return "pairsTested";
+    case NodesAllocated: return "nodesAllocated";
+    case Allocations: return "allocations";
+    case AllocatedBytes: return "allocatedBytes";
+    case ArenaBytes: return "arenaBytes";
+    case TilesUploaded: return "tilesUploaded";
+    }
+    return "unknown";
+}
+
+QString Profiler::threadName(int thread)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (thread < 0 || thread >= int(r.buffers.size()))
+        return QString();
+    return r.buffers[thread]->name;
+}
+
+void ProfileStats::consume(const QVector<Profiler::Record>& records, const Profiler::Counters& counters,
+                           qint64 dropped)
+{
+    for (const Profiler::Record& record : records) {
+        StageStats& stats = m_stages[record.stage];
+        ++stats.count;
+        stats.total += record.duration;
+        stats.max = qMax(stats.max, record.duration);
+        ++stats.buckets[bucketFor(record.duration)];
+        if (record.stage == Profiler::Frame)
+            ++m_frames;
+    }
+
+    for (int i = 0; i < Profiler::CounterCount; ++i)
+        m_counters[i] += counters[i];
+    m_dropped += dropped;
+}
+
+void ProfileStats::reset()
+{
+    m_stages = {};
+    m_counters = {};
+    m_frames = 0;
+    m_dropped = 0;
+}
+
+QVariantMap ProfileStats::toVariantMap() const
+{
+    QVariantMap result;
+
+    const StageStats& frame = m_stages[Profiler::Frame];
+    const double frameMs = frame.count ? frame.total / 1e6 / frame.count : 0.0;
+    result.insert(QStringLiteral("frameMs"), frameMs);
+    result.insert(QStringLiteral("fps"), frameMs > 0.0 ? 1000.0 / frameMs : 0.0);
+    result.insert(QStringLiteral("dropped"), m_dropped);
+
+    QVariantList stages;
+    for (int stage = 0; stage < Profiler::StageCount; ++stage) {
+        const StageStats& stats = m_stages[stage];
+        QVariantList histogram;
+        for (int count : stats.buckets)
+            histogram.append(count);
+
+        QVariantMap entry;
+        entry.insert(QStringLiteral("name"), QString::fromLatin1(Profiler::stageName(stage)));
+        entry.insert(QStringLiteral("count"), stats.count);
+        entry.insert(QStringLiteral("avgMs"), stats.count ? stats.total / 1e6 / stats.count : 0.0);
+        entry.insert(QStringLiteral("maxMs"), stats.max / 1e6);
+        entry.insert(QStringLiteral("histogram"), histogram);
+        stages.append(entry);
+    }
+    result.insert(QStringLiteral("stages"), stages);
+
+    // Счётчики — в среднем на кадр
+    QVariantMap counters;
+    const int frames = qMax(1, m_frames);
+    for (int counter = 0; counter < Profiler::CounterCount; ++counter)
+        counters.insert(QString::fromLatin1(Profiler::counterName(counter)), double(m_counters[counter]) / frames);
+    result.insert(QStringLiteral("counters"), counters);
+
+    return result;
+}
@@ -0,0 +1,136 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QVariantMap>
+#include <QVector>
+#include <array>
+#include <atomic>
+
+// Лёгкий профилировщик горячих путей. Каждый поток пишет замеры в свой
+// кольцевой буфер без блокировок (один писатель — один читатель);
+// collect() периодически забирает их и раздаёт подписчикам (оверлей,
+// трассировка). Профилировщик включён, пока есть хотя бы один подписчик;
+// в выключенном состоянии ProfileScope и count() стоят одну
+// relaxed-загрузку флага.
+class Profiler
+{
+public:
+    enum Stage : quint8 {
+        Frame,          // интервал между кадрами окна (рендер-поток)
+        Input,          // обработчики мыши/колеса/наведения
+        Collision,      // разрешение столкновений
+        PaintNode,      // updatePaintNode целиком
+        Grid,           // сетка и оси внутри updatePaintNode
+        ModelRefresh,   // синхронные обработчики QML (таблицы вершин/рёбер)
+        Sync,           // синхронизация сцены окна с рендер-потоком
+        Render,         // отрисовка кадра окна
+        StageCount
+    };
+
+    enum Counter : quint8 {
+        ShapesDrawn,
+        PairsTested,
+        NodesAllocated,
+        Allocations,        // выделения кучи в updatePaintNode (AllocationCounter)
+        AllocatedBytes,
+        ArenaBytes,         // временные данные кадра в FrameArena
+        TilesUploaded,      // текстуры плиток TileCache, загруженные за кадр
+        CounterCount
+    };
+
+    struct Record
+    {
+        qint64 start = 0;       // нс от старта профилировщика
+        qint64 duration = 0;    // нс
+        quint8 stage = Frame;
+        quint16 thread = 0;     // индекс буфера потока, см. threadName()
+    };
+
+    using Counters = std::array<qint64, CounterCount>;
+
+    class Sink
+    {
+    public:
+        virtual ~Sink() = default;
+        // dropped — записи, потерянные из-за переполнения буферов
+        virtual void consume(const QVector<Record>& records, const Counters& counters, qint64 dropped) = 0;
+    };
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void addSink(Sink* sink);
+    static void removeSink(Sink* sink);
+    // Забирает записи всех потоков, обнуляет счётчики и передаёт всё
+    // подписчикам. Вызывается из потока GUI.
+    static void collect();
+
+    static qint64 now();
+    static void submit(Stage stage, qint64 start, qint64 duration);
+    static void count(Counter counter, qint64 value = 1)
+    {
+        if (isEnabled())
+            s_counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static const char* stageName(int stage);
+    static const char* counterName(int counter);
+    static QString threadName(int thread);
+
+private:
+    static qint64 drain(QVector<Record>& records, Counters& counters);
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<qint64> s_counters[CounterCount];
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(Profiler::Stage stage)
+        : m_stage(stage), m_start(Profiler::isEnabled() ? Profiler::now() : -1)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_start >= 0)
+            Profiler::submit(m_stage, m_start, Profiler::now() - m_start);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler::Stage m_stage;
+    qint64 m_start;
+};
+
+// Агрегат замеров за окно отчёта: среднее, максимум и гистограмма
+// (логарифмические корзины по микросекундам) для каждой стадии.
+class ProfileStats : public Profiler::Sink
+{
+public:
+    static constexpr int BucketCount = 12; // <2 мкс, <4 мкс, ..., >=2 мс
+
+    void consume(const QVector<Profiler::Record>& records, const Profiler::Counters& counters,
+                 qint64 dropped) override;
+    void reset();
+
+    // Формат для QML: { frameMs, fps, dropped, stages: [...], counters: {...} }
+    QVariantMap toVariantMap() const;
+
+private:
+    struct StageStats
+    {
+        qint64 count = 0;
+        qint64 total = 0;
+        qint64 max = 0;
+        std::array<int, BucketCount> buckets {};
+    };
+
+    std::array<StageStats, Profiler::StageCount> m_stages {};
+    Profiler::Counters m_counters {};
+    int m_frames = 0;
+    qint64 m_dropped = 0;
+};
+
+#endif // PROFILER_H
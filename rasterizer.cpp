@@ -0,0 +1,508 @@
+#include "rasterizer.h"
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const int STRIDE = Rasterizer::TileSize + 2;
+// Поля вокруг сцены в renderScene, мировые единицы
+const double MARGIN = 10.0;
+
+// Ребро в пикселях изображения
+struct Edge
+{
+    float x0, y0, x1, y1;
+};
+
+struct Polygon
+{
+    int firstEdge = 0;
+    int edgeCount = 0;
+    float left = 0, top = 0, right = 0, bottom = 0;
+    // Диапазон плиток включительно
+    int tileLeft = 0, tileTop = 0, tileRight = 0, tileBottom = 0;
+    // ARGB с умноженными на альфу каналами
+    quint32 color = 0;
+};
+
+struct Scene
+{
+    int width = 0;
+    int height = 0;
+    int columns = 0;
+    int rows = 0;
+    QVector<Edge> edges;
+    QVector<Polygon> polygons;
+    // Плитка t: номера многоугольников bins[binOffsets[t] .. binOffsets[t + 1])
+    // в порядке отрисовки
+    QVector<int> binOffsets;
+    QVector<int> bins;
+};
+
+// Буфер знаковой площади одной плитки. Строка шире плитки на два
+// столбца: туда попадают вклады рёбер, лежащих на правой границе.
+class Accumulator
+{
+public:
+    Accumulator()
+        : m_cells(STRIDE * Rasterizer::TileSize, 0.0f)
+    {
+    }
+
+    void setSize(int width, int height)
+    {
+        m_width = width;
+        m_height = height;
+    }
+
+    float* row(int y) { return m_cells.data() + y * STRIDE; }
+
+    // Координаты локальные для плитки. Часть ребра левее плитки
+    // прижимается к x = 0 (покрывает строку до конца), часть правее
+    // видимых пикселей не касается и отбрасывается.
+    void addEdge(float x0, float y0, float x1, float y1)
+    {
+        if (y0 == y1 || qMax(y0, y1) <= 0.0f || qMin(y0, y1) >= float(m_height))
+            return;
+
+        const float width = float(m_width);
+        float cuts[4];
+        int count = 0;
+        cuts[count++] = 0.0f;
+        if ((x0 < 0.0f) != (x1 < 0.0f))
+            cuts[count++] = -x0 / (x1 - x0);
+        if ((x0 < width) != (x1 < width))
+            cuts[count++] = (width - x0) / (x1 - x0);
+        cuts[count++] = 1.0f;
+        if (count == 4 && cuts[1] > cuts[2])
+            std::swap(cuts[1], cuts[2]);
+
+        const float dx = x1 - x0;
+        const float dy = y1 - y0;
+        for (int i = 0; i + 1 < count; ++i) {
+            const float ax = x0 + dx * cuts[i];
+            const float ay = y0 + dy * cuts[i];
+            const float bx = i + 2 == count ? x1 : x0 + dx * cuts[i + 1];
+            const float by = i + 2 == count ? y1 : y0 + dy * cuts[i + 1];
+            const float middle = 0.5f * (ax + bx);
+            if (middle >= width)
+                continue;
+            if (middle <= 0.0f)
+                addLine(0.0f, ay, 0.0f, by);
+            else
+                addLine(qBound(0.0f, ax, width), ay, qBound(0.0f, bx, width), by);
+        }
+    }
+
+private:
+    // Площадь трапеции под отрезком распределяется по ячейкам строки так,
+    // что префиксная сумма даёт покрытие каждого пикселя
+    void addLine(float x0, float y0, float x1, float y1)
+    {
+        if (y0 == y1)
+            return;
+        float direction = 1.0f;
+        if (y0 > y1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+            direction = -1.0f;
+        }
+
+        const float width = float(m_width);
+        const float dxdy = (x1 - x0) / (y1 - y0);
+        float x = x0;
+        int y = int(y0);
+        if (y0 < 0.0f) {
+            x = qBound(0.0f, x - y0 * dxdy, width);
+            y = 0;
+        }
+        const int end = qMin(m_height, int(std::ceil(y1)));
+        for (; y < end; ++y) {
+            float* cells = row(y);
+            const float dy = qMin(float(y + 1), y1) - qMax(float(y), y0);
+            const float next = qBound(0.0f, x + dxdy * dy, width);
+            const float d = dy * direction;
+            const float left = qMin(x, next);
+            const float right = qMax(x, next);
+            const float leftFloor = std::floor(left);
+            const int l = int(leftFloor);
+            const float rightCeil = std::ceil(right);
+            const int r = int(rightCeil);
+
+            if (r <= l + 1) {
+                const float middle = 0.5f * (x + next) - leftFloor;
+                cells[l] += d - d * middle;
+                cells[l + 1] += d * middle;
+            } else {
+                const float s = 1.0f / (right - left);
+                const float leftFraction = left - leftFloor;
+                const float first = 0.5f * s * (1.0f - leftFraction) * (1.0f - leftFraction);
+                const float rightFraction = right - rightCeil + 1.0f;
+                const float last = 0.5f * s * rightFraction * rightFraction;
+                cells[l] += d * first;
+                if (r == l + 2) {
+                    cells[l + 1] += d * (1.0f - first - last);
+                } else {
+                    const float second = s * (1.5f - leftFraction);
+                    cells[l + 1] += d * (second - first);
+                    for (int i = l + 2; i < r - 1; ++i)
+                        cells[i] += d * s;
+                    const float beforeLast = second + float(r - l - 3) * s;
+                    cells[r - 1] += d * (1.0f - beforeLast - last);
+                }
+                cells[r] += d * last;
+            }
+            x = next;
+        }
+    }
+
+    QVector<float> m_cells;
+    int m_width = 0;
+    int m_height = 0;
+};
+
+// Каналы pixel, умноженные на scale / 256
+inline quint32 byteMul(quint32 pixel, quint32 scale)
+{
+    const quint32 rb = ((pixel & 0x00ff00ff) * scale >> 8) & 0x00ff00ff;
+    const quint32 ag = ((pixel >> 8) & 0x00ff00ff) * scale & 0xff00ff00;
+    return rb | ag;
+}
+
+// source-over для premultiplied ARGB; coverage в 0..256
+inline quint32 blend(quint32 destination, quint32 source, int coverage)
+{
+    const quint32 color = coverage >= 256 ? source : byteMul(source, quint32(coverage));
+    const quint32 inverse = 255 - (color >> 24);
+    return color + byteMul(destination, inverse + (inverse >> 7));
+}
+
+Scene createScene(int width, int height)
+{
+    Scene scene;
+    scene.width = width;
+    scene.height = height;
+    scene.columns = (width + Rasterizer::TileSize - 1) / Rasterizer::TileSize;
+    scene.rows = (height + Rasterizer::TileSize - 1) / Rasterizer::TileSize;
+    return scene;
+}
+
+// Перевод мировых координат в пиксели: viewport вписан в изображение
+// с сохранением пропорций и по центру
+struct Projection
+{
+    double scale = 1;
+    double offsetX = 0;
+    double offsetY = 0;
+
+    Projection(const QRectF& viewport, int width, int height)
+        : scale(qMin(width / viewport.width(), height / viewport.height()))
+        , offsetX(0.5 * width - viewport.center().x() * scale)
+        , offsetY(0.5 * height - viewport.center().y() * scale)
+    {
+    }
+
+    QPointF map(double x, double y) const { return QPointF(x * scale + offsetX, y * scale + offsetY); }
+};
+
+Polygon beginPolygon(const Scene& scene)
+{
+    Polygon polygon;
+    polygon.firstEdge = scene.edges.size();
+    polygon.left = polygon.top = std::numeric_limits<float>::max();
+    polygon.right = polygon.bottom = std::numeric_limits<float>::lowest();
+    return polygon;
+}
+
+// Замкнутый контур в пикселях изображения. У многоугольника может быть
+// несколько контуров: покрытие считается по сумме их площадей.
+void addContour(Scene& scene, Polygon& polygon, const QPointF* points, int count)
+{
+    float previousX = float(points[count - 1].x());
+    float previousY = float(points[count - 1].y());
+    for (int i = 0; i < count; ++i) {
+        const float x = float(points[i].x());
+        const float y = float(points[i].y());
+        polygon.left = qMin(polygon.left, x);
+        polygon.top = qMin(polygon.top, y);
+        polygon.right = qMax(polygon.right, x);
+        polygon.bottom = qMax(polygon.bottom, y);
+        // Горизонтальные рёбра площади не дают
+        if (y != previousY)
+            scene.edges.append({ previousX, previousY, x, y });
+        previousX = x;
+        previousY = y;
+    }
+}
+
+// Многоугольник целиком за пределами изображения отбрасывается
+void endPolygon(Scene& scene, Polygon& polygon, const QColor& color)
+{
+    polygon.edgeCount = scene.edges.size() - polygon.firstEdge;
+
+    const int left = qMax(0, int(std::floor(polygon.left)));
+    const int top = qMax(0, int(std::floor(polygon.top)));
+    const int right = qMin(scene.width, int(std::ceil(polygon.right)));
+    const int bottom = qMin(scene.height, int(std::ceil(polygon.bottom)));
+    if (polygon.edgeCount == 0 || left >= right || top >= bottom) {
+        scene.edges.resize(polygon.firstEdge);
+        return;
+    }
+    polygon.tileLeft = left / Rasterizer::TileSize;
+    polygon.tileTop = top / Rasterizer::TileSize;
+    polygon.tileRight = (right - 1) / Rasterizer::TileSize;
+    polygon.tileBottom = (bottom - 1) / Rasterizer::TileSize;
+    polygon.color = qPremultiply(color.rgba());
+    scene.polygons.append(polygon);
+}
+
+QColor fillColor(const QColor& color)
+{
+    QColor fill = color;
+    fill.setAlpha(Shape::FillAlpha);
+    return fill;
+}
+
+// Два прохода: число многоугольников на плитку, затем сами номера
+void binPolygons(Scene& scene)
+{
+    const int tileCount = scene.columns * scene.rows;
+    scene.binOffsets.fill(0, tileCount + 1);
+    for (const Polygon& polygon : std::as_const(scene.polygons)) {
+        for (int row = polygon.tileTop; row <= polygon.tileBottom; ++row) {
+            for (int column = polygon.tileLeft; column <= polygon.tileRight; ++column)
+                ++scene.binOffsets[row * scene.columns + column + 1];
+        }
+    }
+    for (int tile = 0; tile < tileCount; ++tile)
+        scene.binOffsets[tile + 1] += scene.binOffsets[tile];
+
+    scene.bins.resize(scene.binOffsets[tileCount]);
+    QVector<int> cursor(scene.binOffsets.constBegin(), scene.binOffsets.constEnd() - 1);
+    for (int i = 0; i < scene.polygons.size(); ++i) {
+        const Polygon& polygon = scene.polygons[i];
+        for (int row = polygon.tileTop; row <= polygon.tileBottom; ++row) {
+            for (int column = polygon.tileLeft; column <= polygon.tileRight; ++column)
+                scene.bins[cursor[row * scene.columns + column]++] = i;
+        }
+    }
+}
+
+Scene prepare(const QVector<Shape>& shapes, const QRectF& viewport, int width, int height)
+{
+    Scene scene = createScene(width, height);
+    const Projection projection(viewport, width, height);
+
+    scene.polygons.reserve(shapes.size());
+    QVector<QPointF> local;
+    QVector<QPointF> world;
+    for (const Shape& shape : shapes) {
+        if (!shape.isVisible())
+            continue;
+        local = shape.vertices();
+        const int count = local.size();
+        if (count < 3)
+            continue;
+        world.resize(count);
+        shape.transformVertices(local.constData(), world.data(), count);
+        for (QPointF& point : world)
+            point = projection.map(point.x(), point.y());
+
+        Polygon polygon = beginPolygon(scene);
+        addContour(scene, polygon, world.constData(), count);
+        endPolygon(scene, polygon, fillColor(shape.color()));
+    }
+    binPolygons(scene);
+    return scene;
+}
+
+// Заливка и обводка каждой записи. Обводка — отдельный многоугольник
+// из двух контуров: левый край полосы по ходу обхода и правый в
+// обратном порядке, так что внутри правого их площади взаимно
+// сокращаются. Края с изломами в стыках — те же точки, что у
+// обводки холста (Geometry::outlineJoins).
+Scene prepare(const QVector<const SceneSnapshot::Entry*>& entries, const QRectF& viewport, int width, int height,
+              float outlineWidth)
+{
+    Scene scene = createScene(width, height);
+    const Projection projection(viewport, width, height);
+    const float halfWidth = outlineWidth / 2;
+
+    scene.polygons.reserve(entries.size() * 2);
+    QVector<QPointF> points;
+    QVector<QPointF> left;
+    QVector<QPointF> right;
+    for (const SceneSnapshot::Entry* entry : entries) {
+        const int count = entry->x.size();
+        if (count < 3)
+            continue;
+        points.resize(count);
+        for (int i = 0; i < count; ++i)
+            points[i] = projection.map(entry->x[i], entry->y[i]);
+
+        Polygon fill = beginPolygon(scene);
+        addContour(scene, fill, points.constData(), count);
+        endPolygon(scene, fill, fillColor(entry->color));
+
+        if (halfWidth <= 0 || entry->joins.size() != count * SceneStore::JoinStride)
+            continue;
+        const float* joins = entry->joins.constData();
+        left.resize(count * 2);
+        right.resize(count * 2);
+        for (int i = 0; i < count; ++i) {
+            const float* join = joins + i * SceneStore::JoinStride;
+            for (int side = 0; side < 2; ++side) {
+                left[i * 2 + side] = points[i] + QPointF(join[side * 2], join[side * 2 + 1]) * halfWidth;
+                right[(count - 1 - i) * 2 + 1 - side]
+                    = points[i] + QPointF(join[4 + side * 2], join[4 + side * 2 + 1]) * halfWidth;
+            }
+        }
+        Polygon outline = beginPolygon(scene);
+        addContour(scene, outline, left.constData(), left.size());
+        addContour(scene, outline, right.constData(), right.size());
+        endPolygon(scene, outline, entry->color.darker(Rasterizer::OutlineDarkness));
+    }
+    binPolygons(scene);
+    return scene;
+}
+
+void renderTile(const Scene& scene, int tile, Accumulator& accumulator, uchar* bits, qsizetype bytesPerLine)
+{
+    const int tileX = (tile % scene.columns) * Rasterizer::TileSize;
+    const int tileY = (tile / scene.columns) * Rasterizer::TileSize;
+    const int width = qMin(Rasterizer::TileSize, scene.width - tileX);
+    const int height = qMin(Rasterizer::TileSize, scene.height - tileY);
+    accumulator.setSize(width, height);
+
+    for (int bin = scene.binOffsets[tile]; bin < scene.binOffsets[tile + 1]; ++bin) {
+        const Polygon& polygon = scene.polygons[scene.bins[bin]];
+        const int top = qMax(0, int(std::floor(polygon.top)) - tileY);
+        const int bottom = qMin(height, int(std::ceil(polygon.bottom)) - tileY);
+        const int left = qMax(0, int(std::floor(polygon.left)) - tileX);
+        const int rightEdge = int(std::ceil(polygon.right)) - tileX;
+        const int right = qMin(width, rightEdge);
+        const int clearEnd = qMin(width + 2, rightEdge + 2);
+
+        const Edge* edges = scene.edges.constData() + polygon.firstEdge;
+        for (int i = 0; i < polygon.edgeCount; ++i) {
+            accumulator.addEdge(edges[i].x0 - tileX, edges[i].y0 - tileY,
+                                edges[i].x1 - tileX, edges[i].y1 - tileY);
+        }
+
+        for (int y = top; y < bottom; ++y) {
+            float* cells = accumulator.row(y);
+            quint32* line = reinterpret_cast<quint32*>(bits + qsizetype(tileY + y) * bytesPerLine) + tileX;
+            float coverage = 0.0f;
+            int x = left;
+            for (; x < right; ++x) {
+                coverage += cells[x];
+                cells[x] = 0.0f;
+                const int alpha = int(qMin(1.0f, std::abs(coverage)) * 256.0f + 0.5f);
+                if (alpha > 0)
+                    line[x] = blend(line[x], polygon.color, alpha);
+            }
+            for (; x < clearEnd; ++x)
+                cells[x] = 0.0f;
+        }
+    }
+}
+
+void fill(const Scene& scene, QImage& image, int threads)
+{
+    if (scene.polygons.isEmpty())
+        return;
+    if (image.format() != QImage::Format_ARGB32_Premultiplied)
+        image.convertTo(QImage::Format_ARGB32_Premultiplied);
+
+    // bits() отсоединяет изображение до запуска потоков
+    uchar* bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+    const int tileCount = scene.columns * scene.rows;
+    std::atomic<int> nextTile { 0 };
+    auto work = [&scene, &nextTile, tileCount, bits, bytesPerLine]() {
+        Accumulator accumulator;
+        for (int tile = nextTile.fetch_add(1, std::memory_order_relaxed); tile < tileCount;
+             tile = nextTile.fetch_add(1, std::memory_order_relaxed)) {
+            if (scene.binOffsets[tile] != scene.binOffsets[tile + 1])
+                renderTile(scene, tile, accumulator, bits, bytesPerLine);
+        }
+    };
+
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    threads = qMin(threads, tileCount);
+    if (threads <= 1) {
+        work();
+        return;
+    }
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < threads; ++i)
+        pool.start(work);
+    pool.waitForDone();
+}
+
+} // namespace
+
+void Rasterizer::render(const QVector<Shape>& shapes, const QRectF& viewport, QImage& image, int threads)
+{
+    if (image.isNull() || viewport.isEmpty())
+        return;
+    fill(prepare(shapes, viewport, image.width(), image.height()), image, threads);
+}
+
+void Rasterizer::render(const QVector<const SceneSnapshot::Entry*>& entries, const QRectF& viewport, QImage& image,
+                        float outlineWidth, int threads)
+{
+    if (image.isNull() || viewport.isEmpty())
+        return;
+    fill(prepare(entries, viewport, image.width(), image.height(), outlineWidth), image, threads);
+}
+
+QImage Rasterizer::render(const QVector<Shape>& shapes, const QSize& size, const QRectF& viewport,
+                          const QColor& background, int threads)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(background);
+    render(shapes, viewport, image, threads);
+    return image;
+}
+
+QImage Rasterizer::renderScene(const QVector<Shape>& shapes, int maxSide, const QColor& background, int threads)
+{
+    QRectF bounds = sceneBounds(shapes);
+    if (bounds.isNull())
+        return render(shapes, QSize(maxSide, maxSide), QRectF(0, 0, 1, 1), background, threads);
+
+    bounds.adjust(-MARGIN, -MARGIN, MARGIN, MARGIN);
+    const double scale = maxSide / qMax(bounds.width(), bounds.height());
+    const QSize size(qMax(1, qRound(bounds.width() * scale)), qMax(1, qRound(bounds.height() * scale)));
+    return render(shapes, size, bounds, background, threads);
+}
+
+QRectF Rasterizer::sceneBounds(const QVector<Shape>& shapes)
+{
+    double left = std::numeric_limits<double>::max();
+    double top = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest();
+    double bottom = std::numeric_limits<double>::lowest();
+    QVector<QPointF> local;
+    QVector<QPointF> world;
+    for (const Shape& shape : shapes) {
+        if (!shape.isVisible())
+            continue;
+        local = shape.vertices();
+        world.resize(local.size());
+        shape.transformVertices(local.constData(), world.data(), local.size());
+        for (const QPointF& point : std::as_const(world)) {
+            left = qMin(left, point.x());
+            top = qMin(top, point.y());
+            right = qMax(right, point.x());
+            bottom = qMax(bottom, point.y());
+        }
+    }
+    return left <= right ? QRectF(QPointF(left, top), QPointF(right, bottom)) : QRectF();
+}
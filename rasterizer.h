@@ -0,0 +1,53 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <QColor>
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+#include "scenesnapshot.h"
+#include "shape.h"
+
+// Программная растеризация сцены в QImage без сцены Qt Quick и GPU
+// (миниатюры и PNG на сборочных агентах). Фигуры переводятся в пиксели
+// теми же вершинами, что Shape::transformVertices, раскладываются по
+// плиткам TileSize x TileSize, и плитки заливаются параллельно: каждая
+// плитка пишет только свои пиксели, поэтому потоки не синхронизируются.
+//
+// Сглаживание — точная площадь покрытия пикселя: рёбра многоугольника
+// накапливают знаковую площадь в буфер плитки, префиксная сумма по
+// строке даёт покрытие. Для простых многоугольников оно точное, у
+// самопересекающихся приближённое в пикселях у точек пересечения.
+// Фигуры накладываются в порядке отрисовки с прозрачностью Shape::FillAlpha.
+//
+// Записи снимка сцены рисуются вместе с обводкой, как на холсте: так
+// заполняются плитки TileCache.
+class Rasterizer
+{
+public:
+    static constexpr int TileSize = 64;
+    // Цвет обводки — QColor::darker с этим коэффициентом, как на холсте
+    static constexpr int OutlineDarkness = 170;
+
+    // Рисует видимые фигуры поверх image. viewport — мировой
+    // прямоугольник, вписываемый в изображение с сохранением пропорций
+    // и по центру. threads = 0 — по числу ядер.
+    static void render(const QVector<Shape>& shapes, const QRectF& viewport, QImage& image, int threads = 0);
+    static QImage render(const QVector<Shape>& shapes, const QSize& size, const QRectF& viewport,
+                         const QColor& background = QColor(Qt::transparent), int threads = 0);
+    // Записи снимка в переданном порядке, видимость не проверяется.
+    // outlineWidth — толщина обводки в пикселях изображения, 0 — без неё.
+    static void render(const QVector<const SceneSnapshot::Entry*>& entries, const QRectF& viewport, QImage& image,
+                       float outlineWidth, int threads = 0);
+
+    // Вся сцена с полями: большая сторона изображения — maxSide, меньшая
+    // по пропорциям рамки фигур
+    static QImage renderScene(const QVector<Shape>& shapes, int maxSide,
+                              const QColor& background = QColor(Qt::transparent), int threads = 0);
+
+    // Рамка видимых фигур в мировых координатах; пустая, если их нет
+    static QRectF sceneBounds(const QVector<Shape>& shapes);
+};
+
+#endif // RASTERIZER_H
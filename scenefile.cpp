@@ -0,0 +1,421 @@
+#include "scenefile.h"
+#include <QHash>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const quint32 MAGIC = 0x43535350; // "PSSC"
+const quint16 VERSION = 1;
+
+enum SectionType : quint32 {
+    IdsSection = 1,
+    PositionXSection,
+    PositionYSection,
+    RotationSection,
+    ScaleSection,
+    SizeSection,
+    SizeWidthSection,
+    SizeHeightSection,
+    SidesSection,
+    FlagsSection,
+    ColorsSection,
+    NameIndexSection,
+    VertexOffsetSection,
+    VertexXSection,
+    VertexYSection,
+    NameOffsetSection,
+    NameDataSection,
+    SectionTypeEnd
+};
+
+struct Header
+{
+    quint32 magic;
+    quint16 version;
+    quint16 sectionCount;
+    quint32 shapeCount;
+    quint32 nameCount;
+    quint32 vertexCount;
+    quint32 nameBytes;
+};
+
+struct Section
+{
+    quint32 type;
+    quint32 elementSize;
+    quint64 offset;
+    quint64 count;
+};
+
+static_assert(sizeof(Header) == 24 && sizeof(Section) == 24, "scene file header layout");
+
+void setError(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+}
+
+qint64 align8(qint64 value)
+{
+    return (value + 7) & ~qint64(7);
+}
+
+// Колонка, подготовленная к записи
+struct Column
+{
+    SectionType type;
+    quint32 elementSize;
+    quint64 count;
+    const void* data;
+};
+
+template<typename T>
+Column column(SectionType type, const QVector<T>& values)
+{
+    return { type, quint32(sizeof(T)), quint64(values.size()), values.constData() };
+}
+
+// Вершины не хранятся, если совпадают с правильным многоугольником:
+// при загрузке они строятся заново
+bool hasRegularVertices(const Shape& shape)
+{
+    if (shape.useCustomVertices())
+        return false;
+    Shape regular = shape;
+    regular.resetVertices();
+    return regular.vertices() == shape.vertices();
+}
+
+} // namespace
+
+SceneFile::~SceneFile()
+{
+    close();
+}
+
+bool SceneFile::save(const QString& path, const QVector<Shape>& shapes, QString* error)
+{
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+        setError(error, QStringLiteral("scene files are only supported on little-endian hosts"));
+        return false;
+    }
+
+    const int count = shapes.size();
+    QVector<qint32> ids(count);
+    QVector<double> positionX(count), positionY(count), rotation(count), scale(count);
+    QVector<double> size(count), sizeWidth(count), sizeHeight(count);
+    QVector<quint8> sides(count), flags(count);
+    QVector<quint32> colors(count), nameIndex(count), vertexOffset(count + 1);
+    QVector<double> vertexX, vertexY;
+    QVector<quint32> nameOffset(1, 0);
+    QByteArray nameData;
+    QHash<QString, quint32> names;
+
+    for (int i = 0; i < count; ++i) {
+        const Shape& shape = shapes[i];
+        ids[i] = shape.id();
+        positionX[i] = shape.position().x();
+        positionY[i] = shape.position().y();
+        rotation[i] = shape.rotation();
+        scale[i] = shape.scale();
+        size[i] = shape.size();
+        sizeWidth[i] = shape.sizeWidth();
+        sizeHeight[i] = shape.sizeHeigth();
+        sides[i] = quint8(shape.sides());
+        colors[i] = shape.color().rgba();
+
+        quint8 shapeFlags = (shape.isVisible() ? Visible : 0) | (shape.collisionsEnabled() ? Collides : 0)
+                            | (shape.useCustomVertices() ? CustomVertices : 0);
+        vertexOffset[i] = quint32(vertexX.size());
+        if (!hasRegularVertices(shape)) {
+            shapeFlags |= StoredVertices;
+            for (const QPointF& vertex : shape.vertices()) {
+                vertexX.append(vertex.x());
+                vertexY.append(vertex.y());
+            }
+            if (vertexX.size() > std::numeric_limits<quint32>::max()) {
+                setError(error, QStringLiteral("too many vertices for a scene file"));
+                return false;
+            }
+        }
+        flags[i] = shapeFlags;
+
+        auto name = names.constFind(shape.name());
+        if (name == names.constEnd()) {
+            name = names.insert(shape.name(), quint32(nameOffset.size() - 1));
+            nameData.append(shape.name().toUtf8());
+            nameOffset.append(quint32(nameData.size()));
+        }
+        nameIndex[i] = name.value();
+    }
+    vertexOffset[count] = quint32(vertexX.size());
+
+    const Column columns[] = {
+        column(IdsSection, ids),
+        column(PositionXSection, positionX),
+        column(PositionYSection, positionY),
+        column(RotationSection, rotation),
+        column(ScaleSection, scale),
+        column(SizeSection, size),
+        column(SizeWidthSection, sizeWidth),
+        column(SizeHeightSection, sizeHeight),
+        column(SidesSection, sides),
+        column(FlagsSection, flags),
+        column(ColorsSection, colors),
+        column(NameIndexSection, nameIndex),
+        column(VertexOffsetSection, vertexOffset),
+        column(VertexXSection, vertexX),
+        column(VertexYSection, vertexY),
+        column(NameOffsetSection, nameOffset),
+        { NameDataSection, 1, quint64(nameData.size()), nameData.constData() },
+    };
+    const int sectionCount = int(sizeof(columns) / sizeof(columns[0]));
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sectionCount = quint16(sectionCount);
+    header.shapeCount = quint32(count);
+    header.nameCount = quint32(nameOffset.size() - 1);
+    header.vertexCount = quint32(vertexX.size());
+    header.nameBytes = quint32(nameData.size());
+
+    QVector<Section> sections(sectionCount);
+    qint64 offset = align8(sizeof(Header) + sectionCount * sizeof(Section));
+    for (int i = 0; i < sectionCount; ++i) {
+        sections[i] = { columns[i].type, columns[i].elementSize, quint64(offset), columns[i].count };
+        offset = align8(offset + qint64(columns[i].count * columns[i].elementSize));
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, file.errorString());
+        return false;
+    }
+
+    static const char padding[8] = {};
+    qint64 written = 0;
+    auto write = [&](const void* data, qint64 bytes) {
+        if (bytes > 0 && file.write(static_cast<const char*>(data), bytes) == bytes)
+            written += bytes;
+    };
+    write(&header, sizeof(Header));
+    write(sections.constData(), sectionCount * qint64(sizeof(Section)));
+    for (int i = 0; i < sectionCount; ++i) {
+        write(padding, qint64(sections[i].offset) - written);
+        write(columns[i].data, qint64(columns[i].count * columns[i].elementSize));
+    }
+    write(padding, offset - written);
+
+    if (written != offset || !file.commit()) {
+        setError(error, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::open(const QString& path, QString* error)
+{
+    close();
+
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+        setError(error, QStringLiteral("scene files are only supported on little-endian hosts"));
+        return false;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        setError(error, m_file.errorString());
+        return false;
+    }
+
+    m_dataSize = m_file.size();
+    m_mapped = m_dataSize > 0 ? m_file.map(0, m_dataSize) : nullptr;
+    if (m_mapped) {
+        m_data = m_mapped;
+    } else {
+        m_buffer = m_file.readAll();
+        m_data = reinterpret_cast<const uchar*>(m_buffer.constData());
+        m_dataSize = m_buffer.size();
+    }
+
+    if (!parse(error)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SceneFile::close()
+{
+    if (m_mapped)
+        m_file.unmap(m_mapped);
+    m_mapped = nullptr;
+    m_file.close();
+    m_buffer.clear();
+    m_data = nullptr;
+    m_dataSize = 0;
+    m_shapeCount = 0;
+    m_nameCount = 0;
+    m_vertexCount = 0;
+    m_nameBytes = 0;
+}
+
+// Проверяется всё, от чего зависит чтение колонок: после parse()
+// доступ по индексу не выходит за файл
+bool SceneFile::parse(QString* error)
+{
+    if (m_dataSize < qint64(sizeof(Header))) {
+        setError(error, QStringLiteral("not a scene file"));
+        return false;
+    }
+
+    Header header;
+    memcpy(&header, m_data, sizeof(Header));
+    if (header.magic != MAGIC || header.version != VERSION) {
+        setError(error, QStringLiteral("not a scene file or unsupported version"));
+        return false;
+    }
+    if (header.shapeCount > quint32(std::numeric_limits<int>::max() - 1)
+        || header.nameCount > quint32(std::numeric_limits<int>::max() - 1)) {
+        setError(error, QStringLiteral("corrupted scene file header"));
+        return false;
+    }
+
+    const qint64 tableEnd = qint64(sizeof(Header)) + header.sectionCount * qint64(sizeof(Section));
+    if (tableEnd > m_dataSize) {
+        setError(error, QStringLiteral("truncated scene file"));
+        return false;
+    }
+
+    const void* found[SectionTypeEnd] = {};
+    for (int i = 0; i < header.sectionCount; ++i) {
+        Section section;
+        memcpy(&section, m_data + sizeof(Header) + i * sizeof(Section), sizeof(Section));
+        if (section.type == 0 || section.type >= SectionTypeEnd)
+            continue;
+
+        const quint64 bytes = section.count * section.elementSize;
+        if (section.elementSize == 0 || section.offset % section.elementSize != 0
+            || section.count > quint64(m_dataSize) || section.offset > quint64(m_dataSize)
+            || bytes > quint64(m_dataSize) - section.offset) {
+            setError(error, QStringLiteral("corrupted scene file section %1").arg(section.type));
+            return false;
+        }
+        found[section.type] = m_data + section.offset;
+
+        const quint64 shapes = header.shapeCount;
+        quint64 expectedCount = shapes;
+        quint32 expectedSize = 8;
+        switch (section.type) {
+        case IdsSection: case ColorsSection: case NameIndexSection: expectedSize = 4; break;
+        case SidesSection: case FlagsSection: expectedSize = 1; break;
+        case VertexOffsetSection: expectedSize = 4; expectedCount = shapes + 1; break;
+        case VertexXSection: case VertexYSection: expectedCount = header.vertexCount; break;
+        case NameOffsetSection: expectedSize = 4; expectedCount = quint64(header.nameCount) + 1; break;
+        case NameDataSection: expectedSize = 1; expectedCount = header.nameBytes; break;
+        default: break;
+        }
+        if (section.elementSize != expectedSize || section.count != expectedCount) {
+            setError(error, QStringLiteral("corrupted scene file section %1").arg(section.type));
+            return false;
+        }
+    }
+
+    for (int type = IdsSection; type < SectionTypeEnd; ++type) {
+        if (!found[type]) {
+            setError(error, QStringLiteral("scene file section %1 is missing").arg(type));
+            return false;
+        }
+    }
+
+    m_shapeCount = int(header.shapeCount);
+    m_nameCount = int(header.nameCount);
+    m_vertexCount = header.vertexCount;
+    m_nameBytes = header.nameBytes;
+    m_ids = static_cast<const qint32*>(found[IdsSection]);
+    m_positionX = static_cast<const double*>(found[PositionXSection]);
+    m_positionY = static_cast<const double*>(found[PositionYSection]);
+    m_rotation = static_cast<const double*>(found[RotationSection]);
+    m_scale = static_cast<const double*>(found[ScaleSection]);
+    m_size = static_cast<const double*>(found[SizeSection]);
+    m_sizeWidth = static_cast<const double*>(found[SizeWidthSection]);
+    m_sizeHeight = static_cast<const double*>(found[SizeHeightSection]);
+    m_sides = static_cast<const quint8*>(found[SidesSection]);
+    m_flags = static_cast<const quint8*>(found[FlagsSection]);
+    m_colors = static_cast<const quint32*>(found[ColorsSection]);
+    m_nameIndex = static_cast<const quint32*>(found[NameIndexSection]);
+    m_vertexOffset = static_cast<const quint32*>(found[VertexOffsetSection]);
+    m_vertexX = static_cast<const double*>(found[VertexXSection]);
+    m_vertexY = static_cast<const double*>(found[VertexYSection]);
+    m_nameOffset = static_cast<const quint32*>(found[NameOffsetSection]);
+    m_nameData = static_cast<const char*>(found[NameDataSection]);
+    return true;
+}
+
+QString SceneFile::name(int nameIndex) const
+{
+    if (nameIndex < 0 || nameIndex >= m_nameCount)
+        return QString();
+    const quint32 begin = m_nameOffset[nameIndex];
+    const quint32 end = m_nameOffset[nameIndex + 1];
+    if (begin > end || end > m_nameBytes)
+        return QString();
+    return QString::fromUtf8(m_nameData + begin, end - begin);
+}
+
+Shape SceneFile::shape(int index) const
+{
+    if (index < 0 || index >= m_shapeCount)
+        return Shape();
+    return makeShape(index, name(int(m_nameIndex[index])));
+}
+
+// Имена декодируются один раз, фигуры разделяют строки неявно
+QVector<Shape> SceneFile::shapes() const
+{
+    QVector<QString> names(m_nameCount);
+    for (int i = 0; i < m_nameCount; ++i)
+        names[i] = name(i);
+
+    QVector<Shape> result;
+    result.reserve(m_shapeCount);
+    for (int i = 0; i < m_shapeCount; ++i) {
+        const quint32 nameIndex = m_nameIndex[i];
+        result.append(makeShape(i, nameIndex < quint32(m_nameCount) ? names[nameIndex] : QString()));
+    }
+    return result;
+}
+
+// Тот же порядок установки полей, что и в operator>>(QDataStream&, Shape&)
+Shape SceneFile::makeShape(int index, const QString& name) const
+{
+    const quint8 shapeFlags = m_flags[index];
+
+    Shape shape(m_ids[index], QPointF(m_positionX[index], m_positionY[index]), m_sizeWidth[index],
+                m_sizeHeight[index]);
+    shape.setName(name);
+    shape.setColor(QColor::fromRgba(m_colors[index]));
+    shape.setSides(m_sides[index]);
+    shape.setSize(m_size[index]);
+    shape.setRotation(m_rotation[index]);
+    shape.setScale(m_scale[index]);
+    shape.setVisible(shapeFlags & Visible);
+    shape.setCollisionsEnabled(shapeFlags & Collides);
+
+    const quint32 begin = m_vertexOffset[index];
+    const quint32 end = m_vertexOffset[index + 1];
+    if ((shapeFlags & StoredVertices) && begin <= end && end <= m_vertexCount) {
+        QVector<QPointF> vertices(int(end - begin));
+        for (quint32 i = begin; i < end; ++i)
+            vertices[int(i - begin)] = QPointF(m_vertexX[i], m_vertexY[i]);
+        shape.setVertices(vertices);
+    } else {
+        shape.updateVertices(shape.sides(), shape.size());
+    }
+    shape.setUseCustomVertices(shapeFlags & CustomVertices);
+    return shape;
+}
@@ -0,0 +1,102 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include "shape.h"
+
+// Двоичный файл сцены. Поля фигур лежат колонками (SoA) фиксированной
+// ширины, выровненными на 8 байт, поэтому файл отображается в память
+// (QFile::map) и читается без разбора и копирования: колонки доступны
+// как массивы прямо в отображении, фигура i — по индексу без поиска.
+//
+// Формат (little-endian, версия 1):
+//   Header — магия "PSSC", версия, число секций, фигур, имён, вершин;
+//   таблица секций — тип, размер элемента, смещение, число элементов;
+//   секции: id, положение, поворот, масштаб, размеры, число сторон,
+//   флаги, цвет (ARGB), индекс имени, смещения вершин (n + 1),
+//   вершины X/Y (только для фигур, чьи вершины не совпадают с
+//   правильным многоугольником), смещения имён (m + 1) и имена в UTF-8.
+// Имена интернированы: одинаковые хранятся один раз. Неизвестные
+// секции пропускаются, так что новые колонки не ломают старые версии.
+class SceneFile
+{
+public:
+    enum ShapeFlag : quint8 {
+        Visible = 0x1,
+        Collides = 0x2,
+        CustomVertices = 0x4,
+        StoredVertices = 0x8
+    };
+
+    SceneFile() = default;
+    ~SceneFile();
+
+    SceneFile(const SceneFile&) = delete;
+    SceneFile& operator=(const SceneFile&) = delete;
+
+    static bool save(const QString& path, const QVector<Shape>& shapes, QString* error = nullptr);
+
+    bool open(const QString& path, QString* error = nullptr);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    bool isMapped() const { return m_mapped != nullptr; }
+
+    int shapeCount() const { return m_shapeCount; }
+    int nameCount() const { return m_nameCount; }
+
+    // Колонки смотрят в отображение и живут до close()
+    const qint32* ids() const { return m_ids; }
+    const double* positionsX() const { return m_positionX; }
+    const double* positionsY() const { return m_positionY; }
+    const double* rotations() const { return m_rotation; }
+    const double* scales() const { return m_scale; }
+    const double* sizes() const { return m_size; }
+    const double* sizeWidths() const { return m_sizeWidth; }
+    const double* sizeHeights() const { return m_sizeHeight; }
+    const quint8* sides() const { return m_sides; }
+    const quint8* flags() const { return m_flags; }
+    const quint32* colors() const { return m_colors; }
+    const quint32* nameIndices() const { return m_nameIndex; }
+
+    QString name(int nameIndex) const;
+    Shape shape(int index) const;
+    QVector<Shape> shapes() const;
+
+private:
+    bool parse(QString* error);
+    Shape makeShape(int index, const QString& name) const;
+
+    QFile m_file;
+    uchar* m_mapped = nullptr;
+    // Если отображение недоступно, файл читается целиком
+    QByteArray m_buffer;
+    const uchar* m_data = nullptr;
+    qint64 m_dataSize = 0;
+
+    int m_shapeCount = 0;
+    int m_nameCount = 0;
+    quint32 m_vertexCount = 0;
+    quint32 m_nameBytes = 0;
+    const qint32* m_ids = nullptr;
+    const double* m_positionX = nullptr;
+    const double* m_positionY = nullptr;
+    const double* m_rotation = nullptr;
+    const double* m_scale = nullptr;
+    const double* m_size = nullptr;
+    const double* m_sizeWidth = nullptr;
+    const double* m_sizeHeight = nullptr;
+    const quint8* m_sides = nullptr;
+    const quint8* m_flags = nullptr;
+    const quint32* m_colors = nullptr;
+    const quint32* m_nameIndex = nullptr;
+    const quint32* m_vertexOffset = nullptr;
+    const double* m_vertexX = nullptr;
+    const double* m_vertexY = nullptr;
+    const quint32* m_nameOffset = nullptr;
+    const char* m_nameData = nullptr;
+};
+
+#endif // SCENEFILE_H
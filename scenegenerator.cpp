@@ -0,0 +1,114 @@
+#include "scenegenerator.h"
+#include <QRandomGenerator>
+#include <cmath>
+
+namespace {
+
+const double PI = 3.141592653589793;
+
+double uniform(QRandomGenerator& random, double min, double max)
+{
+    return min + random.generateDouble() * (max - min);
+}
+
+// Преобразование Бокса — Мюллера: std::normal_distribution не гарантирует
+// одинаковую последовательность на разных стандартных библиотеках
+double normal(QRandomGenerator& random, double sigma)
+{
+    const double u1 = 1.0 - random.generateDouble();
+    const double u2 = random.generateDouble();
+    return sigma * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * u2);
+}
+
+QVector<QPointF> starVertices(QRandomGenerator& random, double outerRadius)
+{
+    const int points = random.bounded(3, 11);
+    const double innerRadius = outerRadius * uniform(random, 0.35, 0.7);
+
+    QVector<QPointF> vertices;
+    vertices.reserve(points * 2);
+    for (int i = 0; i < points * 2; ++i) {
+        const double angle = PI * i / points - PI / 2.0;
+        const double radius = (i % 2 == 0) ? outerRadius : innerRadius;
+        vertices.append(QPointF(std::cos(angle) * radius, std::sin(angle) * radius));
+    }
+    return vertices;
+}
+
+} // namespace
+
+QVector<Shape> SceneGenerator::generate(const Options& options)
+{
+    QVector<Shape> shapes;
+    if (options.count <= 0)
+        return shapes;
+    shapes.reserve(options.count);
+
+    QRandomGenerator random(options.seed);
+
+    double extent = std::sqrt(double(options.count)) * options.spacing;
+    if (options.distribution == Overlapping)
+        extent *= 0.25;
+
+    QVector<QPointF> clusters;
+    double clusterSigma = 0.0;
+    if (options.distribution == Clustered) {
+        const int clusterCount = qMax(1, options.count / 500);
+        for (int i = 0; i < clusterCount; ++i)
+            clusters.append(QPointF(uniform(random, 0, extent), uniform(random, 0, extent)));
+        clusterSigma = extent / (4.0 * std::sqrt(double(clusterCount)));
+    }
+
+    for (int id = 0; id < options.count; ++id) {
+        QPointF position;
+        if (options.distribution == Clustered) {
+            const QPointF& center = clusters[random.bounded(int(clusters.size()))];
+            position = center + QPointF(normal(random, clusterSigma), normal(random, clusterSigma));
+        } else {
+            position = QPointF(uniform(random, 0, extent), uniform(random, 0, extent));
+        }
+
+        double size;
+        if (options.distribution == MixedSize)
+            size = std::exp(uniform(random, std::log(10.0), std::log(400.0)));
+        else
+            size = uniform(random, 20.0, 60.0);
+
+        const int sides = random.bounded(3, 21);
+        const double rotation = uniform(random, 0.0, 360.0);
+        const double aspect = uniform(random, 0.6, 1.0);
+        const bool concave = random.generateDouble() < options.concaveRatio;
+
+        Shape shape(id, position, size, size * aspect);
+        shape.setSides(sides);
+        shape.updateVertices(sides, size);
+        if (concave)
+            shape.setVertices(starVertices(random, size));
+        shape.setRotation(rotation);
+        shapes.append(shape);
+    }
+
+    return shapes;
+}
+
+QString SceneGenerator::distributionName(Distribution distribution)
+{
+    switch (distribution) {
+    case Uniform: return QStringLiteral("uniform");
+    case Clustered: return QStringLiteral("clustered");
+    case Overlapping: return QStringLiteral("overlapping");
+    case MixedSize: return QStringLiteral("mixed");
+    }
+    return QString();
+}
+
+bool SceneGenerator::distributionFromName(const QString& name, Distribution* distribution)
+{
+    for (Distribution candidate : { Uniform, Clustered, Overlapping, MixedSize }) {
+        if (name == distributionName(candidate)) {
+            *distribution = candidate;
+            return true;
+        }
+    }
+    return false;
+}
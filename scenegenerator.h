@@ -0,0 +1,37 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <QString>
+#include <QVector>
+#include "shape.h"
+
+// Детерминированный генератор синтетических сцен для бенчмарков и
+// нагрузочных проверок. Одинаковые Options (включая seed) дают одинаковую
+// сцену на любой платформе. Id фигур идут подряд с нуля; при вставке в
+// холст они переназначаются.
+class SceneGenerator
+{
+public:
+    enum Distribution {
+        Uniform,      // равномерно по квадратной области
+        Clustered,    // нормальные облака вокруг случайных центров
+        Overlapping,  // плотная область, большинство фигур пересекается
+        MixedSize     // равномерно, размеры от мелких до крупных (лог-шкала)
+    };
+
+    struct Options
+    {
+        int count = 1000;
+        quint32 seed = 1;
+        Distribution distribution = Uniform;
+        double concaveRatio = 0.0;  // доля невыпуклых фигур-звёзд, 0..1
+        double spacing = 120.0;     // средний шаг между фигурами (Uniform)
+    };
+
+    static QVector<Shape> generate(const Options& options);
+
+    static QString distributionName(Distribution distribution);
+    static bool distributionFromName(const QString& name, Distribution* distribution);
+};
+
+#endif // SCENEGENERATOR_H
@@ -0,0 +1,819 @@
+#include "sceneimport.h"
+#include <QColor>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Блок элементов на одну задачу пула: меньше — накладные расходы
+// заметнее самого разбора
+const int MIN_CHUNK_ELEMENTS = 512;
+
+// Пределы размеров фигуры, как в Shape::setSizeWidth/setSizeHeigth
+const double MIN_SHAPE_SIZE = 10.0;
+const double MAX_SHAPE_SIZE = 10000.0;
+// Допустимое значение поля «Стороны», как в Shape::setSides
+const int MIN_SIDES = 3;
+const int MAX_SIDES = 20;
+
+const char* const HIDDEN_CONTAINERS[] = { "defs", "clipPath", "mask", "symbol", "pattern", "marker" };
+
+void setError(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+}
+
+// Элемент входа: [begin, end) в байтах от начала данных
+struct Span
+{
+    qsizetype begin = 0;
+    qsizetype end = 0;
+};
+
+struct Element
+{
+    QVector<QPointF> points;
+    QColor color;
+    QString name;
+};
+
+struct Parser
+{
+    const char* base = nullptr;
+    qsizetype errorOffset = -1;
+    QString error;
+
+    bool fail(const char* at, const char* message)
+    {
+        errorOffset = at - base;
+        error = QString::fromLatin1(message);
+        return false;
+    }
+
+    QString describe() const
+    {
+        return QStringLiteral("%1 at byte %2").arg(error).arg(errorOffset);
+    }
+};
+
+struct Chunk
+{
+    int first = 0;
+    int last = 0;
+    QVector<Shape> shapes;
+    qint64 vertices = 0;
+    int skipped = 0;
+    int oversized = 0;
+    Parser parser;
+};
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+const char* skipSpace(const char* p, const char* end)
+{
+    while (p < end && isSpace(*p))
+        ++p;
+    return p;
+}
+
+bool is(QByteArrayView text, const char* literal)
+{
+    const qsizetype length = qsizetype(std::strlen(literal));
+    return text.size() == length && std::memcmp(text.data(), literal, size_t(length)) == 0;
+}
+
+bool startsWith(const char* p, const char* end, const char* literal)
+{
+    const qsizetype length = qsizetype(std::strlen(literal));
+    return end - p >= length && std::memcmp(p, literal, size_t(length)) == 0;
+}
+
+const char* find(const char* p, const char* end, const char* literal)
+{
+    const char* found = std::search(p, end, literal, literal + std::strlen(literal));
+    return found == end ? nullptr : found;
+}
+
+// Число в синтаксисе SVG/JSON, без учёта локали. Если мантисса
+// укладывается в 53 бита, а порядок — в ±22, результат точен и
+// считается одним умножением или делением; иначе — общий разбор Qt.
+// Возвращает конец числа или nullptr, если числа нет.
+const char* parseNumber(const char* p, const char* end, double* value)
+{
+    static const double POWERS[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* begin = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool any = false;
+    for (; p < end && isDigit(*p); ++p) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + quint64(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+            truncated = true;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + quint64(*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            } else {
+                truncated = true;
+            }
+        }
+    }
+    if (!any)
+        return nullptr;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            ++q;
+        }
+        if (q < end && isDigit(*q)) {
+            int power = 0;
+            for (; q < end && isDigit(*q); ++q)
+                power = qMin(power * 10 + (*q - '0'), 100000);
+            exponent += negativeExponent ? -power : power;
+            p = q;
+        }
+    }
+
+    if (!truncated && mantissa <= (quint64(1) << 53) && exponent >= -22 && exponent <= 22) {
+        const double result = exponent < 0 ? double(mantissa) / POWERS[-exponent] : double(mantissa) * POWERS[exponent];
+        *value = negative ? -result : result;
+        return p;
+    }
+
+    if (*begin == '+')
+        ++begin;
+    bool ok = false;
+    *value = QByteArrayView(begin, p - begin).toDouble(&ok);
+    return ok ? p : nullptr;
+}
+
+// Пары координат через пробелы и/или запятые; непарная последняя
+// координата отбрасывается
+bool parseCoordinates(Parser& parser, const char* p, const char* end, QVector<QPointF>* points)
+{
+    double x = 0.0;
+    bool haveX = false;
+    for (;;) {
+        while (p < end && (isSpace(*p) || *p == ','))
+            ++p;
+        if (p >= end)
+            return true;
+
+        double value = 0.0;
+        const char* next = parseNumber(p, end, &value);
+        if (!next)
+            return parser.fail(p, "invalid number");
+        p = next;
+        if (haveX)
+            points->append(QPointF(x, value));
+        else
+            x = value;
+        haveX = !haveX;
+    }
+}
+
+QColor parseColor(QByteArrayView value)
+{
+    const QByteArrayView text = value.trimmed();
+    return QColor::fromString(QLatin1StringView(text.data(), text.size()));
+}
+
+// fill внутри style="...; fill: #rrggbb; ..."
+QColor parseStyleFill(QByteArrayView style)
+{
+    QColor color;
+    const char* p = style.data();
+    const char* const end = p + style.size();
+    while (p < end) {
+        const char* declarationEnd = std::find(p, end, ';');
+        const char* colon = std::find(p, declarationEnd, ':');
+        if (colon != declarationEnd && is(QByteArrayView(p, colon - p).trimmed(), "fill"))
+            color = parseColor(QByteArrayView(colon + 1, declarationEnd - colon - 1));
+        p = declarationEnd + (declarationEnd < end);
+    }
+    return color;
+}
+
+// ---------------------------------------------------------------- SVG
+
+// Имя тега сразу после '<', за которым идёт пробел, '/' или '>'
+bool tagIs(const char* p, const char* end, const char* name)
+{
+    const qsizetype length = qsizetype(std::strlen(name));
+    if (end - p <= length || std::memcmp(p, name, size_t(length)) != 0)
+        return false;
+    const char next = p[length];
+    return isSpace(next) || next == '/' || next == '>';
+}
+
+// Последовательный проход: только поиск '<' и имён тегов. Символ '<'
+// внутри значений атрибутов в XML запрещён, поэтому кавычки можно не
+// отслеживать.
+bool scanSvg(Parser& parser, QByteArrayView data, QVector<Span>* spans)
+{
+    const char* const end = data.data() + data.size();
+    const char* p = data.data();
+    int hidden = 0;
+    while (p < end && (p = static_cast<const char*>(std::memchr(p, '<', size_t(end - p))))) {
+        const char* tag = p + 1;
+        if (startsWith(tag, end, "!--")) {
+            const char* close = find(tag + 3, end, "-->");
+            if (!close)
+                return parser.fail(p, "unterminated comment");
+            p = close + 3;
+            continue;
+        }
+        if (startsWith(tag, end, "![CDATA[")) {
+            const char* close = find(tag + 8, end, "]]>");
+            if (!close)
+                return parser.fail(p, "unterminated CDATA section");
+            p = close + 3;
+            continue;
+        }
+
+        if (tag < end && *tag == '/') {
+            for (const char* container : HIDDEN_CONTAINERS) {
+                if (tagIs(tag + 1, end, container))
+                    hidden = qMax(0, hidden - 1);
+            }
+            p = tag;
+            continue;
+        }
+
+        bool container = false;
+        for (const char* name : HIDDEN_CONTAINERS)
+            container = container || tagIs(tag, end, name);
+        if (container) {
+            const char* close = static_cast<const char*>(std::memchr(tag, '>', size_t(end - tag)));
+            if (!close)
+                return parser.fail(p, "unterminated element");
+            // <defs/> ничего не скрывает
+            if (close[-1] != '/')
+                ++hidden;
+            p = close + 1;
+            continue;
+        }
+
+        if (hidden == 0 && (tagIs(tag, end, "polygon") || tagIs(tag, end, "polyline") || tagIs(tag, end, "rect"))) {
+            Span span;
+            span.begin = p - data.data();
+            spans->append(span);
+        }
+        p = tag;
+    }
+
+    // Элемент заканчивается не позже начала следующего
+    for (int i = 0; i < spans->size(); ++i)
+        (*spans)[i].end = i + 1 < spans->size() ? (*spans)[i + 1].begin : data.size();
+    return true;
+}
+
+// Потоковый разбор одного тега: атрибуты читаются по очереди, значения —
+// срезы входа без копирования
+bool parseSvgElement(Parser& parser, const char* p, const char* end, Element* element)
+{
+    const char* nameBegin = ++p;
+    while (p < end && !isSpace(*p) && *p != '/' && *p != '>')
+        ++p;
+    const bool rect = is(QByteArrayView(nameBegin, p - nameBegin), "rect");
+
+    double x = 0.0, y = 0.0, width = 0.0, height = 0.0;
+    const char* points = nullptr;
+    const char* pointsEnd = nullptr;
+    QColor styleFill;
+
+    for (;;) {
+        p = skipSpace(p, end);
+        if (p >= end)
+            return parser.fail(p, "unterminated element");
+        if (*p == '>' || *p == '/')
+            break;
+
+        const char* attributeBegin = p;
+        while (p < end && *p != '=' && !isSpace(*p) && *p != '>' && *p != '/')
+            ++p;
+        const QByteArrayView attribute(attributeBegin, p - attributeBegin);
+        p = skipSpace(p, end);
+        if (p >= end || *p != '=')
+            return parser.fail(p, "expected '=' after attribute name");
+        p = skipSpace(p + 1, end);
+        if (p >= end || (*p != '"' && *p != '\''))
+            return parser.fail(p, "expected quoted attribute value");
+        const char quote = *p++;
+        const char* valueEnd = static_cast<const char*>(std::memchr(p, quote, size_t(end - p)));
+        if (!valueEnd)
+            return parser.fail(p, "unterminated attribute value");
+        const QByteArrayView value(p, valueEnd - p);
+        p = valueEnd + 1;
+
+        if (is(attribute, "points")) {
+            points = value.data();
+            pointsEnd = value.data() + value.size();
+        } else if (is(attribute, "fill")) {
+            element->color = parseColor(value);
+        } else if (is(attribute, "style")) {
+            styleFill = parseStyleFill(value);
+        } else if (rect) {
+            double* target = is(attribute, "x") ? &x
+                           : is(attribute, "y") ? &y
+                           : is(attribute, "width") ? &width
+                           : is(attribute, "height") ? &height
+                           : nullptr;
+            const char* valueBegin = skipSpace(value.data(), value.data() + value.size());
+            if (target && !parseNumber(valueBegin, value.data() + value.size(), target))
+                return parser.fail(valueBegin, "invalid number");
+        }
+    }
+
+    // Как и в CSS, style важнее атрибута
+    if (styleFill.isValid())
+        element->color = styleFill;
+
+    if (rect) {
+        if (width > 0.0 && height > 0.0) {
+            element->points.append(QPointF(x, y));
+            element->points.append(QPointF(x + width, y));
+            element->points.append(QPointF(x + width, y + height));
+            element->points.append(QPointF(x, y + height));
+        }
+        return true;
+    }
+    return !points || parseCoordinates(parser, points, pointsEnd, &element->points);
+}
+
+// --------------------------------------------------------------- JSON
+
+const char* skipString(Parser& parser, const char* p, const char* end)
+{
+    const char* begin = p++;
+    while (p < end) {
+        if (*p == '\\')
+            p += 2;
+        else if (*p == '"')
+            return p + 1;
+        else
+            ++p;
+    }
+    parser.fail(begin, "unterminated string");
+    return nullptr;
+}
+
+const char* skipValue(Parser& parser, const char* p, const char* end)
+{
+    if (p >= end) {
+        parser.fail(p, "unexpected end of input");
+        return nullptr;
+    }
+    if (*p == '"')
+        return skipString(parser, p, end);
+
+    if (*p == '{' || *p == '[') {
+        const char* begin = p;
+        int depth = 0;
+        while (p < end) {
+            const char c = *p;
+            if (c == '"') {
+                p = skipString(parser, p, end);
+                if (!p)
+                    return nullptr;
+                continue;
+            }
+            if (c == '{' || c == '[')
+                ++depth;
+            else if ((c == '}' || c == ']') && --depth == 0)
+                return p + 1;
+            ++p;
+        }
+        parser.fail(begin, "unterminated array or object");
+        return nullptr;
+    }
+
+    const char* begin = p;
+    while (p < end && !isSpace(*p) && *p != ',' && *p != ']' && *p != '}')
+        ++p;
+    if (p == begin) {
+        parser.fail(p, "unexpected character");
+        return nullptr;
+    }
+    return p;
+}
+
+QString decodeString(const char* p, const char* end)
+{
+    if (std::find(p, end, '\\') == end)
+        return QString::fromUtf8(p, end - p);
+
+    QString result;
+    while (p < end) {
+        const char* escape = std::find(p, end, '\\');
+        result += QString::fromUtf8(p, escape - p);
+        if (escape + 1 >= end)
+            break;
+        p = escape + 2;
+        switch (escape[1]) {
+        case 'n': result += QLatin1Char('\n'); break;
+        case 't': result += QLatin1Char('\t'); break;
+        case 'r': result += QLatin1Char('\r'); break;
+        case 'b': result += QLatin1Char('\b'); break;
+        case 'f': result += QLatin1Char('\f'); break;
+        case 'u':
+            // Суррогатные пары собираются сами: QString хранит UTF-16
+            if (end - p >= 4) {
+                bool ok = false;
+                const ushort code = QByteArrayView(p, 4).toUShort(&ok, 16);
+                if (ok)
+                    result += QChar(char16_t(code));
+                p += 4;
+            }
+            break;
+        default: result += QLatin1Char(escape[1]); break;
+        }
+    }
+    return result;
+}
+
+// [x0, y0, x1, y1, ...] или [[x0, y0], [x1, y1], ...]
+const char* parseJsonPoints(Parser& parser, const char* p, const char* end, QVector<QPointF>* points)
+{
+    if (p >= end || *p != '[') {
+        parser.fail(p, "expected points array");
+        return nullptr;
+    }
+    p = skipSpace(p + 1, end);
+    if (p < end && *p == ']')
+        return p + 1;
+
+    double x = 0.0;
+    bool haveX = false;
+    for (;;) {
+        if (p < end && *p == '[') {
+            double pair[2];
+            p = skipSpace(p + 1, end);
+            for (int i = 0; i < 2; ++i) {
+                const char* next = parseNumber(p, end, &pair[i]);
+                if (!next) {
+                    parser.fail(p, "invalid number");
+                    return nullptr;
+                }
+                p = skipSpace(next, end);
+                if (p >= end || *p != (i == 0 ? ',' : ']')) {
+                    parser.fail(p, i == 0 ? "expected ',' in point" : "expected ']' after point");
+                    return nullptr;
+                }
+                p = skipSpace(p + 1, end);
+            }
+            points->append(QPointF(pair[0], pair[1]));
+        } else {
+            double value = 0.0;
+            const char* next = parseNumber(p, end, &value);
+            if (!next) {
+                parser.fail(p, "invalid number");
+                return nullptr;
+            }
+            p = skipSpace(next, end);
+            if (haveX)
+                points->append(QPointF(x, value));
+            else
+                x = value;
+            haveX = !haveX;
+        }
+
+        if (p < end && *p == ',') {
+            p = skipSpace(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == ']')
+            return p + 1;
+        parser.fail(p, "expected ',' or ']' in points");
+        return nullptr;
+    }
+}
+
+bool parseJsonShape(Parser& parser, const char* p, const char* end, Element* element)
+{
+    p = skipSpace(p, end);
+    if (p >= end || *p != '{')
+        return parser.fail(p, "expected shape object");
+    p = skipSpace(p + 1, end);
+    if (p < end && *p == '}')
+        return true;
+
+    for (;;) {
+        if (p >= end || *p != '"')
+            return parser.fail(p, "expected key");
+        const char* keyBegin = p + 1;
+        p = skipString(parser, p, end);
+        if (!p)
+            return false;
+        const QByteArrayView key(keyBegin, p - 1 - keyBegin);
+        p = skipSpace(p, end);
+        if (p >= end || *p != ':')
+            return parser.fail(p, "expected ':'");
+        p = skipSpace(p + 1, end);
+
+        if (is(key, "points")) {
+            p = parseJsonPoints(parser, p, end, &element->points);
+        } else if ((is(key, "color") || is(key, "name")) && p < end && *p == '"') {
+            const char* valueBegin = p + 1;
+            p = skipString(parser, p, end);
+            if (p && is(key, "color"))
+                element->color = parseColor(QByteArrayView(valueBegin, p - 1 - valueBegin));
+            else if (p)
+                element->name = decodeString(valueBegin, p - 1);
+        } else {
+            p = skipValue(parser, p, end);
+        }
+        if (!p)
+            return false;
+
+        p = skipSpace(p, end);
+        if (p < end && *p == ',') {
+            p = skipSpace(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == '}')
+            return true;
+        return parser.fail(p, "expected ',' or '}'");
+    }
+}
+
+const char* scanJsonArray(Parser& parser, const char* p, const char* end, QVector<Span>* spans)
+{
+    if (p >= end || *p != '[') {
+        parser.fail(p, "expected shapes array");
+        return nullptr;
+    }
+    p = skipSpace(p + 1, end);
+    if (p < end && *p == ']')
+        return p + 1;
+
+    for (;;) {
+        Span span;
+        span.begin = p - parser.base;
+        p = skipValue(parser, p, end);
+        if (!p)
+            return nullptr;
+        span.end = p - parser.base;
+        spans->append(span);
+
+        p = skipSpace(p, end);
+        if (p < end && *p == ',') {
+            p = skipSpace(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == ']')
+            return p + 1;
+        parser.fail(p, "expected ',' or ']'");
+        return nullptr;
+    }
+}
+
+// Последовательный проход находит границы фигур в массиве; сами фигуры
+// пропускаются по скобкам, без разбора чисел
+bool scanJson(Parser& parser, QByteArrayView data, QVector<Span>* spans)
+{
+    const char* const end = data.data() + data.size();
+    const char* p = skipSpace(data.data(), end);
+    if (p < end && *p == '[')
+        return scanJsonArray(parser, p, end, spans) != nullptr;
+    if (p >= end || *p != '{')
+        return parser.fail(p, "expected JSON array or object");
+
+    p = skipSpace(p + 1, end);
+    if (p < end && *p == '}')
+        return true;
+    for (;;) {
+        if (p >= end || *p != '"')
+            return parser.fail(p, "expected key");
+        const char* keyBegin = p + 1;
+        p = skipString(parser, p, end);
+        if (!p)
+            return false;
+        const QByteArrayView key(keyBegin, p - 1 - keyBegin);
+        p = skipSpace(p, end);
+        if (p >= end || *p != ':')
+            return parser.fail(p, "expected ':'");
+        p = skipSpace(p + 1, end);
+        p = is(key, "shapes") ? scanJsonArray(parser, p, end, spans) : skipValue(parser, p, end);
+        if (!p)
+            return false;
+
+        p = skipSpace(p, end);
+        if (p < end && *p == ',') {
+            p = skipSpace(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == '}')
+            return true;
+        return parser.fail(p, "expected ',' or '}'");
+    }
+}
+
+// ------------------------------------------------------------- Shapes
+
+enum AppendResult { Appended, TooFewPoints, TooManyPoints };
+
+// Положение — центр рамки точек, вершины — локальные относительно него
+AppendResult appendShape(Element& element, QVector<Shape>* shapes)
+{
+    QVector<QPointF>& points = element.points;
+    if (points.size() > 3 && points.first() == points.last())
+        points.removeLast();
+    if (points.size() < 3)
+        return TooFewPoints;
+    if (points.size() > SceneImport::MaxVertices)
+        return TooManyPoints;
+
+    double left = points.first().x(), right = left;
+    double top = points.first().y(), bottom = top;
+    for (const QPointF& point : std::as_const(points)) {
+        left = qMin(left, point.x());
+        right = qMax(right, point.x());
+        top = qMin(top, point.y());
+        bottom = qMax(bottom, point.y());
+    }
+    const QPointF center((left + right) / 2.0, (top + bottom) / 2.0);
+
+    QVector<QPointF> vertices(points.size());
+    for (int i = 0; i < points.size(); ++i)
+        vertices[i] = points[i] - center;
+
+    // Размеры — полуразмеры рамки точек, приведённые к пределам, которые
+    // Shape допускает при правке. Вершины заданы явно, поэтому размеры
+    // на геометрию не влияют: их используют маркеры выделения и поля
+    // панели свойств.
+    const double sizeWidth = qBound(MIN_SHAPE_SIZE, (right - left) / 2.0, MAX_SHAPE_SIZE);
+    const double sizeHeight = qBound(MIN_SHAPE_SIZE, (bottom - top) / 2.0, MAX_SHAPE_SIZE);
+    Shape shape(shapes->size(), center, sizeWidth, sizeHeight);
+    // У импортированного многоугольника sides — только значение поля
+    // «Стороны» (ближайшее допустимое к числу точек); число вершин им
+    // не ограничено, пока фигуру не перестроят сменой сторон
+    shape.setSides(qBound(MIN_SIDES, int(vertices.size()), MAX_SIDES));
+    shape.setVertices(vertices);
+    if (element.color.isValid())
+        shape.setColor(element.color);
+    if (!element.name.isEmpty())
+        shape.setName(element.name);
+    shapes->append(shape);
+    return Appended;
+}
+
+void parseChunk(QByteArrayView data, SceneImport::Format format, const QVector<Span>& spans, Chunk& chunk)
+{
+    chunk.parser.base = data.data();
+    chunk.shapes.reserve(chunk.last - chunk.first);
+    for (int i = chunk.first; i < chunk.last; ++i) {
+        Element element;
+        const char* begin = data.data() + spans[i].begin;
+        const char* end = data.data() + spans[i].end;
+        const bool parsed = format == SceneImport::Svg ? parseSvgElement(chunk.parser, begin, end, &element)
+                                                       : parseJsonShape(chunk.parser, begin, end, &element);
+        if (!parsed)
+            return;
+        switch (appendShape(element, &chunk.shapes)) {
+        case Appended:
+            chunk.vertices += element.points.size();
+            break;
+        case TooFewPoints:
+            ++chunk.skipped;
+            break;
+        case TooManyPoints:
+            ++chunk.oversized;
+            break;
+        }
+    }
+}
+
+} // namespace
+
+SceneImport::Format SceneImport::detectFormat(QByteArrayView data)
+{
+    const char* p = skipSpace(data.data(), data.data() + data.size());
+    if (p == data.data() + data.size())
+        return Auto;
+    if (*p == '{' || *p == '[')
+        return Json;
+    if (*p == '<')
+        return Svg;
+    return Auto;
+}
+
+bool SceneImport::load(const QString& path, QVector<Shape>* shapes, QString* error, Stats* stats, Format format)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, file.errorString());
+        return false;
+    }
+
+    const qint64 size = file.size();
+    uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+    QByteArray buffer;
+    if (!mapped)
+        buffer = file.readAll();
+    const QByteArrayView data = mapped ? QByteArrayView(reinterpret_cast<const char*>(mapped), size)
+                                       : QByteArrayView(buffer);
+
+    const bool parsed = parse(data, format, shapes, error, stats);
+    if (mapped)
+        file.unmap(mapped);
+    return parsed;
+}
+
+bool SceneImport::parse(QByteArrayView data, Format format, QVector<Shape>* shapes, QString* error, Stats* stats)
+{
+    if (format == Auto)
+        format = detectFormat(data);
+    if (format == Auto) {
+        setError(error, QStringLiteral("unknown import format"));
+        return false;
+    }
+
+    Parser scanner;
+    scanner.base = data.data();
+    QVector<Span> spans;
+    const bool scanned = format == Svg ? scanSvg(scanner, data, &spans) : scanJson(scanner, data, &spans);
+    if (!scanned) {
+        setError(error, scanner.describe());
+        return false;
+    }
+
+    const int threads = qMax(1, QThread::idealThreadCount());
+    const int chunkSize = qMax(MIN_CHUNK_ELEMENTS, int(spans.size() / (threads * 4)) + 1);
+    QVector<Chunk> chunks;
+    for (int first = 0; first < spans.size(); first += chunkSize) {
+        Chunk chunk;
+        chunk.first = first;
+        chunk.last = int(qMin<qsizetype>(first + chunkSize, spans.size()));
+        chunks.append(chunk);
+    }
+
+    if (chunks.size() == 1) {
+        parseChunk(data, format, spans, chunks[0]);
+    } else if (chunks.size() > 1) {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        for (Chunk& chunk : chunks)
+            pool.start([&data, format, &spans, &chunk] { parseChunk(data, format, spans, chunk); });
+        pool.waitForDone();
+    }
+
+    Stats total;
+    for (const Chunk& chunk : std::as_const(chunks)) {
+        if (chunk.parser.errorOffset >= 0) {
+            setError(error, chunk.parser.describe());
+            return false;
+        }
+        total.shapes += chunk.shapes.size();
+        total.vertices += chunk.vertices;
+        total.skipped += chunk.skipped;
+        total.oversized += chunk.oversized;
+    }
+
+    shapes->clear();
+    shapes->reserve(total.shapes);
+    for (Chunk& chunk : chunks) {
+        for (Shape& shape : chunk.shapes) {
+            shape.setId(shapes->size());
+            shapes->append(std::move(shape));
+        }
+        chunk.shapes = QVector<Shape>();
+    }
+    if (stats)
+        *stats = total;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef SCENEIMPORT_H
+#define SCENEIMPORT_H
+
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+#include "shape.h"
+
+// Импорт многоугольников из SVG и JSON. Входной файл отображается в
+// память; быстрый последовательный проход находит границы элементов,
+// после чего элементы разбираются блоками в пуле потоков. Каждый
+// элемент читается потоковым разборщиком без построения DOM.
+//
+// SVG: <polygon>, <polyline> (замыкается) и <rect>, цвет — атрибут fill
+// или fill в style. Содержимое <defs>, <clipPath>, <mask>, <symbol>,
+// <pattern> и <marker> пропускается; атрибуты transform не применяются.
+//
+// JSON: массив фигур или объект с массивом "shapes"; фигура —
+//   { "points": [x0, y0, x1, y1, ...] или [[x0, y0], ...],
+//     "color": "#rrggbb", "name": "..." }
+// Неизвестные ключи пропускаются.
+//
+// Точки — мировые координаты. Фигура получает положение в центре
+// рамки точек и локальные вершины относительно него; размеры —
+// полуразмеры рамки в пределах [10, 10000], sides — число точек,
+// приведённое к 3..20 (только для панели свойств). Id идут подряд с
+// нуля; при вставке в холст они переназначаются.
+//
+// Многоугольники больше MaxVertices точек пропускаются и считаются в
+// Stats::oversized: индексы треугольников и обводки 16-битные, а
+// триангуляция отрезанием ушей идёт в потоке GUI и на таких контурах
+// заметно задерживает вставку.
+class SceneImport
+{
+public:
+    enum Format { Auto, Svg, Json };
+
+    // Обводка — 8 вершин на точку контура в 16-битных индексах
+    static constexpr int MaxVertices = 4096;
+
+    struct Stats
+    {
+        int shapes = 0;
+        qint64 vertices = 0;
+        // Элементы с числом точек меньше трёх или пустые прямоугольники
+        int skipped = 0;
+        // Многоугольники больше MaxVertices точек, тоже пропущены
+        int oversized = 0;
+    };
+
+    static bool load(const QString& path, QVector<Shape>* shapes, QString* error = nullptr,
+                     Stats* stats = nullptr, Format format = Auto);
+    static bool parse(QByteArrayView data, Format format, QVector<Shape>* shapes, QString* error = nullptr,
+                      Stats* stats = nullptr);
+
+    static Format detectFormat(QByteArrayView data);
+};
+
+#endif // SCENEIMPORT_H
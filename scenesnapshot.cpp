@@ -0,0 +1,104 @@
+#include "scenesnapshot.h"
+
+void SceneSnapshotBuilder::markDirty(int index)
+{
+    if (index >= 0)
+        m_dirty.append(index);
+}
+
+void SceneSnapshotBuilder::markDirtyFrom(int index)
+{
+    if (index >= 0)
+        m_dirtyFrom = m_dirtyFrom < 0 ? index : qMin(m_dirtyFrom, index);
+}
+
+void SceneSnapshotBuilder::markAllDirty()
+{
+    m_allDirty = true;
+}
+
+bool SceneSnapshotBuilder::hasChanges(int selectedShapeId) const
+{
+    return m_allDirty || m_dirtyFrom >= 0 || !m_dirty.isEmpty() || selectedShapeId != m_selectedShapeId;
+}
+
+std::shared_ptr<const SceneSnapshot> SceneSnapshotBuilder::publish(const QVector<Shape>& shapes, SceneStore& store,
+                                                                   int selectedShapeId)
+{
+    // Смена выделения меняет цвет старой и новой выделенных фигур
+    if (selectedShapeId != m_selectedShapeId) {
+        markDirty(store.indexOf(m_selectedShapeId));
+        markDirty(store.indexOf(selectedShapeId));
+        m_selectedShapeId = selectedShapeId;
+    }
+
+    const int size = shapes.size();
+    const int chunkCount = (size + SceneSnapshot::ChunkSize - 1) / SceneSnapshot::ChunkSize;
+    const int previousCount = m_current ? m_current->chunkCount() : 0;
+
+    QVector<bool> dirtyChunks(chunkCount, m_allDirty || !m_current);
+    for (int chunk = previousCount; chunk < chunkCount; ++chunk)
+        dirtyChunks[chunk] = true;
+    if (m_dirtyFrom >= 0) {
+        for (int chunk = m_dirtyFrom / SceneSnapshot::ChunkSize; chunk < chunkCount; ++chunk)
+            dirtyChunks[chunk] = true;
+    }
+    for (int index : std::as_const(m_dirty)) {
+        if (index < size)
+            dirtyChunks[index / SceneSnapshot::ChunkSize] = true;
+    }
+
+    store.updateWorldVertices();
+
+    auto snapshot = std::make_shared<SceneSnapshot>();
+    snapshot->m_version = m_current ? m_current->m_version + 1 : 1;
+    snapshot->m_size = size;
+    snapshot->m_chunks.reserve(chunkCount);
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        if (!dirtyChunks[chunk]) {
+            snapshot->m_chunks.append(m_current->m_chunks[chunk]);
+            continue;
+        }
+
+        auto page = std::make_shared<SceneSnapshot::Chunk>();
+        const int first = chunk * SceneSnapshot::ChunkSize;
+        const int last = qMin(size, first + SceneSnapshot::ChunkSize);
+        page->entries.resize(last - first);
+        for (int index = first; index < last; ++index)
+            fillEntry(page->entries[index - first], shapes[index], store, index, selectedShapeId);
+        snapshot->m_chunks.append(std::move(page));
+    }
+
+    m_dirty.clear();
+    m_dirtyFrom = -1;
+    m_allDirty = false;
+    m_current = std::move(snapshot);
+    return m_current;
+}
+
+void SceneSnapshotBuilder::fillEntry(SceneSnapshot::Entry& entry, const Shape& shape, const SceneStore& store,
+                                     int index, int selectedShapeId)
+{
+    const int count = store.vertexCount(index);
+    const int indexCount = store.triangleIndexCount(index);
+
+    entry.id = shape.id();
+    entry.visible = shape.isVisible();
+    entry.selected = shape.id() == selectedShapeId;
+    entry.color = shape.color();
+    entry.bounds = store.bounds(index);
+    entry.x = QVector<float>(store.worldVerticesX(index), store.worldVerticesX(index) + count);
+    entry.y = QVector<float>(store.worldVerticesY(index), store.worldVerticesY(index) + count);
+    entry.indices = QVector<quint16>(store.triangleIndices(index), store.triangleIndices(index) + indexCount);
+
+    // Стыки берутся из кэша SceneStore и только поворачиваются
+    const float cosa = store.rotationCos()[index];
+    const float sina = store.rotationSin()[index];
+    const float* local = store.outlineJoins(index);
+    entry.joins.resize(count * SceneStore::JoinStride);
+    float* joins = entry.joins.data();
+    for (int i = 0; i < count * SceneStore::JoinStride; i += 2) {
+        joins[i] = cosa * local[i] - sina * local[i + 1];
+        joins[i + 1] = sina * local[i] + cosa * local[i + 1];
+    }
+}
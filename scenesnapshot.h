@@ -0,0 +1,83 @@
+#ifndef SCENESNAPSHOT_H
+#define SCENESNAPSHOT_H
+
+#include <QColor>
+#include <QRectF>
+#include <QVector>
+#include <memory>
+#include "scenestore.h"
+#include "shape.h"
+
+// Неизменяемый снимок сцены для рендер-потока. Фигуры лежат страницами
+// по ChunkSize в порядке отрисовки; страницы без изменений разделяются
+// между версиями, поэтому рендер-поток находит изменившиеся фигуры
+// сравнением указателей на страницы, не обходя всю сцену.
+class SceneSnapshot
+{
+public:
+    static constexpr int ChunkSize = 64;
+
+    // Вершины в мировых координатах
+    struct Entry
+    {
+        int id = -1;
+        bool visible = true;
+        bool selected = false;
+        QColor color;
+        QRectF bounds;
+        QVector<float> x;
+        QVector<float> y;
+        QVector<quint16> indices;
+        // Стыки обводки, повёрнутые в мировые оси; SceneStore::JoinStride
+        // чисел на вершину, длина в пикселях не зависит от масштаба
+        QVector<float> joins;
+    };
+
+    struct Chunk
+    {
+        QVector<Entry> entries;
+    };
+
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+
+    quint64 version() const { return m_version; }
+    int size() const { return m_size; }
+    int chunkCount() const { return m_chunks.size(); }
+    const ChunkPtr& chunk(int index) const { return m_chunks[index]; }
+
+private:
+    friend class SceneSnapshotBuilder;
+
+    quint64 m_version = 0;
+    int m_size = 0;
+    QVector<ChunkPtr> m_chunks;
+};
+
+// Живёт в потоке GUI. Изменения только помечают фигуры; publish()
+// копирует лишь страницы с помеченными фигурами.
+class SceneSnapshotBuilder
+{
+public:
+    void markDirty(int index);
+    // Вставка и удаление сдвигают индексы всех следующих фигур
+    void markDirtyFrom(int index);
+    void markAllDirty();
+    bool hasChanges(int selectedShapeId) const;
+
+    // Требует, чтобы store соответствовал shapes
+    std::shared_ptr<const SceneSnapshot> publish(const QVector<Shape>& shapes, SceneStore& store,
+                                                 int selectedShapeId);
+    const std::shared_ptr<const SceneSnapshot>& current() const { return m_current; }
+
+private:
+    static void fillEntry(SceneSnapshot::Entry& entry, const Shape& shape, const SceneStore& store, int index,
+                          int selectedShapeId);
+
+    std::shared_ptr<const SceneSnapshot> m_current;
+    QVector<int> m_dirty;
+    int m_dirtyFrom = -1;
+    bool m_allDirty = true;
+    int m_selectedShapeId = -1;
+};
+
+#endif // SCENESNAPSHOT_H
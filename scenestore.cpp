@@ -0,0 +1,457 @@
+#include "scenestore.h"
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCENESTORE_SSE2
+#endif
+
+// Границы считаются во float, поэтому слегка расширяем их, чтобы
+// широкая фаза никогда не отбрасывала пары, которые видит точная проверка.
+static const float BOUNDS_PADDING = 0.05f;
+
+struct WorldBounds
+{
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+};
+
+// Горячий цикл: локальные вершины -> мировые с одновременным подсчётом AABB.
+// Матрица та же, что и в Shape: [m11 m21 dx; m12 m22 dy].
+static WorldBounds transformVertices(const float* localX, const float* localY,
+                                     float* worldX, float* worldY, int count,
+                                     float m11, float m12, float m21, float m22,
+                                     float dx, float dy)
+{
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    int i = 0;
+#ifdef SCENESTORE_SSE2
+    if (count >= 4) {
+        const __m128 a = _mm_set1_ps(m11);
+        const __m128 b = _mm_set1_ps(m12);
+        const __m128 c = _mm_set1_ps(m21);
+        const __m128 d = _mm_set1_ps(m22);
+        const __m128 tx = _mm_set1_ps(dx);
+        const __m128 ty = _mm_set1_ps(dy);
+        __m128 vMinX = _mm_set1_ps(minX);
+        __m128 vMinY = _mm_set1_ps(minY);
+        __m128 vMaxX = _mm_set1_ps(maxX);
+        __m128 vMaxY = _mm_set1_ps(maxY);
+
+        for (; i + 4 <= count; i += 4) {
+            const __m128 x = _mm_loadu_ps(localX + i);
+            const __m128 y = _mm_loadu_ps(localY + i);
+            const __m128 wx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(c, y)), tx);
+            const __m128 wy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b, x), _mm_mul_ps(d, y)), ty);
+            _mm_storeu_ps(worldX + i, wx);
+            _mm_storeu_ps(worldY + i, wy);
+            vMinX = _mm_min_ps(vMinX, wx);
+            vMinY = _mm_min_ps(vMinY, wy);
+            vMaxX = _mm_max_ps(vMaxX, wx);
+            vMaxY = _mm_max_ps(vMaxY, wy);
+        }
+
+        alignas(16) float lanes[4][4];
+        _mm_store_ps(lanes[0], vMinX);
+        _mm_store_ps(lanes[1], vMinY);
+        _mm_store_ps(lanes[2], vMaxX);
+        _mm_store_ps(lanes[3], vMaxY);
+        for (int lane = 0; lane < 4; ++lane) {
+            minX = std::min(minX, lanes[0][lane]);
+            minY = std::min(minY, lanes[1][lane]);
+            maxX = std::max(maxX, lanes[2][lane]);
+            maxY = std::max(maxY, lanes[3][lane]);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const float x = localX[i];
+        const float y = localY[i];
+        const float wx = m11 * x + m21 * y + dx;
+        const float wy = m12 * x + m22 * y + dy;
+        worldX[i] = wx;
+        worldY[i] = wy;
+        minX = std::min(minX, wx);
+        minY = std::min(minY, wy);
+        maxX = std::max(maxX, wx);
+        maxY = std::max(maxY, wy);
+    }
+
+    return { minX, minY, maxX, maxY };
+}
+
+void SceneStore::clear()
+{
+    m_ids.clear();
+    m_flags.clear();
+    m_posX.clear();
+    m_posY.clear();
+    m_rotSin.clear();
+    m_rotCos.clear();
+    m_scale.clear();
+    m_minX.clear();
+    m_minY.clear();
+    m_maxX.clear();
+    m_maxY.clear();
+    m_vertexOffset.clear();
+    m_vertexCount.clear();
+    m_localX.clear();
+    m_localY.clear();
+    m_worldX.clear();
+    m_worldY.clear();
+    m_indexOffset.clear();
+    m_indices.clear();
+    m_joins.clear();
+    m_dirty.clear();
+    m_dirtyList.clear();
+}
+
+void SceneStore::rebuild(const QVector<Shape>& shapes)
+{
+    clear();
+
+    int totalVertices = 0;
+    for (const Shape& shape : shapes)
+        totalVertices += shape.vertices().size();
+
+    m_localX.reserve(totalVertices);
+    m_localY.reserve(totalVertices);
+    m_worldX.reserve(totalVertices);
+    m_worldY.reserve(totalVertices);
+    m_joins.reserve(totalVertices * JoinStride);
+
+    for (const Shape& shape : shapes)
+        append(shape);
+
+    updateWorldVertices();
+}
+
+void SceneStore::append(const Shape& shape)
+{
+    const int index = m_ids.size();
+
+    m_ids.append(shape.id());
+    m_flags.append(0);
+    m_posX.append(0.0f);
+    m_posY.append(0.0f);
+    m_rotSin.append(0.0f);
+    m_rotCos.append(1.0f);
+    m_scale.append(1.0f);
+    m_minX.append(0.0f);
+    m_minY.append(0.0f);
+    m_maxX.append(0.0f);
+    m_maxY.append(0.0f);
+    m_vertexOffset.append(m_localX.size());
+    m_vertexCount.append(0);
+    m_indexOffset.append(m_indices.size());
+    m_dirty.append(0);
+
+    writeVertices(index, shape);
+    writeTransform(index, shape);
+    markDirty(index);
+}
+
+void SceneStore::removeAt(int index)
+{
+    if (index < 0 || index >= m_ids.size())
+        return;
+
+    const int offset = m_vertexOffset[index];
+    const int count = m_vertexCount[index];
+
+    m_localX.remove(offset, count);
+    m_localY.remove(offset, count);
+    m_worldX.remove(offset, count);
+    m_worldY.remove(offset, count);
+    m_joins.remove(offset * JoinStride, count * JoinStride);
+    for (int i = index + 1; i < m_vertexOffset.size(); ++i)
+        m_vertexOffset[i] -= count;
+
+    const int indexCount = triangleIndexCountFor(count);
+    m_indices.remove(m_indexOffset[index], indexCount);
+    for (int i = index + 1; i < m_indexOffset.size(); ++i)
+        m_indexOffset[i] -= indexCount;
+
+    if (!m_dirtyList.isEmpty()) {
+        QVector<int> dirtyList;
+        dirtyList.reserve(m_dirtyList.size());
+        for (int dirtyIndex : std::as_const(m_dirtyList)) {
+            if (dirtyIndex != index)
+                dirtyList.append(dirtyIndex > index ? dirtyIndex - 1 : dirtyIndex);
+        }
+        m_dirtyList = dirtyList;
+    }
+
+    m_ids.removeAt(index);
+    m_flags.removeAt(index);
+    m_posX.removeAt(index);
+    m_posY.removeAt(index);
+    m_rotSin.removeAt(index);
+    m_rotCos.removeAt(index);
+    m_scale.removeAt(index);
+    m_minX.removeAt(index);
+    m_minY.removeAt(index);
+    m_maxX.removeAt(index);
+    m_maxY.removeAt(index);
+    m_vertexOffset.removeAt(index);
+    m_vertexCount.removeAt(index);
+    m_indexOffset.removeAt(index);
+    m_dirty.removeAt(index);
+}
+
+void SceneStore::update(int index, const Shape& shape)
+{
+    if (index < 0 || index >= m_ids.size())
+        return;
+
+    writeVertices(index, shape);
+    writeTransform(index, shape);
+    markDirty(index);
+}
+
+void SceneStore::updateTransform(int index, const Shape& shape)
+{
+    if (index < 0 || index >= m_ids.size())
+        return;
+
+    writeTransform(index, shape);
+    markDirty(index);
+}
+
+void SceneStore::updateWorldVertices()
+{
+    for (int index : std::as_const(m_dirtyList)) {
+        transformShape(index);
+        m_dirty[index] = 0;
+    }
+    m_dirtyList.clear();
+}
+
+int SceneStore::indexOf(int id) const
+{
+    const int* ids = m_ids.constData();
+    const int count = m_ids.size();
+    for (int i = 0; i < count; ++i) {
+        if (ids[i] == id)
+            return i;
+    }
+    return -1;
+}
+
+QRectF SceneStore::bounds(int index) const
+{
+    return QRectF(QPointF(m_minX[index], m_minY[index]),
+                  QPointF(m_maxX[index], m_maxY[index]));
+}
+
+bool SceneStore::boundsIntersect(int index, const QRectF& rect) const
+{
+    return m_minX[index] <= rect.right() && m_maxX[index] >= rect.left() &&
+           m_minY[index] <= rect.bottom() && m_maxY[index] >= rect.top();
+}
+
+bool SceneStore::boundsContain(int index, const QPointF& point) const
+{
+    return point.x() >= m_minX[index] && point.x() <= m_maxX[index] &&
+           point.y() >= m_minY[index] && point.y() <= m_maxY[index];
+}
+
+QVector<int> SceneStore::queryRect(const QRectF& rect, quint8 requiredFlags) const
+{
+    QVector<int> result;
+
+    const float left = rect.left();
+    const float right = rect.right();
+    const float top = rect.top();
+    const float bottom = rect.bottom();
+
+    const float* minX = m_minX.constData();
+    const float* minY = m_minY.constData();
+    const float* maxX = m_maxX.constData();
+    const float* maxY = m_maxY.constData();
+    const quint8* flags = m_flags.constData();
+    const int count = m_ids.size();
+
+    for (int i = 0; i < count; ++i) {
+        if ((flags[i] & requiredFlags) != requiredFlags)
+            continue;
+        if (minX[i] <= right && maxX[i] >= left && minY[i] <= bottom && maxY[i] >= top)
+            result.append(i);
+    }
+
+    return result;
+}
+
+int SceneStore::hitTest(const QPointF& point) const
+{
+    const float px = point.x();
+    const float py = point.y();
+
+    for (int i = m_ids.size() - 1; i >= 0; --i) {
+        if (!(m_flags[i] & Visible) || !boundsContain(i, point) || m_vertexCount[i] < 3)
+            continue;
+        if (Geometry::pointInPolygon<FloatPolicy>(worldPolygon(i), px, py))
+            return i;
+    }
+
+    return -1;
+}
+
+QVector<int> SceneStore::queryOverlaps(int index, quint8 requiredFlags) const
+{
+    QVector<int> result;
+    if (index < 0 || index >= m_ids.size())
+        return result;
+
+    const float left = m_minX[index];
+    const float right = m_maxX[index];
+    const float top = m_minY[index];
+    const float bottom = m_maxY[index];
+
+    const float* minX = m_minX.constData();
+    const float* minY = m_minY.constData();
+    const float* maxX = m_maxX.constData();
+    const float* maxY = m_maxY.constData();
+    const quint8* flags = m_flags.constData();
+    const int count = m_ids.size();
+
+    for (int i = 0; i < count; ++i) {
+        if (i == index || (flags[i] & requiredFlags) != requiredFlags)
+            continue;
+        if (minX[i] <= right && maxX[i] >= left && minY[i] <= bottom && maxY[i] >= top)
+            result.append(i);
+    }
+
+    return result;
+}
+
+void SceneStore::writeTransform(int index, const Shape& shape)
+{
+    m_ids[index] = shape.id();
+    m_flags[index] = (shape.isVisible() ? Visible : 0) |
+                     (shape.collisionsEnabled() ? Collides : 0);
+    m_posX[index] = shape.position().x();
+    m_posY[index] = shape.position().y();
+    m_rotSin[index] = shape.rotationSin();
+    m_rotCos[index] = shape.rotationCos();
+    m_scale[index] = shape.scale();
+}
+
+void SceneStore::writeVertices(int index, const Shape& shape)
+{
+    const QVector<QPointF>& vertices = shape.vertices();
+    const int offset = m_vertexOffset[index];
+    const int oldCount = m_vertexCount[index];
+    const int newCount = vertices.size();
+
+    bool changed = newCount != oldCount;
+    if (changed) {
+        const int delta = newCount - oldCount;
+        if (delta > 0) {
+            m_localX.insert(offset + oldCount, delta, 0.0f);
+            m_localY.insert(offset + oldCount, delta, 0.0f);
+            m_worldX.insert(offset + oldCount, delta, 0.0f);
+            m_worldY.insert(offset + oldCount, delta, 0.0f);
+            m_joins.insert((offset + oldCount) * JoinStride, delta * JoinStride, 0.0f);
+        } else {
+            m_localX.remove(offset + newCount, -delta);
+            m_localY.remove(offset + newCount, -delta);
+            m_worldX.remove(offset + newCount, -delta);
+            m_worldY.remove(offset + newCount, -delta);
+            m_joins.remove((offset + newCount) * JoinStride, -delta * JoinStride);
+        }
+        for (int i = index + 1; i < m_vertexOffset.size(); ++i)
+            m_vertexOffset[i] += delta;
+        m_vertexCount[index] = newCount;
+
+        const int indexOffset = m_indexOffset[index];
+        const int oldIndexCount = triangleIndexCountFor(oldCount);
+        const int indexDelta = triangleIndexCountFor(newCount) - oldIndexCount;
+        if (indexDelta > 0)
+            m_indices.insert(indexOffset + oldIndexCount, indexDelta, 0);
+        else if (indexDelta < 0)
+            m_indices.remove(indexOffset + oldIndexCount + indexDelta, -indexDelta);
+        for (int i = index + 1; i < m_indexOffset.size(); ++i)
+            m_indexOffset[i] += indexDelta;
+    }
+
+    float* localX = m_localX.data() + offset;
+    float* localY = m_localY.data() + offset;
+    for (int i = 0; i < newCount; ++i) {
+        const float x = vertices[i].x();
+        const float y = vertices[i].y();
+        if (localX[i] != x || localY[i] != y) {
+            localX[i] = x;
+            localY[i] = y;
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        retriangulate(index);
+        updateJoins(index);
+    }
+}
+
+void SceneStore::retriangulate(int index)
+{
+    const int offset = m_vertexOffset[index];
+    const Geometry::SoAPolygon<float> local { m_localX.constData() + offset,
+                                              m_localY.constData() + offset,
+                                              m_vertexCount[index] };
+    Geometry::triangulate(local, m_indices.data() + m_indexOffset[index]);
+}
+
+void SceneStore::updateJoins(int index)
+{
+    const int offset = m_vertexOffset[index];
+    const Geometry::SoAPolygon<float> local { m_localX.constData() + offset,
+                                              m_localY.constData() + offset,
+                                              m_vertexCount[index] };
+    Geometry::outlineJoins(local, m_joins.data() + offset * JoinStride, MiterLimit);
+}
+
+void SceneStore::markDirty(int index)
+{
+    if (!m_dirty[index]) {
+        m_dirty[index] = 1;
+        m_dirtyList.append(index);
+    }
+}
+
+void SceneStore::transformShape(int index)
+{
+    const int offset = m_vertexOffset[index];
+    const int count = m_vertexCount[index];
+    const float px = m_posX[index];
+    const float py = m_posY[index];
+
+    if (count == 0) {
+        m_minX[index] = m_maxX[index] = px;
+        m_minY[index] = m_maxY[index] = py;
+        return;
+    }
+
+    const float s = m_scale[index];
+    const float cosa = m_rotCos[index] * s;
+    const float sina = m_rotSin[index] * s;
+
+    const WorldBounds bounds = transformVertices(m_localX.constData() + offset,
+                                                 m_localY.constData() + offset,
+                                                 m_worldX.data() + offset,
+                                                 m_worldY.data() + offset,
+                                                 count, cosa, sina, -sina, cosa, px, py);
+
+    m_minX[index] = bounds.minX - BOUNDS_PADDING;
+    m_minY[index] = bounds.minY - BOUNDS_PADDING;
+    m_maxX[index] = bounds.maxX + BOUNDS_PADDING;
+    m_maxY[index] = bounds.maxY + BOUNDS_PADDING;
+}
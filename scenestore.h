@@ -0,0 +1,113 @@
+#ifndef SCENESTORE_H
+#define SCENESTORE_H
+
+#include <QRectF>
+#include <QVector>
+#include "geometry.h"
+#include "shape.h"
+
+// Плотное (SoA) хранилище горячих данных сцены. Индексы совпадают с
+// индексами в списке фигур холста; имена, цвета и прочие холодные поля
+// остаются в Shape.
+//
+// Изменения только помечают фигуру грязной; мировые вершины и AABB
+// пересчитываются одним проходом в updateWorldVertices(), который нужно
+// вызвать перед чтением границ или пула мировых вершин.
+class SceneStore
+{
+public:
+    enum Flag : quint8 {
+        Visible = 0x1,
+        Collides = 0x2
+    };
+
+    void clear();
+    void rebuild(const QVector<Shape>& shapes);
+    void append(const Shape& shape);
+    void removeAt(int index);
+    void update(int index, const Shape& shape);
+    void updateTransform(int index, const Shape& shape);
+    void updateWorldVertices();
+    bool hasDirtyShapes() const { return !m_dirtyList.isEmpty(); }
+
+    int size() const { return m_ids.size(); }
+    int id(int index) const { return m_ids[index]; }
+    int indexOf(int id) const;
+    quint8 flags(int index) const { return m_flags[index]; }
+    QRectF bounds(int index) const;
+
+    bool boundsIntersect(int index, const QRectF& rect) const;
+    bool boundsContain(int index, const QPointF& point) const;
+    QVector<int> queryRect(const QRectF& rect, quint8 requiredFlags = Visible) const;
+    QVector<int> queryOverlaps(int index, quint8 requiredFlags = Visible | Collides) const;
+    // Верхняя (последняя добавленная) видимая фигура под точкой или -1.
+    // Требует актуальных мировых вершин.
+    int hitTest(const QPointF& point) const;
+
+    const float* positionsX() const { return m_posX.constData(); }
+    const float* positionsY() const { return m_posY.constData(); }
+    const float* rotationSin() const { return m_rotSin.constData(); }
+    const float* rotationCos() const { return m_rotCos.constData(); }
+    const float* scales() const { return m_scale.constData(); }
+    const float* boundsMinX() const { return m_minX.constData(); }
+    const float* boundsMinY() const { return m_minY.constData(); }
+    const float* boundsMaxX() const { return m_maxX.constData(); }
+    const float* boundsMaxY() const { return m_maxY.constData(); }
+    const int* vertexOffsets() const { return m_vertexOffset.constData(); }
+    const int* vertexCounts() const { return m_vertexCount.constData(); }
+    const float* localVerticesX() const { return m_localX.constData(); }
+    const float* localVerticesY() const { return m_localY.constData(); }
+    const float* worldVerticesX() const { return m_worldX.constData(); }
+    const float* worldVerticesY() const { return m_worldY.constData(); }
+
+    int vertexCount(int index) const { return m_vertexCount[index]; }
+    const float* worldVerticesX(int index) const { return m_worldX.constData() + m_vertexOffset[index]; }
+    const float* worldVerticesY(int index) const { return m_worldY.constData() + m_vertexOffset[index]; }
+    // Треугольники пересчитываются только при изменении локальных вершин
+    int triangleIndexCount(int index) const { return triangleIndexCountFor(m_vertexCount[index]); }
+    const quint16* triangleIndices(int index) const { return m_indices.constData() + m_indexOffset[index]; }
+    // Стыки обводки в локальных координатах (Geometry::outlineJoins),
+    // JoinStride чисел на вершину; пересчитываются вместе с треугольниками
+    static constexpr int JoinStride = 8;
+    static constexpr float MiterLimit = 4.0f;
+    const float* outlineJoins(int index) const { return m_joins.constData() + m_vertexOffset[index] * JoinStride; }
+
+    Geometry::SoAPolygon<float> worldPolygon(int index) const
+    {
+        return { worldVerticesX(index), worldVerticesY(index), m_vertexCount[index] };
+    }
+
+private:
+    void writeTransform(int index, const Shape& shape);
+    void writeVertices(int index, const Shape& shape);
+    static int triangleIndexCountFor(int vertexCount) { return vertexCount >= 3 ? (vertexCount - 2) * 3 : 0; }
+    void retriangulate(int index);
+    void updateJoins(int index);
+    void markDirty(int index);
+    void transformShape(int index);
+
+    QVector<int> m_ids;
+    QVector<quint8> m_flags;
+    QVector<float> m_posX;
+    QVector<float> m_posY;
+    QVector<float> m_rotSin;
+    QVector<float> m_rotCos;
+    QVector<float> m_scale;
+    QVector<float> m_minX;
+    QVector<float> m_minY;
+    QVector<float> m_maxX;
+    QVector<float> m_maxY;
+    QVector<int> m_vertexOffset;
+    QVector<int> m_vertexCount;
+    QVector<float> m_localX;
+    QVector<float> m_localY;
+    QVector<float> m_worldX;
+    QVector<float> m_worldY;
+    QVector<int> m_indexOffset;
+    QVector<quint16> m_indices;
+    QVector<float> m_joins;
+    QVector<quint8> m_dirty;
+    QVector<int> m_dirtyList;
+};
+
+#endif // SCENESTORE_H
@@ -0,0 +1,60 @@
+#version 440
+
+layout(location = 0) in vec2 itemCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    // Пикселей на единицу мира и положение мирового нуля на экране
+    float scale;
+    vec2 offset;
+};
+
+const float GridSize = 50.0;
+// Каждый следующий уровень сетки крупнее в LevelFactor раз
+const float LevelFactor = 5.0;
+// Ближе этого линии уровня полностью гаснут
+const float MinSpacing = 8.0;
+
+const vec4 GridColor = vec4(100.0, 100.0, 100.0, 80.0) / 255.0;
+const vec4 AxisXColor = vec4(255.0, 0.0, 0.0, 200.0) / 255.0;
+const vec4 AxisYColor = vec4(0.0, 0.0, 255.0, 200.0) / 255.0;
+
+// Покрытие пикселя линией толщиной в пиксель с шагом spacing
+// (в мировых единицах) по обеим осям
+float gridLines(vec2 world, float spacing)
+{
+    vec2 pixels = abs(fract(world / spacing + 0.5) - 0.5) * spacing * scale;
+    vec2 coverage = clamp(1.0 - pixels, 0.0, 1.0);
+    return max(coverage.x, coverage.y);
+}
+
+// Цвет с домноженной прозрачностью поверх dst
+vec4 over(vec4 src, vec4 dst)
+{
+    return src + dst * (1.0 - src.a);
+}
+
+void main()
+{
+    vec2 world = (itemCoord - offset) / scale;
+
+    // Уровень сетки, на котором линии не ближе MinSpacing; дробная часть
+    // плавно гасит мелкий уровень, пока крупный не станет основным
+    float level = max(0.0, log(MinSpacing / (GridSize * scale)) / log(LevelFactor) + 1.0);
+    float fine = GridSize * pow(LevelFactor, floor(level));
+    float fade = 1.0 - fract(level);
+    float grid = max(gridLines(world, fine) * fade, gridLines(world, fine * LevelFactor));
+
+    // Оси поверх сетки
+    vec2 axisPixels = abs(world) * scale;
+    float axisX = clamp(1.0 - axisPixels.y, 0.0, 1.0);
+    float axisY = clamp(1.0 - axisPixels.x, 0.0, 1.0);
+
+    vec4 color = vec4(GridColor.rgb * GridColor.a, GridColor.a) * grid;
+    color = over(vec4(AxisXColor.rgb * AxisXColor.a, AxisXColor.a) * axisX, color);
+    color = over(vec4(AxisYColor.rgb * AxisYColor.a, AxisYColor.a) * axisY, color);
+    fragColor = color * qt_Opacity;
+}
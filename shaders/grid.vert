@@ -0,0 +1,19 @@
+#version 440
+
+layout(location = 0) in vec2 vertexCoord;
+
+// Координаты элемента в логических пикселях
+layout(location = 0) out vec2 itemCoord;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    float scale;
+    vec2 offset;
+};
+
+void main()
+{
+    itemCoord = vertexCoord;
+    gl_Position = qt_Matrix * vec4(vertexCoord, 0.0, 1.0);
+}
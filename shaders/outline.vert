@@ -0,0 +1,21 @@
+#version 440
+
+// Точка контура в координатах узла и смещение от неё в пикселях экрана
+layout(location = 0) in vec2 vertexCoord;
+layout(location = 1) in vec2 vertexOffset;
+layout(location = 2) in vec4 vertexColor;
+
+layout(location = 0) out vec4 color;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    // Размер пикселя экрана в координатах узла
+    float pixelSize;
+};
+
+void main()
+{
+    color = vertexColor * qt_Opacity;
+    gl_Position = qt_Matrix * vec4(vertexCoord + vertexOffset * pixelSize, 0.0, 1.0);
+}
@@ -1,20 +1,90 @@
 #include "shape.h"
+#include "geometry.h"
 #include <cmath>
 #include <algorithm>
-#include <QTransform>
 #include <qmath.h>
 
 const double PI = 3.141592653589793;
-constexpr double EPS = 5e-5;
+
+namespace {
+
+const int MAX_TABLE_SIDES = 20;
+
+// Направления (cos, sin) вершин правильного многоугольника
+QVector<QPointF> unitPolygonVertices(int sides)
+{
+    QVector<QPointF> vertices;
+    double baseAngle = (sides == 4) ? -PI/4.0 : -PI/2.0;
+
+    for (int i = 0; i < sides; ++i)
+    {
+        double angle = 2.0 * PI * i / sides + baseAngle;
+        vertices.append(QPointF(std::cos(angle), std::sin(angle)));
+    }
+    return vertices;
+}
+
+// Считается один раз: загрузка больших сцен не тратит время на тригонометрию
+const QVector<QPointF>& unitPolygon(int sides)
+{
+    static const QVector<QVector<QPointF>> table = [] {
+        QVector<QVector<QPointF>> polygons(MAX_TABLE_SIDES + 1);
+        for (int n = 3; n <= MAX_TABLE_SIDES; ++n)
+            polygons[n] = unitPolygonVertices(n);
+        return polygons;
+    }();
+    return table[sides];
+}
+
+} // namespace
 
 Shape::Shape() {}
 
 Shape::Shape(int id, const QPointF& position, double sizeWidth, double sizeHeigth)
     : s_id(id), s_position(position), s_sizeWidth(sizeWidth), s_sizeHeigth(sizeHeigth)
 {
+    updateTransform();
     updateVertices(s_sides, s_size);
 }
 
+void Shape::updateTransform()
+{
+    // Как и QTransform::rotate, для углов, кратных 90 градусам, берём точные значения
+    const double angle = std::fmod(s_rotation, 360.0);
+    if (angle == 0.0) {
+        s_sin = 0.0; s_cos = 1.0;
+    } else if (angle == 90.0 || angle == -270.0) {
+        s_sin = 1.0; s_cos = 0.0;
+    } else if (angle == 180.0 || angle == -180.0) {
+        s_sin = 0.0; s_cos = -1.0;
+    } else if (angle == 270.0 || angle == -90.0) {
+        s_sin = -1.0; s_cos = 0.0;
+    } else {
+        const double radians = angle * PI / 180.0;
+        s_sin = std::sin(radians);
+        s_cos = std::cos(radians);
+    }
+
+    s_m11 = s_cos * s_scale;
+    s_m12 = s_sin * s_scale;
+    s_m21 = -s_sin * s_scale;
+    s_m22 = s_cos * s_scale;
+    s_dx = s_position.x();
+    s_dy = s_position.y();
+}
+
+void Shape::transformVertices(const QPointF* src, QPointF* dst, int count) const
+{
+    const double m11 = s_m11, m12 = s_m12, m21 = s_m21, m22 = s_m22;
+    const double dx = s_dx, dy = s_dy;
+
+    for (int i = 0; i < count; ++i) {
+        const double x = src[i].x();
+        const double y = src[i].y();
+        dst[i] = QPointF(m11 * x + m21 * y + dx, m12 * x + m22 * y + dy);
+    }
+}
+
 void Shape::updateVertices(int sides, double size)
 {
     if (!s_useCustomVertices) {
@@ -41,16 +111,12 @@ void Shape::adjustForEdgeLength(int edgeIndex, double newLength)
 
 void Shape::generateRegularPolygonVertices(int sides, double radius)
 {
+    const QVector<QPointF> unit = (sides >= 3 && sides <= MAX_TABLE_SIDES) ? unitPolygon(sides)
+                                                                           : unitPolygonVertices(sides);
     s_vertices.clear();
-    double baseAngle = (sides == 4) ? -PI/4.0 : -PI/2.0;
-
-    for (int i = 0; i < sides; ++i)
-    {
-        double angle = 2.0 * PI * i / sides + baseAngle;
-        double x = std::cos(angle) * s_sizeWidth;
-        double y = std::sin(angle) * s_sizeHeigth;
-        s_vertices.append(QPointF(x, y));
-    }
+    s_vertices.reserve(unit.size());
+    for (const QPointF& direction : unit)
+        s_vertices.append(QPointF(direction.x() * s_sizeWidth, direction.y() * s_sizeHeigth));
 }
 
 
@@ -74,85 +140,16 @@ bool Shape::checkCollision(const Shape& other) const
 
 bool Shape::checkPolygonCollision(const QPolygonF& poly1, const QPolygonF& poly2) const
 {
-    int n1 = poly1.size();
-    int n2 = poly2.size();
-    for (int i = 0; i < n1; i++) {
-        QPointF p1 = poly1[i];
-        QPointF p2 = poly1[(i + 1) % n1];
-
-        for (int j = 0; j < n2; j++) {
-            QPointF p3 = poly2[j];
-            QPointF p4 = poly2[(j + 1) % n2];
-
-            if (linesIntersect(p1, p2, p3, p4))
-                return true;
-        }
-    }
-
-    if (pointInPolygon(poly1, polygonCenter(poly2)))
-        return true;
-
-    if (pointInPolygon(poly2, polygonCenter(poly1)))
-        return true;
-
-    return false;
+    return Geometry::polygonsIntersect<DoublePolicy>(
+        Geometry::PointFPolygon(poly1.constData(), poly1.size()),
+        Geometry::PointFPolygon(poly2.constData(), poly2.size()));
 }
 
-
 QPointF Shape::findMTV(const QPolygonF& poly1, const QPolygonF& poly2) const
 {
-    double smallestOverlap = std::numeric_limits<double>::infinity();
-    QPointF smallestAxis(0, 0);
-
-    auto project = [](const QPolygonF& p, const QPointF& axis, double& min, double& max)
-    {
-        min = max = QPointF::dotProduct(p[0], axis);
-        for (int i = 1; i < p.size(); ++i)
-        {
-            double proj = QPointF::dotProduct(p[i], axis);
-            if (proj < min) min = proj;
-            if (proj > max) max = proj;
-        }
-    };
-
-    auto normalize = [](const QPointF& v)
-    {
-        double len = std::sqrt(v.x()*v.x() + v.y()*v.y());
-        return (len > 1e-6) ? v / len : QPointF(0, 0);
-    };
-    auto testAxes = [&](const QPolygonF& poly)
-    {
-        for (int i = 0; i < poly.size(); i++)
-        {
-            QPointF p1 = poly[i];
-            QPointF p2 = poly[(i + 1) % poly.size()];
-            QPointF edge = p2 - p1;
-
-            QPointF axis(-edge.y(), edge.x());
-            axis = normalize(axis);
-            if (axis.isNull()) continue;
-
-            double minA, maxA, minB, maxB;
-            project(poly1, axis, minA, maxA);
-            project(poly2, axis, minB, maxB);
-
-            double overlap = std::min(maxA, maxB) - std::max(minA, minB);
-
-            if (overlap < 0)
-                return false;
-
-            if (overlap < smallestOverlap)
-            {
-                smallestOverlap = overlap;
-                smallestAxis = axis;
-            }
-        }
-        return true;
-    };
-
-    if (!testAxes(poly1)) return QPointF(0, 0);
-    if (!testAxes(poly2)) return QPointF(0, 0);
-    return smallestAxis * smallestOverlap;
+    return Geometry::toPointF(Geometry::minimumTranslation<DoublePolicy>(
+        Geometry::PointFPolygon(poly1.constData(), poly1.size()),
+        Geometry::PointFPolygon(poly2.constData(), poly2.size())));
 }
 
 void Shape::resolveCollision(const Shape& other)
@@ -160,76 +157,31 @@ void Shape::resolveCollision(const Shape& other)
     QPolygonF poly1 = getWorldPolygon();
     QPolygonF poly2 = other.getWorldPolygon();
 
-    QPointF mtv = findMTV(poly1, poly2);
+    QPointF mtv = Geometry::toPointF(Geometry::separation<DoublePolicy>(
+        Geometry::PointFPolygon(poly1.constData(), poly1.size()),
+        Geometry::PointFPolygon(poly2.constData(), poly2.size())));
     if (mtv.isNull()) return;
-    QPointF dir = polygonCenter(poly1) - polygonCenter(poly2);
-    if (QPointF::dotProduct(mtv, dir) < 0)
-        mtv = -mtv;
-    s_position += mtv;
+    setPosition(s_position + mtv);
 }
 
 QPointF Shape::polygonCenter(const QPolygonF& p) const
 {
-    QPointF c(0,0);
-    for (auto& v : p) c += v;
-    return c / p.size();
+    return Geometry::toPointF(Geometry::center<DoublePolicy>(
+        Geometry::PointFPolygon(p.constData(), p.size())));
 }
 
 bool Shape::pointInPolygon(const QPolygonF& polygon, const QPointF& p) const
 {
-    bool inside = false;
-    int count = polygon.size();
-
-    for (int i = 0, j = count - 1; i < count; j = i++)
-    {
-        const QPointF& pi = polygon[i];
-        const QPointF& pj = polygon[j];
-
-        bool intersect = ((pi.y() > p.y()) != (pj.y() > p.y())) &&
-                         (p.x() < (pj.x() - pi.x()) * (p.y() - pi.y()) / (pj.y() - pi.y()) + pi.x());
-
-        if (intersect)
-            inside = !inside;
-    }
-
-    return inside;
+    return Geometry::pointInPolygon<DoublePolicy>(
+        Geometry::PointFPolygon(polygon.constData(), polygon.size()), p.x(), p.y());
 }
 
 bool Shape::linesIntersect(const QPointF& p1, const QPointF& p2,
                            const QPointF& p3, const QPointF& p4) const
 {
-    auto cross = [](const QPointF& a, const QPointF& b){
-        return a.x()*b.y() - a.y()*b.x();
-    };
-
-    QPointF r = p2 - p1;
-    QPointF s = p4 - p3;
-
-    double rxs = cross(r, s);
-    double qpxr = cross(p3 - p1, r);
-
-    if (std::abs(rxs) < EPS && std::abs(qpxr) < EPS) {
-        auto between = [](double a, double b, double c){
-            return c >= std::min(a, b) - EPS && c <= std::max(a, b) + EPS;
-        };
-        if (between(p1.x(), p2.x(), p3.x()) || between(p1.x(), p2.x(), p4.x()) ||
-            between(p3.x(), p4.x(), p1.x()) || between(p3.x(), p4.x(), p2.x()))
-            return true;
-
-        if (between(p1.y(), p2.y(), p3.y()) || between(p1.y(), p2.y(), p4.y()) ||
-            between(p3.y(), p4.y(), p1.y()) || between(p3.y(), p4.y(), p2.y()))
-            return true;
-
-        return false;
-    }
-
-    if (std::abs(rxs) < EPS && std::abs(qpxr) < EPS)
-        return false;
-
-    double t = cross(p3 - p1, s) / rxs;
-    double u = cross(p3 - p1, r) / rxs;
-
-    return (t >= -EPS && t <= 1.0 + EPS && u >= -EPS && u <= 1.0 + EPS);
+    using Geometry::fromPointF;
+    return Geometry::segmentsIntersect<DoublePolicy>(fromPointF<double>(p1), fromPointF<double>(p2),
+                                                     fromPointF<double>(p3), fromPointF<double>(p4));
 }
 
 double Shape::crossProduct(const QPointF& a, const QPointF& b) const
@@ -248,42 +200,15 @@ bool Shape::onSegment(const QPointF& p, const QPointF& q, const QPointF& r) cons
 
 QPolygonF Shape::getWorldPolygon() const
 {
-    QPolygonF polygon;
-
-    for (const QPointF& vertex : s_vertices) {
-        QPointF scaledVertex = vertex * s_scale;
-
-        if (!std::abs(s_rotation) < EPS) {
-            QTransform transform;
-            transform.rotate(s_rotation);
-            scaledVertex = transform.map(scaledVertex);
-        }
-
-        scaledVertex += s_position;
-
-        polygon << scaledVertex;
-    }
-
+    QPolygonF polygon(s_vertices.size());
+    transformVertices(s_vertices.constData(), polygon.data(), s_vertices.size());
     return polygon;
 }
 
 QPolygonF Shape::getWorldPolygon(double globalScale) const
 {
-    QPolygonF polygon;
-
-    for (const QPointF& vertex : s_vertices) {
-        QPointF scaledVertex = vertex * s_scale;
-        if (!std::abs(s_rotation) < EPS) {
-            QTransform transform;
-            transform.rotate(s_rotation);
-            scaledVertex = transform.map(scaledVertex);
-        }
-        scaledVertex += s_position;
-
-        polygon << scaledVertex;
-    }
-
-    return polygon;
+    Q_UNUSED(globalScale);
+    return getWorldPolygon();
 }
 
 QPointF Shape::getVertexWorldPosition(int index) const
@@ -291,13 +216,7 @@ QPointF Shape::getVertexWorldPosition(int index) const
     if (index < 0 || index >= s_vertices.size())
         return QPointF();
 
-    QPointF localPos = s_vertices[index] * s_scale;
-    if (!std::abs(s_rotation) < EPS) {
-        QTransform transform;
-        transform.rotate(s_rotation);
-        localPos = transform.map(localPos);
-    }
-    return s_position + localPos;
+    return localToWorld(s_vertices[index]);
 }
 
 QRectF Shape::getBoundingBox() const
@@ -352,25 +271,57 @@ double Shape::boundingRadius(double globalScale) const
 
 QPointF Shape::localToWorld(const QPointF& localPoint, double globalScale) const
 {
-    QPointF transformed = localPoint * s_scale;
-    if (!std::abs(s_rotation) < EPS) {
-        QTransform transform;
-        transform.rotate(s_rotation);
-        transformed = transform.map(transformed);
-    }
-
-    return s_position + transformed;
+    Q_UNUSED(globalScale);
+    const double x = localPoint.x();
+    const double y = localPoint.y();
+    return QPointF(s_m11 * x + s_m21 * y + s_dx, s_m12 * x + s_m22 * y + s_dy);
 }
 
 QPointF Shape::worldToLocal(const QPointF& worldPoint, double globalScale) const
 {
-    QPointF local = worldPoint - s_position;
+    Q_UNUSED(globalScale);
+    // Обратная матрица поворота — транспонированная, масштаб делим отдельно
+    const double x = worldPoint.x() - s_dx;
+    const double y = worldPoint.y() - s_dy;
+    return QPointF(s_cos * x + s_sin * y, -s_sin * x + s_cos * y) / s_scale;
+}
 
-    if (!std::abs(s_rotation) < EPS) {
-        QTransform transform;
-        transform.rotate(-s_rotation);
-        local = transform.map(local);
-    }
+QDataStream& operator<<(QDataStream& stream, const Shape& shape)
+{
+    stream << qint32(shape.id()) << shape.name() << shape.color()
+           << shape.position() << shape.rotation() << shape.scale() << shape.size()
+           << qint32(shape.sides()) << shape.sizeWidth() << shape.sizeHeigth()
+           << shape.isVisible() << shape.collisionsEnabled() << shape.useCustomVertices()
+           << shape.vertices();
+    return stream;
+}
 
-    return local / s_scale;
+QDataStream& operator>>(QDataStream& stream, Shape& shape)
+{
+    qint32 id, sides;
+    QString name;
+    QColor color;
+    QPointF position;
+    double rotation, scale, size, sizeWidth, sizeHeigth;
+    bool visible, collisionsEnabled, useCustomVertices;
+    QVector<QPointF> vertices;
+
+    stream >> id >> name >> color >> position >> rotation >> scale >> size
+           >> sides >> sizeWidth >> sizeHeigth
+           >> visible >> collisionsEnabled >> useCustomVertices >> vertices;
+    if (stream.status() != QDataStream::Ok)
+        return stream;
+
+    shape = Shape(id, position, sizeWidth, sizeHeigth);
+    shape.setName(name);
+    shape.setColor(color);
+    shape.setSides(sides);
+    shape.setSize(size);
+    shape.setRotation(rotation);
+    shape.setScale(scale);
+    shape.setVisible(visible);
+    shape.setCollisionsEnabled(collisionsEnabled);
+    shape.setVertices(vertices);
+    shape.setUseCustomVertices(useCustomVertices);
+    return stream;
 }
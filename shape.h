@@ -4,12 +4,16 @@
 #include <QPointF>
 #include <QPolygonF>
 #include <QColor>
+#include <QDataStream>
 #include <QString>
 #include <QVector>
 
 class Shape
 {
 public:
+    // Прозрачность заливки: одна для холста, плиток и экспорта в SVG
+    static constexpr int FillAlpha = 180;
+
     Shape();
     Shape(int id, const QPointF& position, double sizeWidth, double sizeMax);
     void updateVertices(int sides, double size);
@@ -20,16 +24,19 @@ public:
     QPointF getVertexWorldPosition(int index) const;
     QRectF getBoundingBox() const;
     int id() const { return s_id; }
+    void setId(int id) { s_id = id; }
 
 
     bool isVisible() const { return s_visible; }
     void setVisible(bool visible) { s_visible = visible; }
 
     double rotation() const { return s_rotation; }
-    void setRotation(double rotation) { s_rotation = rotation; }
+    void setRotation(double rotation) { s_rotation = rotation; updateTransform(); }
+    double rotationSin() const { return s_sin; }
+    double rotationCos() const { return s_cos; }
 
     double scale() const { return s_scale; }
-    void setScale(double scale) { s_scale = qMax(0.1, qMin(scale, 3.0)); }
+    void setScale(double scale) { s_scale = qMax(0.1, qMin(scale, 3.0)); updateTransform(); }
 
     double size() const { return s_size; }
     void setSize(double size) { s_size = qMax(10.0, qMin(size, 200.0)); }
@@ -78,7 +85,7 @@ public:
     }
 
     QPointF position() const { return s_position; }
-    void setPosition(const QPointF &position) { s_position = position; }
+    void setPosition(const QPointF &position) { s_position = position; updateTransform(); }
     float calculateOverlap(const Shape& other) const;
 
     bool useCustomVertices() const { return s_useCustomVertices; }
@@ -90,8 +97,10 @@ public:
     double boundingRadius(double globalScale = 1.0) const;
     QPointF localToWorld(const QPointF& localPoint, double globalScale = 1.0) const;
     QPointF worldToLocal(const QPointF& worldPoint, double globalScale = 1.0) const;
+    void transformVertices(const QPointF* src, QPointF* dst, int count) const;
 
 private:
+    void updateTransform();
     void generateRegularPolygonVertices(int sides, double radius);
     bool checkPolygonCollision(const QPolygonF& poly1, const QPolygonF& poly2) const;
     QPointF findMTV(const QPolygonF& poly1, const QPolygonF& poly2) const;
@@ -115,8 +124,22 @@ private:
     QVector<QPointF> s_vertices;
     QPointF s_position = QPointF(0, 0);
     bool s_useCustomVertices = false;
+
+    // Кэш аффинной матрицы 2x3: [m11 m21 dx; m12 m22 dy]
+    double s_sin = 0.0;
+    double s_cos = 1.0;
+    double s_m11 = 1.0;
+    double s_m12 = 0.0;
+    double s_m21 = 0.0;
+    double s_m22 = 1.0;
+    double s_dx = 0.0;
+    double s_dy = 0.0;
 private:
     static const double COLLISION_EPSILON;
 };
 
+// Полное состояние фигуры, включая точные вершины
+QDataStream& operator<<(QDataStream& stream, const Shape& shape);
+QDataStream& operator>>(QDataStream& stream, Shape& shape);
+
 #endif // SHAPE_H
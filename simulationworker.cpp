@@ -0,0 +1,171 @@
+#include "simulationworker.h"
+#include <QThread>
+#include <algorithm>
+#include "profiler.h"
+
+SimulationWorker::SimulationWorker(std::function<void()> published)
+    : m_published(std::move(published)), m_commands(4096)
+{
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("simulation"));
+    m_thread->start();
+}
+
+SimulationWorker::~SimulationWorker()
+{
+    m_running.store(false, std::memory_order_release);
+    m_wake.release();
+    m_thread->wait();
+    delete m_thread;
+}
+
+void SimulationWorker::post(Command command)
+{
+    while (!m_commands.push(command))
+        QThread::yieldCurrentThread();
+    m_wake.release();
+}
+
+std::shared_ptr<const SimulationWorker::Snapshot> SimulationWorker::takeSnapshot()
+{
+    // Сначала сбрасываем флаг: снимок, опубликованный после этого,
+    // гарантированно вызовет published ещё раз
+    m_notified.store(false, std::memory_order_release);
+    return std::atomic_exchange(&m_snapshot, std::shared_ptr<const Snapshot>());
+}
+
+void SimulationWorker::resolveCollisions(SceneStore& store, int index, Shape& shape, int maxIterations)
+{
+    ProfileScope profile(Profiler::Collision);
+    store.updateWorldVertices();
+
+    for (int iter = 0; iter < maxIterations; ++iter) {
+        bool anyCollision = false;
+
+        const QVector<int> candidates = store.queryOverlaps(index);
+        Profiler::count(Profiler::PairsTested, candidates.size());
+        for (int candidate : candidates) {
+            const Geometry::SoAPolygon<float> self = store.worldPolygon(index);
+            const Geometry::SoAPolygon<float> other = store.worldPolygon(candidate);
+            if (!Geometry::polygonsIntersect<FloatPolicy>(self, other))
+                continue;
+
+            const Geometry::Vec2<float> mtv = Geometry::separation<FloatPolicy>(self, other);
+            if (mtv.isNull())
+                continue;
+
+            shape.setPosition(shape.position() + Geometry::toPointF(mtv));
+            store.updateTransform(index, shape);
+            store.updateWorldVertices();
+            anyCollision = true;
+        }
+
+        if (!anyCollision) break;
+    }
+}
+
+void SimulationWorker::run()
+{
+    QVector<Placement> resolves;
+    Command command;
+
+    while (true) {
+        m_wake.acquire();
+        m_wake.tryAcquire(m_wake.available());
+        if (!m_running.load(std::memory_order_acquire))
+            return;
+
+        while (m_commands.pop(command))
+            apply(command, resolves);
+        if (resolves.isEmpty())
+            continue;
+
+        QVector<Placement> placements;
+        placements.reserve(resolves.size());
+        for (Placement placement : std::as_const(resolves)) {
+            const int index = m_store.indexOf(placement.id);
+            if (index < 0)
+                continue;
+            resolveCollisions(m_store, index, m_shapes[index]);
+            placement.position = m_shapes[index].position();
+            placements.append(placement);
+        }
+        resolves.clear();
+
+        if (!placements.isEmpty())
+            publish(placements);
+    }
+}
+
+void SimulationWorker::apply(Command& command, QVector<Placement>& resolves)
+{
+    switch (command.type) {
+    case Command::Reset:
+        m_shapes = std::move(command.shapes);
+        m_store.rebuild(m_shapes);
+        resolves.clear();
+        break;
+    case Command::Insert:
+        m_shapes.reserve(m_shapes.size() + command.shapes.size());
+        for (const Shape& shape : std::as_const(command.shapes)) {
+            m_shapes.append(shape);
+            m_store.append(shape);
+        }
+        break;
+    case Command::Remove: {
+        const int index = m_store.indexOf(command.shape.id());
+        if (index >= 0) {
+            m_shapes.removeAt(index);
+            m_store.removeAt(index);
+        }
+        break;
+    }
+    case Command::Update:
+    case Command::Resolve: {
+        const int index = m_store.indexOf(command.shape.id());
+        if (index < 0)
+            break;
+        m_shapes[index] = command.shape;
+        m_store.update(index, command.shape);
+        if (command.type != Command::Resolve)
+            break;
+
+        auto pending = std::find_if(resolves.begin(), resolves.end(), [&](const Placement& placement) {
+            return placement.id == command.shape.id();
+        });
+        if (pending == resolves.end())
+            resolves.append({ command.shape.id(), command.sequence, QPointF() });
+        else
+            pending->sequence = command.sequence;
+        break;
+    }
+    }
+}
+
+// Неразобранный холстом снимок не теряется: новые результаты
+// сливаются с ним, более свежие позиции заменяют старые
+void SimulationWorker::publish(QVector<Placement>& placements)
+{
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->version = ++m_version;
+
+    const std::shared_ptr<const Snapshot> previous =
+        std::atomic_exchange(&m_snapshot, std::shared_ptr<const Snapshot>());
+    if (previous) {
+        snapshot->placements = previous->placements;
+        for (const Placement& placement : std::as_const(placements)) {
+            auto existing = std::find_if(snapshot->placements.begin(), snapshot->placements.end(),
+                                         [&](const Placement& other) { return other.id == placement.id; });
+            if (existing == snapshot->placements.end())
+                snapshot->placements.append(placement);
+            else
+                *existing = placement;
+        }
+    } else {
+        snapshot->placements = std::move(placements);
+    }
+
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+    if (!m_notified.exchange(true, std::memory_order_acq_rel))
+        m_published();
+}
@@ -0,0 +1,95 @@
+#ifndef SIMULATIONWORKER_H
+#define SIMULATIONWORKER_H
+
+#include <QPointF>
+#include <QSemaphore>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "scenestore.h"
+#include "shape.h"
+#include "spscqueue.h"
+
+class QThread;
+
+// Поток симуляции: держит собственную копию фигур и SceneStore и
+// разрешает столкновения вне потока GUI. Холст отправляет изменения
+// командами через очередь без блокировок; результаты публикуются
+// неизменяемыми снимками, которые холст забирает через takeSnapshot().
+//
+// Разрешение столкновений коалесцируется: из нескольких команд Resolve
+// для одной фигуры, пришедших до обработки, считается только последняя.
+class SimulationWorker
+{
+public:
+    struct Command
+    {
+        enum Type : quint8 {
+            Reset,      // заменить все фигуры на shapes
+            Insert,     // добавить shapes в конец
+            Remove,     // удалить фигуру shape.id()
+            Update,     // заменить фигуру shape
+            Resolve     // заменить фигуру shape и разрешить её столкновения
+        };
+
+        Type type = Update;
+        quint32 sequence = 0;   // номер запроса, возвращается в Placement
+        Shape shape;
+        QVector<Shape> shapes;
+    };
+
+    struct Placement
+    {
+        int id = -1;
+        quint32 sequence = 0;
+        QPointF position;
+    };
+
+    struct Snapshot
+    {
+        quint64 version = 0;
+        QVector<Placement> placements;
+    };
+
+    // published вызывается из потока симуляции, когда появился снимок,
+    // а предыдущий уже забран
+    explicit SimulationWorker(std::function<void()> published);
+    ~SimulationWorker();
+
+    SimulationWorker(const SimulationWorker&) = delete;
+    SimulationWorker& operator=(const SimulationWorker&) = delete;
+
+    // Вызывать из одного потока (GUI). При заполненной очереди ждёт,
+    // пока поток симуляции её разберёт.
+    void post(Command command);
+
+    // Накопленные результаты или nullptr, если новых нет
+    std::shared_ptr<const Snapshot> takeSnapshot();
+
+    // Тот же алгоритм для синхронного пути холста: до maxIterations
+    // проходов широкой и узкой фаз, фигура сдвигается на MTV. Требует
+    // актуального SceneStore для index.
+    static void resolveCollisions(SceneStore& store, int index, Shape& shape, int maxIterations = 5);
+
+private:
+    void run();
+    void apply(Command& command, QVector<Placement>& resolves);
+    void publish(QVector<Placement>& placements);
+
+    std::function<void()> m_published;
+    SpscQueue<Command> m_commands;
+    QSemaphore m_wake;
+    std::atomic<bool> m_running { true };
+    QThread* m_thread = nullptr;
+
+    // Принадлежат потоку симуляции
+    QVector<Shape> m_shapes;
+    SceneStore m_store;
+    quint64 m_version = 0;
+
+    std::shared_ptr<const Snapshot> m_snapshot;
+    std::atomic<bool> m_notified { false };
+};
+
+#endif // SIMULATIONWORKER_H
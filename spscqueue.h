@@ -0,0 +1,66 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+// Очередь без блокировок на одного писателя и одного читателя. head
+// двигает только писатель, tail — только читатель; ёмкость округляется
+// вверх до степени двойки.
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(quint32 capacity)
+        : m_slots(roundUp(capacity)), m_mask(quint32(m_slots.size()) - 1)
+    {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // false, если очередь заполнена; значение тогда не трогается
+    bool push(T& value)
+    {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) > m_mask)
+            return false;
+        m_slots[head & m_mask] = std::move(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+        value = std::move(m_slots[tail & m_mask]);
+        m_slots[tail & m_mask] = T();
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    static quint32 roundUp(quint32 capacity)
+    {
+        quint32 size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    std::vector<T> m_slots;
+    const quint32 m_mask;
+    alignas(64) std::atomic<quint32> m_head { 0 };
+    alignas(64) std::atomic<quint32> m_tail { 0 };
+};
+
+#endif // SPSCQUEUE_H
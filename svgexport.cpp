@@ -0,0 +1,199 @@
+#include "svgexport.h"
+#include <QRectF>
+#include <QSaveFile>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const int BUFFER_SIZE = 256 * 1024;
+const double MARGIN = 10.0;
+
+void setError(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+}
+
+// Буфер вывода: сбрасывается в устройство, когда заполнен. Ошибка
+// записи запоминается и проверяется один раз в конце.
+class Writer
+{
+public:
+    explicit Writer(QIODevice& device)
+        : m_device(device)
+    {
+        m_buffer.reserve(BUFFER_SIZE + 1024);
+    }
+
+    void append(const char* text) { m_buffer.append(text); }
+    void append(char c) { m_buffer.append(c); }
+
+    void appendInt(qint64 value)
+    {
+        m_number.setNum(value);
+        m_buffer.append(m_number);
+    }
+
+    // Три знака после запятой, без хвостовых нулей и без "-0". Число
+    // переводится в целое тысячных и печатается вручную: на больших
+    // сценах форматирование double — основная часть времени экспорта.
+    void appendNumber(double value)
+    {
+        const double scaled = std::round(value * 1000.0);
+        if (!(std::abs(scaled) < 1e15)) {
+            m_number.setNum(value, 'g', 17);
+            m_buffer.append(m_number);
+            return;
+        }
+
+        qint64 fixed = qint64(scaled);
+        char text[32];
+        char* end = text + sizeof(text);
+        char* begin = end;
+        const bool negative = fixed < 0;
+        if (negative)
+            fixed = -fixed;
+
+        int fraction = int(fixed % 1000);
+        qint64 integer = fixed / 1000;
+        if (fraction != 0) {
+            int digits = 3;
+            while (fraction % 10 == 0) {
+                fraction /= 10;
+                --digits;
+            }
+            while (digits-- > 0) {
+                *--begin = char('0' + fraction % 10);
+                fraction /= 10;
+            }
+            *--begin = '.';
+        }
+        do {
+            *--begin = char('0' + integer % 10);
+            integer /= 10;
+        } while (integer != 0);
+        if (negative && fixed != 0)
+            *--begin = '-';
+        m_buffer.append(begin, end - begin);
+    }
+
+    void appendColor(const QColor& color)
+    {
+        static const char digits[] = "0123456789abcdef";
+        const QRgb rgb = color.rgb();
+        char text[8] = { '#' };
+        for (int i = 0; i < 6; ++i)
+            text[1 + i] = digits[(rgb >> (20 - 4 * i)) & 0xf];
+        m_buffer.append(text, 7);
+    }
+
+    void flushIfFull()
+    {
+        if (m_buffer.size() >= BUFFER_SIZE)
+            flush();
+    }
+
+    bool flush()
+    {
+        if (!m_buffer.isEmpty()) {
+            m_ok = m_ok && m_device.write(m_buffer) == m_buffer.size();
+            m_buffer.clear();
+        }
+        return m_ok;
+    }
+
+private:
+    QIODevice& m_device;
+    QByteArray m_buffer;
+    QByteArray m_number;
+    bool m_ok = true;
+};
+
+} // namespace
+
+bool SvgExport::save(const QString& path, const QVector<Shape>& shapes, QString* error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, file.errorString());
+        return false;
+    }
+    if (!write(file, shapes) || !file.commit()) {
+        setError(error, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool SvgExport::write(QIODevice& device, const QVector<Shape>& shapes)
+{
+    QVector<QPointF> local;
+    QVector<QPointF> world;
+
+    // Первый проход — только границы для viewBox, без хранения вершин
+    double left = std::numeric_limits<double>::max();
+    double top = std::numeric_limits<double>::max();
+    double right = std::numeric_limits<double>::lowest();
+    double bottom = std::numeric_limits<double>::lowest();
+    for (const Shape& shape : shapes) {
+        if (!shape.isVisible())
+            continue;
+        local = shape.vertices();
+        world.resize(local.size());
+        shape.transformVertices(local.constData(), world.data(), local.size());
+        for (const QPointF& point : std::as_const(world)) {
+            left = qMin(left, point.x());
+            top = qMin(top, point.y());
+            right = qMax(right, point.x());
+            bottom = qMax(bottom, point.y());
+        }
+    }
+    const QRectF bounds = left <= right
+        ? QRectF(QPointF(left, top), QPointF(right, bottom)).adjusted(-MARGIN, -MARGIN, MARGIN, MARGIN)
+        : QRectF(0, 0, 1, 1);
+
+    Writer out(device);
+    out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"");
+    out.appendNumber(bounds.x());
+    out.append(' ');
+    out.appendNumber(bounds.y());
+    out.append(' ');
+    out.appendNumber(bounds.width());
+    out.append(' ');
+    out.appendNumber(bounds.height());
+    out.append("\" width=\"");
+    out.appendNumber(bounds.width());
+    out.append("\" height=\"");
+    out.appendNumber(bounds.height());
+    out.append("\">\n<g fill-opacity=\"");
+    out.appendNumber(Shape::FillAlpha / 255.0);
+    out.append("\">\n");
+
+    for (const Shape& shape : shapes) {
+        if (!shape.isVisible())
+            continue;
+        local = shape.vertices();
+        world.resize(local.size());
+        shape.transformVertices(local.constData(), world.data(), local.size());
+
+        out.append("<polygon id=\"shape-");
+        out.appendInt(shape.id());
+        out.append("\" fill=\"");
+        out.appendColor(shape.color());
+        out.append("\" points=\"");
+        for (int i = 0; i < world.size(); ++i) {
+            if (i > 0)
+                out.append(' ');
+            out.appendNumber(world[i].x());
+            out.append(',');
+            out.appendNumber(world[i].y());
+        }
+        out.append("\"/>\n");
+        out.flushIfFull();
+    }
+
+    out.append("</g>\n</svg>\n");
+    return out.flush();
+}
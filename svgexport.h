@@ -0,0 +1,21 @@
+#ifndef SVGEXPORT_H
+#define SVGEXPORT_H
+
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+#include "shape.h"
+
+// Потоковый экспорт сцены в SVG. Фигуры идут в порядке отрисовки,
+// каждая — элемент <polygon> с мировыми координатами вершин (как в
+// Shape::transformVertices) и цветом Shape::color(). Текст копится в
+// буфере фиксированного размера и сбрасывается в устройство по мере
+// заполнения, поэтому память не зависит от размера сцены.
+class SvgExport
+{
+public:
+    static bool save(const QString& path, const QVector<Shape>& shapes, QString* error = nullptr);
+    static bool write(QIODevice& device, const QVector<Shape>& shapes);
+};
+
+#endif // SVGEXPORT_H
@@ -0,0 +1,526 @@
+#include "tilecache.h"
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include "rasterizer.h"
+
+namespace {
+
+// Сколько уровней вверх искать замену для ещё не готовой плитки
+const int MAX_FALLBACK = 3;
+// Защита от вырожденного вида: больше плиток за кадр не запрашивается
+const qint64 MAX_REQUEST = 4096;
+// Сетка записей: не больше ячеек по стороне; запись, покрывающая больше
+// MAX_BIN_CELLS ячеек, лежит в общем списке и проверяется каждой плиткой
+const int MAX_BIN_SIDE = 1024;
+const qint64 MAX_BIN_CELLS = 64;
+
+bool sameEntry(const SceneSnapshot::Entry& a, const SceneSnapshot::Entry& b)
+{
+    return a.id == b.id && a.visible == b.visible && a.selected == b.selected && a.color == b.color
+           && a.bounds == b.bounds && a.x == b.x && a.y == b.y;
+}
+
+int floorDiv(int value, int divisor)
+{
+    return int(std::floor(double(value) / divisor));
+}
+
+// Среднее четырёх пикселей по каналам: красный с синим и альфа с
+// зелёным складываются парами в 16-битных половинах слова
+quint32 average(quint32 a, quint32 b, quint32 c, quint32 d)
+{
+    const quint32 mask = 0x00ff00ff;
+    const quint32 rb = (a & mask) + (b & mask) + (c & mask) + (d & mask) + 0x00020002;
+    const quint32 ag = ((a >> 8) & mask) + ((b >> 8) & mask) + ((c >> 8) & mask) + ((d >> 8) & mask) + 0x00020002;
+    return ((rb >> 2) & mask) | (((ag >> 2) & mask) << 8);
+}
+
+} // namespace
+
+// Ячейки хранятся подряд: записи ячейки i — items[offsets[i]..offsets[i + 1]),
+// индексы в entries по возрастанию, то есть в порядке отрисовки
+struct TileCache::Bins
+{
+    std::once_flag built;
+    std::shared_ptr<const SceneSnapshot> snapshot;
+    QVector<const SceneSnapshot::Entry*> entries;
+    QRectF area;
+    double cell = 1.0;
+    int columns = 0;
+    int rows = 0;
+    QVector<int> offsets;
+    QVector<int> items;
+    QVector<int> large;
+
+    void build();
+    QRect cells(const QRectF& rect) const;
+    void query(const QRectF& rect, QVector<const SceneSnapshot::Entry*>& result) const;
+};
+
+void TileCache::Bins::build()
+{
+    for (int chunk = 0; chunk < snapshot->chunkCount(); ++chunk) {
+        for (const SceneSnapshot::Entry& entry : snapshot->chunk(chunk)->entries) {
+            if (!isCached(entry))
+                continue;
+            entries.append(&entry);
+            area = area.isNull() ? entry.bounds : area.united(entry.bounds);
+        }
+    }
+    if (entries.isEmpty())
+        return;
+
+    // В среднем запись на ячейку
+    cell = std::max({ std::sqrt(area.width() * area.height() / entries.size()),
+                  qMax(area.width(), area.height()) / MAX_BIN_SIDE, 1.0 });
+    columns = int(area.width() / cell) + 1;
+    rows = int(area.height() / cell) + 1;
+
+    // Два прохода: подсчёт по ячейкам, затем раскладка
+    offsets.fill(0, qsizetype(columns) * rows + 1);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < entries.size(); ++i) {
+            const QRect range = cells(entries[i]->bounds);
+            if (qint64(range.width()) * range.height() > MAX_BIN_CELLS) {
+                if (pass == 0)
+                    large.append(i);
+                continue;
+            }
+            for (int y = range.top(); y <= range.bottom(); ++y) {
+                for (int x = range.left(); x <= range.right(); ++x) {
+                    const int index = y * columns + x;
+                    if (pass == 0)
+                        ++offsets[index + 1];
+                    else
+                        items[offsets[index]++] = i;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int i = 1; i < offsets.size(); ++i)
+                offsets[i] += offsets[i - 1];
+            items.resize(offsets.last());
+        }
+    }
+    // Второй проход сдвинул начала ячеек на их концы
+    for (int i = offsets.size() - 1; i > 0; --i)
+        offsets[i] = offsets[i - 1];
+    offsets[0] = 0;
+}
+
+// Диапазон ячеек под прямоугольником, обрезанный сеткой; пустой, если
+// прямоугольник вне сетки
+QRect TileCache::Bins::cells(const QRectF& rect) const
+{
+    const int left = qMax(0, int(std::floor((rect.left() - area.left()) / cell)));
+    const int top = qMax(0, int(std::floor((rect.top() - area.top()) / cell)));
+    const int right = qMin(columns - 1, int(std::floor((rect.right() - area.left()) / cell)));
+    const int bottom = qMin(rows - 1, int(std::floor((rect.bottom() - area.top()) / cell)));
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void TileCache::Bins::query(const QRectF& rect, QVector<const SceneSnapshot::Entry*>& result) const
+{
+    QVector<int> found;
+    for (int i : large) {
+        if (entries[i]->bounds.intersects(rect))
+            found.append(i);
+    }
+    if (!entries.isEmpty() && rect.intersects(area)) {
+        const QRect range = cells(rect);
+        for (int y = range.top(); y <= range.bottom(); ++y) {
+            for (int x = range.left(); x <= range.right(); ++x) {
+                const int index = y * columns + x;
+                for (int item = offsets[index]; item < offsets[index + 1]; ++item) {
+                    if (entries[items[item]]->bounds.intersects(rect))
+                        found.append(items[item]);
+                }
+            }
+        }
+    }
+    // Запись из нескольких ячеек встречается несколько раз
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    result.reserve(found.size());
+    for (int i : std::as_const(found))
+        result.append(entries[i]);
+}
+
+TileCache::TileCache(float outlineWidth, std::function<void()> ready, int capacity)
+    : m_outlineWidth(outlineWidth)
+    , m_ready(std::move(ready))
+    , m_capacity(capacity)
+    , m_outline(outlineWidth)
+{
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+TileCache::~TileCache()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.clear();
+    }
+    m_pool.waitForDone();
+}
+
+bool TileCache::isCached(const SceneSnapshot::Entry& entry)
+{
+    return entry.visible && !entry.selected && entry.x.size() >= 3;
+}
+
+int TileCache::levelForScale(double scale)
+{
+    if (scale <= 0)
+        return MinLevel;
+    return qBound(MinLevel, int(std::ceil(std::log2(scale) - 1e-6)), MaxLevel);
+}
+
+double TileCache::levelScale(int level)
+{
+    return std::ldexp(1.0, level);
+}
+
+QRectF TileCache::tileRect(const Key& key)
+{
+    const double size = TilePixels / levelScale(key.level);
+    return QRectF(key.x * size, key.y * size, size, size);
+}
+
+void TileCache::setSnapshot(const std::shared_ptr<const SceneSnapshot>& snapshot)
+{
+    QMutexLocker locker(&m_mutex);
+    if (snapshot == m_snapshot)
+        return;
+    const std::shared_ptr<const SceneSnapshot> previous = std::move(m_snapshot);
+    m_snapshot = snapshot;
+    ++m_version;
+    m_bins.reset();
+    if (snapshot) {
+        m_bins = std::make_shared<Bins>();
+        m_bins->snapshot = snapshot;
+    }
+    if (!previous || !snapshot) {
+        m_changes.clear();
+        invalidateAll();
+        return;
+    }
+
+    // Неизменившиеся страницы общие у обоих снимков. Вставка и удаление
+    // сдвигают записи, и сдвинутые тоже считаются изменившимися.
+    QVector<QRectF> dirty;
+    QVector<const SceneSnapshot::Entry*> changed;
+    QVector<int> changedChunks;
+    const int chunkCount = qMax(previous->chunkCount(), snapshot->chunkCount());
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        const SceneSnapshot::Chunk* before = chunk < previous->chunkCount() ? previous->chunk(chunk).get() : nullptr;
+        const SceneSnapshot::Chunk* after = chunk < snapshot->chunkCount() ? snapshot->chunk(chunk).get() : nullptr;
+        if (before == after)
+            continue;
+        const int beforeCount = before ? before->entries.size() : 0;
+        const int afterCount = after ? after->entries.size() : 0;
+        for (int i = 0; i < qMax(beforeCount, afterCount); ++i) {
+            const SceneSnapshot::Entry* a = i < beforeCount ? &before->entries[i] : nullptr;
+            const SceneSnapshot::Entry* b = i < afterCount ? &after->entries[i] : nullptr;
+            if (a && b && sameEntry(*a, *b))
+                continue;
+            if (a && isCached(*a))
+                dirty.append(a->bounds);
+            if (b && isCached(*b))
+                dirty.append(b->bounds);
+            if (b) {
+                changed.append(b);
+                changedChunks.append(chunk);
+            }
+        }
+        if (dirty.size() > MaxDirtyRects) {
+            m_changes.clear();
+            invalidateAll();
+            return;
+        }
+    }
+    for (const QRectF& rect : std::as_const(dirty))
+        invalidate(rect);
+
+    for (int i = 0; i < changed.size(); ++i) {
+        const SceneSnapshot::Entry& entry = *changed[i];
+        if (isCached(entry))
+            m_changes.insert(entry.id, Change { m_version, entry.bounds, changedChunks[i] });
+        else
+            m_changes.remove(entry.id);
+    }
+    if (m_changes.size() > MaxDirtyRects)
+        m_changes.clear();
+}
+
+// На каждом уровне рамка переводится в диапазон ключей. Если диапазон
+// больше кэша (огромная фигура на мелком уровне), дешевле пройти кэш.
+// Запас — на самую толстую обводку уровня, вдвое толще экранной.
+void TileCache::invalidate(const QRectF& rect)
+{
+    for (int level = MinLevel; level <= MaxLevel; ++level) {
+        const double scale = levelScale(level);
+        const double size = TilePixels / scale;
+        const double margin = (m_outlineWidth + 1) / scale;
+        const int left = int(std::floor((rect.left() - margin) / size));
+        const int top = int(std::floor((rect.top() - margin) / size));
+        const int right = int(std::floor((rect.right() + margin) / size));
+        const int bottom = int(std::floor((rect.bottom() + margin) / size));
+
+        if (qint64(right - left + 1) * (bottom - top + 1) > m_tiles.size()) {
+            for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+                const Key& key = it.key();
+                if (key.level == level && key.x >= left && key.x <= right && key.y >= top && key.y <= bottom) {
+                    it->stale = true;
+                    ++it->epoch;
+                }
+            }
+            continue;
+        }
+        for (int y = top; y <= bottom; ++y) {
+            for (int x = left; x <= right; ++x) {
+                const auto it = m_tiles.find(Key { level, x, y });
+                if (it != m_tiles.end()) {
+                    it->stale = true;
+                    ++it->epoch;
+                }
+            }
+        }
+    }
+}
+
+void TileCache::invalidateAll()
+{
+    for (Tile& tile : m_tiles) {
+        tile.stale = true;
+        ++tile.epoch;
+    }
+}
+
+void TileCache::request(const QRectF& viewRect, double scale, QVector<Key>& keys)
+{
+    keys.clear();
+    const int level = levelForScale(scale);
+    const float outline = outlineWidth(scale, level);
+    const double size = TilePixels / levelScale(level);
+    const int left = int(std::floor(viewRect.left() / size));
+    const int top = int(std::floor(viewRect.top() / size));
+    const int right = int(std::ceil(viewRect.right() / size)) - 1;
+    const int bottom = int(std::ceil(viewRect.bottom() / size)) - 1;
+    if (viewRect.isEmpty() || qint64(right - left + 1) * (bottom - top + 1) > MAX_REQUEST)
+        return;
+
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x)
+            keys.append(Key { level, x, y });
+    }
+    // Сначала заполняется середина экрана
+    const double centerX = viewRect.center().x() / size - 0.5;
+    const double centerY = viewRect.center().y() / size - 0.5;
+    std::sort(keys.begin(), keys.end(), [centerX, centerY](const Key& a, const Key& b) {
+        return std::hypot(a.x - centerX, a.y - centerY) < std::hypot(b.x - centerX, b.y - centerY);
+    });
+
+    QMutexLocker locker(&m_mutex);
+    ++m_frame;
+    m_outline = outline;
+    m_queue.clear();
+    for (const Key& key : std::as_const(keys)) {
+        auto it = m_tiles.find(key);
+        if (it == m_tiles.end()) {
+            Tile tile;
+            tile.image = fromChildren(key);
+            if (!tile.image.isNull())
+                tile.revision = ++m_revision;
+            it = m_tiles.insert(key, tile);
+        }
+        Tile& tile = *it;
+        tile.lastUsed = m_frame;
+        // Старое изображение показывается, пока не готово новое
+        if (!tile.image.isNull() && tile.outline != outline)
+            tile.stale = true;
+        if (tile.stale && !tile.running)
+            m_queue.append(key);
+    }
+    evict();
+
+    const int workers = qMin(int(m_queue.size()), m_pool.maxThreadCount());
+    for (; m_workers < workers; ++m_workers)
+        m_pool.start([this]() { run(); });
+}
+
+// Вытесняются давно не нужные кадрам плитки; нужные текущему кадру
+// остаются, даже если их больше capacity
+void TileCache::evict()
+{
+    if (m_tiles.size() <= m_capacity)
+        return;
+    QVector<QPair<quint64, Key>> candidates;
+    for (auto it = m_tiles.cbegin(); it != m_tiles.cend(); ++it) {
+        if (it->lastUsed != m_frame && !it->running)
+            candidates.append({ it->lastUsed, it.key() });
+    }
+    const qsizetype excess = qMin(m_tiles.size() - m_capacity, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + excess, candidates.end(),
+                      [](const QPair<quint64, Key>& a, const QPair<quint64, Key>& b) { return a.first < b.first; });
+    for (qsizetype i = 0; i < excess; ++i)
+        m_tiles.remove(candidates[i].second);
+}
+
+// После отдаления у новой плитки бывают готовые четыре плитки уровнем
+// ниже: до перерисовки она показывает их, уменьшенные вдвое. Неполный
+// набор берётся, только если нет предка — тот размыт, но без дыр.
+QImage TileCache::fromChildren(const Key& key) const
+{
+    if (key.level >= MaxLevel)
+        return QImage();
+    const QImage* children[4] = {};
+    int found = 0;
+    for (int i = 0; i < 4; ++i) {
+        const auto it = m_tiles.constFind(Key { key.level + 1, key.x * 2 + i % 2, key.y * 2 + i / 2 });
+        if (it != m_tiles.cend() && !it->image.isNull()) {
+            children[i] = &it->image;
+            ++found;
+        }
+    }
+    if (found == 0 || (found < 4 && findAncestor(key, 1)))
+        return QImage();
+
+    QImage image(TilePixels, TilePixels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    uchar* bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+    const int half = TilePixels / 2;
+    for (int i = 0; i < 4; ++i) {
+        if (!children[i])
+            continue;
+        const uchar* source = children[i]->constBits();
+        const qsizetype sourceBytesPerLine = children[i]->bytesPerLine();
+        for (int y = 0; y < half; ++y) {
+            const quint32* top = reinterpret_cast<const quint32*>(source + qsizetype(2 * y) * sourceBytesPerLine);
+            const quint32* bottom = reinterpret_cast<const quint32*>(source + qsizetype(2 * y + 1) * sourceBytesPerLine);
+            quint32* line = reinterpret_cast<quint32*>(bits + qsizetype(i / 2 * half + y) * bytesPerLine) + i % 2 * half;
+            for (int x = 0; x < half; ++x)
+                line[x] = average(top[2 * x], top[2 * x + 1], bottom[2 * x], bottom[2 * x + 1]);
+        }
+    }
+    return image;
+}
+
+// Ближайший предок не выше MAX_FALLBACK уровней с готовым изображением;
+// from — с какого уровня вверх начинать (0 — сама плитка)
+const TileCache::Tile* TileCache::findAncestor(const Key& key, int from, Key* found) const
+{
+    for (int up = from; up <= MAX_FALLBACK && key.level - up >= MinLevel; ++up) {
+        const int factor = 1 << up;
+        const Key parent { key.level - up, floorDiv(key.x, factor), floorDiv(key.y, factor) };
+        const auto it = m_tiles.constFind(parent);
+        if (it == m_tiles.cend() || it->image.isNull())
+            continue;
+        if (found)
+            *found = parent;
+        return &*it;
+    }
+    return nullptr;
+}
+
+TileCache::Image TileCache::find(const Key& key) const
+{
+    QMutexLocker locker(&m_mutex);
+    Key parent;
+    const Tile* tile = findAncestor(key, 0, &parent);
+    if (!tile)
+        return Image();
+    const int factor = 1 << (key.level - parent.level);
+    const int size = TilePixels / factor;
+    Image result;
+    result.image = tile->image;
+    result.source = QRect((key.x - parent.x * factor) * size, (key.y - parent.y * factor) * size, size, size);
+    result.key = parent;
+    result.revision = tile->revision;
+    result.version = tile->version;
+    return result;
+}
+
+int TileCache::tileCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_tiles.size();
+}
+
+int TileCache::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_queue.size() + m_running;
+}
+
+// Рабочий поток разбирает общую очередь, пока она не опустеет; очередь
+// переписывается каждым кадром, так что ушедшие с экрана плитки не
+// рисуются
+void TileCache::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_queue.isEmpty()) {
+        const Key key = m_queue.takeFirst();
+        auto it = m_tiles.find(key);
+        if (it == m_tiles.end() || !it->stale || it->running)
+            continue;
+        it->running = true;
+        ++m_running;
+        const quint64 epoch = it->epoch;
+        const std::shared_ptr<Bins> bins = m_bins;
+        const quint64 version = m_version;
+        const float outline = m_outline;
+        locker.unlock();
+
+        QImage image = render(key, bins.get(), outline);
+
+        locker.relock();
+        --m_running;
+        it = m_tiles.find(key);
+        if (it == m_tiles.end())
+            continue;
+        it->running = false;
+        // Устаревший результат лучше пустой плитки; плитка остаётся
+        // устаревшей и перерисуется следующим кадром
+        if (it->epoch == epoch || it->image.isNull()) {
+            it->image = std::move(image);
+            it->outline = outline;
+            it->version = version;
+            it->revision = ++m_revision;
+        }
+        if (it->epoch == epoch)
+            it->stale = false;
+        locker.unlock();
+        if (m_ready)
+            m_ready();
+        locker.relock();
+    }
+    --m_workers;
+}
+
+float TileCache::outlineWidth(double scale, int level) const
+{
+    const double octave = scale > 0 ? qBound(0.0, std::log2(levelScale(level) / scale), 1.0) : 1.0;
+    return float(m_outlineWidth * std::exp2(std::round(octave * OutlineSteps) / OutlineSteps));
+}
+
+QImage TileCache::render(const Key& key, Bins* bins, float outline) const
+{
+    QImage image(TilePixels, TilePixels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    if (!bins)
+        return image;
+    // Остальные потоки ждут, пока первый разложит снимок
+    std::call_once(bins->built, [bins]() { bins->build(); });
+
+    const QRectF rect = tileRect(key);
+    const double margin = (outline / 2 + 1) / levelScale(key.level);
+    QVector<const SceneSnapshot::Entry*> entries;
+    bins->query(rect.adjusted(-margin, -margin, margin, margin), entries);
+    // Плитки и так рисуются параллельно, внутри плитки — один поток
+    Rasterizer::render(entries, rect, image, outline, 1);
+    return image;
+}
@@ -0,0 +1,183 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QRectF>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "scenesnapshot.h"
+
+// Кэш растровых плиток неподвижной части сцены для больших документов.
+// Плитка — TilePixels x TilePixels пикселей, ключ — (уровень, x, y):
+// на уровне level мировая единица занимает 2^level пикселей, плитка
+// (x, y) покрывает мировой прямоугольник tileRect(). Холст рисует
+// плитки текстурами, а поверх векторными узлами — только выделенную
+// фигуру; прокрутка и масштаб в пределах уровня сводятся к смене
+// матрицы над текстурами.
+//
+// На экране плитка уменьшена в levelScale/scale раз (от 1 до 2), поэтому
+// обводка в ней утолщена на столько же и совпадает с векторной. Толщина
+// округляется до OutlineSteps ступеней на октаву масштаба: видимые
+// плитки перерисовываются несколько раз за уровень, а не каждый кадр.
+//
+// Плитки заполняет Rasterizer в пуле потоков из неизменяемого снимка
+// сцены. Новый снимок сравнивается с прошлым по страницам: плитки под
+// старыми и новыми рамками изменившихся фигур помечаются устаревшими.
+// Ключи плиток сами по себе — равномерная сетка, поэтому рамка
+// переводится в диапазон ключей без обхода кэша. Устаревшая плитка
+// показывается, пока не готова новая. Новая плитка до первой отрисовки
+// берёт изображение у готовых плиток уровнем ниже (после отдаления),
+// а find() — у предков (после приближения).
+//
+// Фигура, изменившаяся после отрисовки плиток под ней, попадает в
+// changes(): пока на экране плитки, нарисованные из более старого
+// снимка (Image::version), холст рисует её узлами сам, иначе она
+// пропала бы с нового места до перерисовки. Старое изображение под
+// прежней рамкой остаётся до перерисовки плитки, как и раньше.
+//
+// Записи снимка раскладываются по ячейкам равномерной сетки (Bins) один
+// раз на снимок, и плитка перебирает только записи из ячеек под собой.
+//
+// Методы вызываются из одного потока (рендер-потока холста); ready —
+// из рабочего потока, когда появилось новое изображение.
+class TileCache
+{
+public:
+    static constexpr int TilePixels = 256;
+    static constexpr int MinLevel = -8;
+    static constexpr int MaxLevel = 8;
+    // Плитки, не нужные текущему кадру, вытесняются сверх этого числа
+    static constexpr int DefaultCapacity = 384;
+    // Больше изменившихся фигур — устаревшими помечаются все плитки
+    static constexpr int MaxDirtyRects = 4096;
+    static constexpr int OutlineSteps = 8;
+
+    struct Key
+    {
+        int level = 0;
+        int x = 0;
+        int y = 0;
+
+        bool operator==(const Key& other) const
+        {
+            return level == other.level && x == other.x && y == other.y;
+        }
+        bool operator!=(const Key& other) const { return !(*this == other); }
+    };
+
+    // Изображение для плитки: своё или, пока его нет, часть плитки
+    // более крупного уровня. source — область изображения в пикселях.
+    struct Image
+    {
+        QImage image;
+        QRect source;
+        Key key;
+        quint64 revision = 0;
+        // Версия снимка, из которого нарисовано изображение
+        quint64 version = 0;
+    };
+
+    // version — версия снимка с изменением, chunk — страница фигуры в нём
+    struct Change
+    {
+        quint64 version = 0;
+        QRectF bounds;
+        int chunk = -1;
+    };
+
+    // outlineWidth — толщина обводки в пикселях экрана, как на холсте
+    TileCache(float outlineWidth, std::function<void()> ready, int capacity = DefaultCapacity);
+    ~TileCache();
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // Фигуры, которые рисуются в плитках; выделенная рисуется холстом поверх
+    static bool isCached(const SceneSnapshot::Entry& entry);
+    // Наименьший уровень, на котором плитки не растягиваются на экране
+    static int levelForScale(double scale);
+    static double levelScale(int level);
+    static QRectF tileRect(const Key& key);
+
+    void setSnapshot(const std::shared_ptr<const SceneSnapshot>& snapshot);
+
+    // Ключи плиток уровня levelForScale(scale), покрывающих viewRect, от
+    // центра к краям. Недостающие, устаревшие и нарисованные с другой
+    // толщиной обводки плитки ставятся в очередь вместо запрошенных
+    // прошлым кадром.
+    void request(const QRectF& viewRect, double scale, QVector<Key>& keys);
+
+    // Пустое image, если ни у плитки, ни у её предков изображения нет
+    Image find(const Key& key) const;
+
+    // id фигуры -> изменение. Холст убирает фигуру через settle(), когда
+    // все видимые плитки под ней не старше изменения. Больше
+    // MaxDirtyRects изменений разом (вставка в начало, массовая правка)
+    // не отслеживаются: такие кадры показывают устаревшие плитки.
+    const QHash<int, Change>& changes() const { return m_changes; }
+    void settle(int id) { m_changes.remove(id); }
+
+    int tileCount() const;
+    // Плитки в очереди и в работе
+    int pendingCount() const;
+
+private:
+    struct Tile
+    {
+        QImage image;
+        quint64 revision = 0;
+        quint64 version = 0;
+        // Увеличивается при каждом устаревании; результат, начатый
+        // с другим значением, плитку не обновляет
+        quint64 epoch = 0;
+        quint64 lastUsed = 0;
+        // Толщина обводки в image, пиксели уровня
+        float outline = 0;
+        bool stale = true;
+        bool running = false;
+    };
+
+    struct Bins;
+
+    void invalidate(const QRectF& rect);
+    void invalidateAll();
+    void evict();
+    void run();
+    QImage fromChildren(const Key& key) const;
+    const Tile* findAncestor(const Key& key, int from, Key* found = nullptr) const;
+    float outlineWidth(double scale, int level) const;
+    QImage render(const Key& key, Bins* bins, float outline) const;
+
+    const float m_outlineWidth;
+    const std::function<void()> m_ready;
+    const int m_capacity;
+
+    mutable QMutex m_mutex;
+    QHash<Key, Tile> m_tiles;
+    QVector<Key> m_queue;
+    std::shared_ptr<const SceneSnapshot> m_snapshot;
+    // Номер снимка m_snapshot, растёт с каждым setSnapshot()
+    quint64 m_version = 0;
+    // Сетка записей m_snapshot, строится первым рабочим потоком
+    std::shared_ptr<Bins> m_bins;
+    QHash<int, Change> m_changes;
+    // Толщина обводки для плиток текущего уровня, пиксели уровня
+    float m_outline = 0;
+    quint64 m_revision = 0;
+    quint64 m_frame = 0;
+    int m_running = 0;
+    int m_workers = 0;
+    QThreadPool m_pool;
+};
+
+inline size_t qHash(const TileCache::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.level, key.x, key.y);
+}
+
+#endif // TILECACHE_H
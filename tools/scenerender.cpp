@@ -0,0 +1,88 @@
+#include "rasterizer.h"
+#include "scenefile.h"
+#include "sceneimport.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+
+// Рендер сцены в PNG программным растеризатором (см. Rasterizer): без
+// GPU, окна и Qt Quick, поэтому работает на сборочных агентах.
+// Вход — файл сцены (*.pssc) или SVG/JSON, который читает SceneImport.
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Software scene renderer"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("scene"), QStringLiteral("Scene file (*.pssc), SVG or JSON."));
+    parser.addPositionalArgument(QStringLiteral("image"), QStringLiteral("Output image (PNG)."));
+    parser.addOptions({
+        { QStringLiteral("size"), QStringLiteral("Longer side of the image in pixels."), QStringLiteral("px"),
+          QStringLiteral("1024") },
+        { QStringLiteral("background"), QStringLiteral("Background color, transparent by default."),
+          QStringLiteral("color") },
+        { QStringLiteral("threads"), QStringLiteral("Rasterizer threads, 0 for one per core."), QStringLiteral("n"),
+          QStringLiteral("0") },
+    });
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 2)
+        parser.showHelp(1);
+
+    const QString scenePath = parser.positionalArguments().at(0);
+    const QString imagePath = parser.positionalArguments().at(1);
+    const int size = parser.value(QStringLiteral("size")).toInt();
+    if (size <= 0) {
+        qWarning("scenerender: invalid --size");
+        return 1;
+    }
+    QColor background(Qt::transparent);
+    if (parser.isSet(QStringLiteral("background"))) {
+        background = QColor::fromString(parser.value(QStringLiteral("background")));
+        if (!background.isValid()) {
+            qWarning("scenerender: invalid --background");
+            return 1;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<Shape> shapes;
+    QString error;
+    bool loaded = false;
+    if (QFileInfo(scenePath).suffix().compare(QStringLiteral("pssc"), Qt::CaseInsensitive) == 0) {
+        SceneFile file;
+        loaded = file.open(scenePath, &error);
+        if (loaded)
+            shapes = file.shapes();
+    } else {
+        loaded = SceneImport::load(scenePath, &shapes, &error);
+    }
+    if (!loaded) {
+        qWarning("scenerender: %s: %s", qPrintable(scenePath), qPrintable(error));
+        return 1;
+    }
+    const qint64 loadTime = timer.restart();
+
+    const QImage image = Rasterizer::renderScene(shapes, size, background,
+                                                 parser.value(QStringLiteral("threads")).toInt());
+    const qint64 renderTime = timer.restart();
+
+    if (!image.save(imagePath)) {
+        qWarning("scenerender: cannot write %s", qPrintable(imagePath));
+        return 1;
+    }
+
+    QTextStream(stdout) << QStringLiteral("%1 shapes, %2x%3 px: load %4 ms, render %5 ms, save %6 ms\n")
+                               .arg(shapes.size())
+                               .arg(image.width())
+                               .arg(image.height())
+                               .arg(loadTime)
+                               .arg(renderTime)
+                               .arg(timer.elapsed());
+    return 0;
+}
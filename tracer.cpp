@@ -0,0 +1,129 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QSet>
+
+namespace {
+
+void setError(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+}
+
+// Chrome ждёт микросекунды; дробная часть сохраняет точность до нс
+QByteArray micros(qint64 nanoseconds)
+{
+    return QByteArray::number(nanoseconds / 1000.0, 'f', 3);
+}
+
+QByteArray quoted(const QString& text)
+{
+    QByteArray result = text.toUtf8();
+    result.replace('\\', "\\\\").replace('"', "\\\"");
+    return '"' + result + '"';
+}
+
+} // namespace
+
+Tracer::Tracer(int maxEvents)
+    : m_maxEvents(maxEvents)
+{
+    m_records.reserve(qMin(maxEvents, 65536));
+    Profiler::addSink(this);
+
+    m_timer.setInterval(100);
+    QObject::connect(&m_timer, &QTimer::timeout, &Profiler::collect);
+    m_timer.start();
+}
+
+Tracer::~Tracer()
+{
+    Profiler::removeSink(this);
+}
+
+void Tracer::consume(const QVector<Profiler::Record>& records, const Profiler::Counters& counters,
+                     qint64 dropped)
+{
+    const int room = qMax(0, m_maxEvents - m_records.size());
+    const int taken = qMin(room, int(records.size()));
+    m_records.append(records.mid(0, taken));
+    m_dropped += dropped + (records.size() - taken);
+
+    CounterSample sample;
+    sample.time = Profiler::now();
+    sample.values = counters;
+    sample.dropped = m_dropped;
+    m_counters.append(sample);
+}
+
+bool Tracer::save(const QString& path, QString* error)
+{
+    Profiler::collect();
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setError(error, file.errorString());
+        return false;
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray out;
+    out.reserve(4 * 1024 * 1024);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto beginEvent = [&]() {
+        if (!first)
+            out += ",\n";
+        first = false;
+    };
+    // Пишем кусками, чтобы не держать в памяти всю трассу в виде текста
+    auto flush = [&]() {
+        if (out.size() < 1024 * 1024)
+            return true;
+        const bool ok = file.write(out) == out.size();
+        out.clear();
+        return ok;
+    };
+
+    QSet<quint16> threads;
+    for (const Profiler::Record& record : std::as_const(m_records))
+        threads.insert(record.thread);
+    for (quint16 thread : std::as_const(threads)) {
+        beginEvent();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(thread)
+               + ",\"args\":{\"name\":" + quoted(Profiler::threadName(thread)) + "}}";
+    }
+
+    bool ok = true;
+    for (const Profiler::Record& record : std::as_const(m_records)) {
+        beginEvent();
+        out += "{\"name\":\"";
+        out += Profiler::stageName(record.stage);
+        out += "\",\"cat\":\"paintshape\",\"ph\":\"X\",\"ts\":" + micros(record.start)
+               + ",\"dur\":" + micros(record.duration) + ",\"pid\":" + pid
+               + ",\"tid\":" + QByteArray::number(record.thread) + '}';
+        ok = ok && flush();
+    }
+
+    for (const CounterSample& sample : std::as_const(m_counters)) {
+        beginEvent();
+        out += "{\"name\":\"counters\",\"ph\":\"C\",\"ts\":" + micros(sample.time) + ",\"pid\":" + pid + ",\"args\":{";
+        for (int counter = 0; counter < Profiler::CounterCount; ++counter) {
+            out += '"';
+            out += Profiler::counterName(counter);
+            out += "\":" + QByteArray::number(sample.values[counter]) + ',';
+        }
+        out += "\"dropped\":" + QByteArray::number(sample.dropped) + "}}";
+        ok = ok && flush();
+    }
+
+    out += "\n]}\n";
+    ok = ok && file.write(out) == out.size();
+    if (!ok) {
+        setError(error, file.errorString());
+        return false;
+    }
+    return true;
+}
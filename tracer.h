@@ -0,0 +1,50 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include "profiler.h"
+
+// Запись трассы в памяти для chrome://tracing и Perfetto. Пока объект
+// существует, профилировщик включён; записи забираются из буферов
+// потоков раз в 100 мс и копятся здесь до save(). Каждая стадия — событие
+// полной длительности ("X") на дорожке своего потока, счётчики —
+// события "C" с суммой за интервал сбора.
+class Tracer : public Profiler::Sink
+{
+public:
+    static constexpr int DefaultMaxEvents = 1000000;
+
+    // После maxEvents записей новые отбрасываются и учитываются в dropped
+    explicit Tracer(int maxEvents = DefaultMaxEvents);
+    ~Tracer() override;
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    void consume(const QVector<Profiler::Record>& records, const Profiler::Counters& counters,
+                 qint64 dropped) override;
+
+    int eventCount() const { return m_records.size(); }
+    qint64 droppedCount() const { return m_dropped; }
+
+    // Забирает свежие записи и пишет трассу в формате Chrome JSON
+    bool save(const QString& path, QString* error = nullptr);
+
+private:
+    struct CounterSample
+    {
+        qint64 time = 0;
+        Profiler::Counters values {};
+        qint64 dropped = 0;
+    };
+
+    const int m_maxEvents;
+    QTimer m_timer;
+    QVector<Profiler::Record> m_records;
+    QVector<CounterSample> m_counters;
+    qint64 m_dropped = 0;
+};
+
+#endif // TRACER_H
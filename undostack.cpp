@@ -0,0 +1,326 @@
+#include "undostack.h"
+
+UndoStack::Transform UndoStack::Transform::of(const Shape& shape)
+{
+    Transform transform;
+    transform.position = shape.position();
+    transform.rotation = shape.rotation();
+    transform.scale = shape.scale();
+    return transform;
+}
+
+void UndoStack::Transform::applyTo(Shape& shape) const
+{
+    shape.setRotation(rotation);
+    shape.setScale(scale);
+    shape.setPosition(position);
+}
+
+bool UndoStack::Command::isStructural() const
+{
+    for (const Delta& delta : deltas) {
+        if (delta.type == Delta::InsertShape || delta.type == Delta::RemoveShape)
+            return true;
+    }
+    return false;
+}
+
+void UndoStack::setMemoryBudget(qsizetype bytes)
+{
+    m_budget = qMax<qsizetype>(0, bytes);
+    trim();
+}
+
+void UndoStack::beginGroup()
+{
+    if (m_depth++ == 0)
+        m_pending.serial = ++m_serial;
+}
+
+void UndoStack::endGroup()
+{
+    if (m_depth == 0 || --m_depth > 0)
+        return;
+
+    m_pendingIds.clear();
+    Command command = std::move(m_pending);
+    m_pending = Command();
+    if (!command.deltas.isEmpty())
+        push(std::move(command));
+}
+
+void UndoStack::recordTransform(int id, int index, const Transform& before, const Transform& after, quint64 mergeKey)
+{
+    Delta delta;
+    delta.type = Delta::ChangeTransform;
+    delta.id = id;
+    delta.index = index;
+    delta.before = before;
+    delta.after = after;
+    submit(delta, nullptr, nullptr, mergeKey);
+}
+
+void UndoStack::recordShape(int index, const Shape& before, const Shape& after, quint64 mergeKey)
+{
+    Delta delta;
+    delta.type = Delta::ChangeShape;
+    delta.id = after.id();
+    delta.index = index;
+    submit(delta, &before, &after, mergeKey);
+}
+
+void UndoStack::recordInsert(int index, const Shape& shape)
+{
+    Delta delta;
+    delta.type = Delta::InsertShape;
+    delta.id = shape.id();
+    delta.index = index;
+    submit(delta, nullptr, &shape, 0);
+}
+
+void UndoStack::recordRemove(int index, const Shape& shape)
+{
+    Delta delta;
+    delta.type = Delta::RemoveShape;
+    delta.id = shape.id();
+    delta.index = index;
+    submit(delta, &shape, nullptr, 0);
+}
+
+void UndoStack::amendTransform(quint64 command, int id, int index, const Transform& before, const Transform& after)
+{
+    Delta delta;
+    delta.type = Delta::ChangeTransform;
+    delta.id = id;
+    delta.index = index;
+    delta.before = before;
+    delta.after = after;
+    if (m_observer)
+        m_observer->deltaRecorded(delta, nullptr);
+
+    if (command != 0 && m_index > m_first && m_index == m_commands.size() && m_commands[m_index - 1].serial == command) {
+        recordIntoLast(delta, nullptr, nullptr);
+    } else if (m_depth > 0) {
+        record(m_pending, &m_pendingIds, delta, nullptr, nullptr);
+    } else {
+        Command amendment;
+        record(amendment, nullptr, delta, nullptr, nullptr);
+        push(std::move(amendment));
+    }
+}
+
+const UndoStack::Command* UndoStack::undo()
+{
+    if (!canUndo())
+        return nullptr;
+    m_mergeKey = 0;
+    const Command* command = &m_commands[--m_index];
+    if (m_observer)
+        m_observer->commandApplied(*command, true);
+    return command;
+}
+
+const UndoStack::Command* UndoStack::redo()
+{
+    if (!canRedo())
+        return nullptr;
+    m_mergeKey = 0;
+    const Command* command = &m_commands[m_index++];
+    if (m_observer)
+        m_observer->commandApplied(*command, false);
+    return command;
+}
+
+void UndoStack::clear()
+{
+    m_commands.clear();
+    m_first = 0;
+    m_index = 0;
+    m_usage = 0;
+    m_pending = Command();
+    m_pendingIds.clear();
+    m_lastIds.clear();
+    m_lastIdsSerial = 0;
+    m_mergeKey = 0;
+    m_lastCommand = 0;
+}
+
+void UndoStack::submit(const Delta& delta, const Shape* before, const Shape* after, quint64 mergeKey)
+{
+    if (m_observer)
+        m_observer->deltaRecorded(delta, after);
+
+    if (m_depth > 0) {
+        record(m_pending, &m_pendingIds, delta, before, after);
+        m_lastCommand = m_pending.serial;
+        return;
+    }
+
+    if (mergeKey != 0 && mergeKey == m_mergeKey && m_index > m_first && m_index == m_commands.size()) {
+        recordIntoLast(delta, before, after);
+        m_lastCommand = m_commands[m_index - 1].serial;
+        return;
+    }
+
+    Command command;
+    command.mergeKey = mergeKey;
+    record(command, nullptr, delta, before, after);
+    push(std::move(command));
+    m_lastCommand = m_commands[m_index - 1].serial;
+}
+
+void UndoStack::recordIntoLast(const Delta& delta, const Shape* before, const Shape* after)
+{
+    Command& command = m_commands[m_index - 1];
+    if (m_lastIdsSerial != command.serial) {
+        m_lastIds.clear();
+        for (int i = 0; i < command.deltas.size(); ++i) {
+            const Delta& recorded = command.deltas[i];
+            if (recorded.type == Delta::RemoveShape)
+                m_lastIds.remove(recorded.id);
+            else
+                m_lastIds.insert(recorded.id, i);
+        }
+        m_lastIdsSerial = command.serial;
+    }
+    const qsizetype bytes = command.bytes;
+    record(command, &m_lastIds, delta, before, after);
+    m_usage += command.bytes - bytes;
+    trim();
+}
+
+// ids ускоряет поиск в больших группах; без него команда
+// просматривается с конца
+void UndoStack::record(Command& command, QHash<int, int>* ids, Delta delta, const Shape* before, const Shape* after)
+{
+    if (delta.type == Delta::ChangeTransform || delta.type == Delta::ChangeShape) {
+        const int target = ids ? ids->value(delta.id, -1) : findMergeTarget(command, delta.id);
+        if (target >= 0) {
+            merge(command, command.deltas[target], delta, before, after);
+            return;
+        }
+    }
+
+    switch (delta.type) {
+    case Delta::ChangeTransform:
+        break;
+    case Delta::ChangeShape:
+        delta.state = command.states.size();
+        command.states.append(*before);
+        command.states.append(*after);
+        command.bytes += stateBytes(*before) + stateBytes(*after);
+        break;
+    case Delta::InsertShape:
+        delta.state = command.states.size();
+        command.states.append(*after);
+        command.bytes += stateBytes(*after);
+        break;
+    case Delta::RemoveShape:
+        delta.state = command.states.size();
+        command.states.append(*before);
+        command.bytes += stateBytes(*before);
+        break;
+    }
+
+    if (ids) {
+        if (delta.type == Delta::RemoveShape)
+            ids->remove(delta.id);
+        else
+            ids->insert(delta.id, command.deltas.size());
+    }
+    command.deltas.append(delta);
+    command.bytes += qsizetype(sizeof(Delta));
+}
+
+// Сохраняется самое раннее состояние «до» и самое позднее «после»
+void UndoStack::merge(Command& command, Delta& target, const Delta& delta, const Shape* before, const Shape* after)
+{
+    if (delta.type == Delta::ChangeTransform) {
+        switch (target.type) {
+        case Delta::ChangeTransform:
+            target.after = delta.after;
+            break;
+        case Delta::ChangeShape:
+            delta.after.applyTo(command.states[target.state + 1]);
+            break;
+        case Delta::InsertShape:
+            delta.after.applyTo(command.states[target.state]);
+            break;
+        case Delta::RemoveShape:
+            break;
+        }
+        return;
+    }
+
+    switch (target.type) {
+    case Delta::ChangeTransform: {
+        // Перемещение, за которым последовала правка формы: начальное
+        // состояние — форма до правки в исходном положении
+        Shape initial = *before;
+        target.before.applyTo(initial);
+        target.type = Delta::ChangeShape;
+        target.state = command.states.size();
+        command.states.append(initial);
+        command.states.append(*after);
+        command.bytes += stateBytes(initial) + stateBytes(*after);
+        break;
+    }
+    case Delta::ChangeShape:
+        command.bytes += stateBytes(*after) - stateBytes(command.states[target.state + 1]);
+        command.states[target.state + 1] = *after;
+        break;
+    case Delta::InsertShape:
+        command.bytes += stateBytes(*after) - stateBytes(command.states[target.state]);
+        command.states[target.state] = *after;
+        break;
+    case Delta::RemoveShape:
+        break;
+    }
+}
+
+void UndoStack::push(Command&& command)
+{
+    while (m_commands.size() > m_index)
+        m_usage -= m_commands.takeLast().bytes;
+
+    m_mergeKey = command.mergeKey;
+    if (command.serial == 0)
+        command.serial = ++m_serial;
+    m_usage += command.bytes;
+    m_commands.append(std::move(command));
+    ++m_index;
+    trim();
+}
+
+// Последняя выполненная команда остаётся, даже если одна превышает бюджет
+void UndoStack::trim()
+{
+    while (m_usage > m_budget && m_index - m_first > 1) {
+        m_usage -= m_commands[m_first].bytes;
+        m_commands[m_first++] = Command();
+    }
+    while (m_usage > m_budget && m_commands.size() > qMax(m_index, m_first + 1))
+        m_usage -= m_commands.takeLast().bytes;
+
+    if (m_first > 0 && m_first >= m_commands.size() / 2) {
+        m_commands.remove(0, m_first);
+        m_index -= m_first;
+        m_first = 0;
+    }
+}
+
+// Верхняя оценка: вершины фигур обычно разделены со сценой
+qsizetype UndoStack::stateBytes(const Shape& shape)
+{
+    return qsizetype(sizeof(Shape)) + shape.vertices().size() * qsizetype(sizeof(QPointF))
+           + shape.name().size() * qsizetype(sizeof(QChar));
+}
+
+int UndoStack::findMergeTarget(const Command& command, int id)
+{
+    for (int i = command.deltas.size() - 1; i >= 0; --i) {
+        if (command.deltas[i].id == id)
+            return command.deltas[i].type == Delta::RemoveShape ? -1 : i;
+    }
+    return -1;
+}
@@ -0,0 +1,148 @@
+#ifndef UNDOSTACK_H
+#define UNDOSTACK_H
+
+#include <QHash>
+#include <QPointF>
+#include <QVector>
+#include "shape.h"
+
+// История правок сцены. Команда хранит не копию сцены, а дельты
+// затронутых фигур: для перемещения, поворота и масштаба — только
+// положение до и после, для остальных правок — состояние фигуры до и
+// после (вершины разделяются неявно, без копирования). Отмена и повтор
+// стоят O(изменений). Размер истории ограничен бюджетом памяти, а не
+// числом шагов: старые команды вытесняются первыми.
+class UndoStack
+{
+public:
+    static constexpr qsizetype DefaultMemoryBudget = 32 * 1024 * 1024;
+
+    struct Transform
+    {
+        QPointF position;
+        double rotation = 0.0;
+        double scale = 1.0;
+
+        static Transform of(const Shape& shape);
+        void applyTo(Shape& shape) const;
+    };
+
+    struct Delta
+    {
+        enum Type : quint8 { ChangeTransform, ChangeShape, InsertShape, RemoveShape };
+
+        Type type = ChangeTransform;
+        int id = -1;
+        // Индекс фигуры в порядке отрисовки на момент изменения (для
+        // вставки — после неё). История применяется строго по порядку,
+        // поэтому фигура находится по индексу без поиска.
+        int index = -1;
+        Transform before;
+        Transform after;
+        // ChangeShape: states[state] — до, states[state + 1] — после;
+        // InsertShape / RemoveShape: states[state] — фигура целиком
+        int state = -1;
+    };
+
+    struct Command
+    {
+        QVector<Delta> deltas;
+        QVector<Shape> states;
+        quint64 mergeKey = 0;
+        // Оценка занимаемой памяти, ведётся по мере записи
+        qsizetype bytes = qsizetype(sizeof(Command));
+        // Номер команды, уникальный за всё время жизни стека
+        quint64 serial = 0;
+
+        bool isStructural() const;
+    };
+
+    // Получатель всех изменений сцены в порядке их применения (см.
+    // AutosaveJournal). Записи приходят сразу, не дожидаясь закрытия
+    // группы; поправки — даже когда выполненных команд нет.
+    class Observer
+    {
+    public:
+        virtual ~Observer() = default;
+        // after — состояние фигуры для ChangeShape и InsertShape
+        virtual void deltaRecorded(const Delta& delta, const Shape* after) = 0;
+        virtual void commandApplied(const Command& command, bool undo) = 0;
+    };
+
+    void setObserver(Observer* observer) { m_observer = observer; }
+
+    void setMemoryBudget(qsizetype bytes);
+    qsizetype memoryBudget() const { return m_budget; }
+    qsizetype memoryUsage() const { return m_usage; }
+    int count() const { return m_commands.size() - m_first; }
+
+    // Всё, что записано между beginGroup() и endGroup(), становится
+    // одной командой; правки одной фигуры внутри группы сливаются.
+    // Группы могут быть вложенными.
+    void beginGroup();
+    void endGroup();
+    bool isGrouping() const { return m_depth > 0; }
+
+    // Вне группы каждая запись — отдельная команда. Подряд идущие
+    // записи с одинаковым ненулевым mergeKey (ползунок, поле ввода)
+    // сливаются в одну.
+    void recordTransform(int id, int index, const Transform& before, const Transform& after, quint64 mergeKey = 0);
+    void recordShape(int index, const Shape& before, const Shape& after, quint64 mergeKey = 0);
+    void recordInsert(int index, const Shape& shape);
+    void recordRemove(int index, const Shape& shape);
+    // Номер команды (или открытой группы), в которую попала последняя
+    // запись; 0 — записей не было
+    quint64 lastCommand() const { return m_lastCommand; }
+    // Поправка, пришедшая после команды command (например, разрешение
+    // столкновений в потоке симуляции). Дописывается в command, только
+    // если та последняя и истории повтора нет; иначе становится
+    // отдельной командой (или частью открытой группы), чтобы отмена
+    // более поздней правки не откатывала и поправку.
+    void amendTransform(quint64 command, int id, int index, const Transform& before, const Transform& after);
+
+    bool canUndo() const { return m_depth == 0 && m_index > m_first; }
+    bool canRedo() const { return m_depth == 0 && m_index < m_commands.size(); }
+    // Возвращают команду, которую нужно применить: при отмене дельты
+    // применяются в обратном порядке с состоянием «до», при повторе —
+    // в прямом с состоянием «после». nullptr, если применять нечего.
+    const Command* undo();
+    const Command* redo();
+    void clear();
+
+    static quint64 mergeKey(int property, int id) { return (quint64(quint32(property)) << 32) | quint32(id); }
+
+private:
+    void submit(const Delta& delta, const Shape* before, const Shape* after, quint64 mergeKey);
+    void recordIntoLast(const Delta& delta, const Shape* before, const Shape* after);
+    void record(Command& command, QHash<int, int>* ids, Delta delta, const Shape* before, const Shape* after);
+    void merge(Command& command, Delta& target, const Delta& delta, const Shape* before, const Shape* after);
+    void push(Command&& command);
+    void trim();
+    static qsizetype stateBytes(const Shape& shape);
+    static int findMergeTarget(const Command& command, int id);
+
+    // Вытесненные команды в начале m_commands (до m_first) пусты и
+    // удаляются разом, когда их становится больше половины
+    QVector<Command> m_commands;
+    int m_first = 0;
+    // Конец выполненных команд; всё после него — история повтора
+    int m_index = 0;
+    qsizetype m_budget = DefaultMemoryBudget;
+    qsizetype m_usage = 0;
+
+    int m_depth = 0;
+    Command m_pending;
+    // id фигуры -> дельта открытой группы, с которой сливаются правки
+    QHash<int, int> m_pendingIds;
+    // То же для последней команды m_lastIdsSerial, в которую дописывают
+    // слияние по ключу и поправки; строится при первой такой записи
+    QHash<int, int> m_lastIds;
+    quint64 m_lastIdsSerial = 0;
+    // Ключ слияния последней команды; сбрасывается отменой и повтором
+    quint64 m_mergeKey = 0;
+    quint64 m_serial = 0;
+    quint64 m_lastCommand = 0;
+    Observer* m_observer = nullptr;
+};
+
+#endif // UNDOSTACK_H
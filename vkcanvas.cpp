@@ -1,17 +1,71 @@
 #include "vkcanvas.h"
+#include <algorithm>
 #include <cmath>
 #include <QTransform>
 #include <QPainter>
 #include <QSGGeometryNode>
 #include <QSGFlatColorMaterial>
+#include <QSGTransformNode>
+#include <QSGSimpleTextureNode>
+#include <QMatrix4x4>
+#include "outlinematerial.h"
+#include "gridmaterial.h"
+#include "gizmonode.h"
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QHoverEvent>
 #include <QTimer>
+#include <QQuickWindow>
+#include <QDateTime>
+#include <QSet>
+#include <QUrl>
+#include <QElapsedTimer>
+#include <QStandardPaths>
 #include <qcursor.h>
 
 const double PI = 3.141592653589793;
 
+namespace {
+
+// Толщина обводки фигур в пикселях экрана; край сглаживается полосой
+// в пиксель с прозрачностью, спадающей до нуля
+const float OutlineWidth = 1.5f;
+const float SelectedOutlineWidth = 2.5f;
+
+// Страница фигур в мировых координатах. Перестраивается только при
+// изменении её фигур; целиком за пределами экрана страница
+// отключается (isSubtreeBlocked), геометрия при этом не трогается.
+class ChunkNode : public QSGNode
+{
+public:
+    bool isSubtreeBlocked() const override { return culled; }
+
+    QRectF bounds;
+    bool culled = false;
+};
+
+// Плитка TileCache в пикселях своего уровня. Пока своё изображение не
+// готово, показывает часть плитки более крупного уровня; source и
+// revision — какое изображение сейчас в текстуре.
+class TileNode : public QSGSimpleTextureNode
+{
+public:
+    TileCache::Key source;
+    quint64 revision = 0;
+    quint64 version = 0;
+    // Номер кадра, в котором плитка была на экране
+    quint64 frame = 0;
+};
+
+// FileDialog отдаёт file:// URL, остальные вызовы — обычный путь
+QString localScenePath(const QString &path)
+{
+    const QUrl url(path);
+    return url.isLocalFile() ? url.toLocalFile() : path;
+}
+
+} // namespace
+
 VKCanvas::VKCanvas(QQuickItem *parent)
     : QQuickItem(parent)
 {
@@ -27,6 +81,23 @@ VKCanvas::VKCanvas(QQuickItem *parent)
         emit shapeCountChanged();
         update();
     }
+    // Стартовая фигура — часть пустого документа, а не правка
+    c_undoStack.clear();
+    updateHistoryState();
+
+    const QString recordPath = qEnvironmentVariable("PAINTSHAPE_RECORD_INPUT");
+    if (!recordPath.isEmpty()) {
+        // Ждём, пока QML выставит размер холста
+        QTimer::singleShot(0, this, [this, recordPath]() { startInputRecording(recordPath); });
+    }
+
+    connect(this, &QQuickItem::windowChanged, this, &VKCanvas::connectWindowTiming);
+
+    const QString tracePath = qEnvironmentVariable("PAINTSHAPE_TRACE");
+    if (!tracePath.isEmpty()) {
+        startTrace();
+        c_tracePath = tracePath;
+    }
 }
 
 QPointF VKCanvas::getShapeVertexWorld(int shapeId, int vertexIndex) const
@@ -59,8 +130,9 @@ void VKCanvas::setSelectedShapeId(int id)
     setSelectedEdgeIndex(-1);
 
     emit selectedShapeIdChanged();
-    emit vertexInfoUpdated();
+    notifyVertexInfoUpdated();
 
+    polish();
     update();
 }
 
@@ -89,6 +161,11 @@ int VKCanvas::addShapeWithSides(float x, float y, int sides, float sizeWidth, fl
     shape.setCollisionsEnabled(true);
 
     c_shapes.append(shape);
+    c_sceneStore.append(shape);
+    markShapeDirty(c_shapes.size() - 1);
+    postSimulation(SimulationWorker::Command::Insert, shape);
+    c_undoStack.recordInsert(c_shapes.size() - 1, shape);
+    updateHistoryState();
 
     qDebug() << "Координаты:" << QString("(%1, %2)").arg(x, 0, 'f', 2).arg(y, 0, 'f', 2);
     QVector<QPointF> vertices = shape.vertices();
@@ -113,18 +190,62 @@ int VKCanvas::addShapeWithSides(float x, float y, int sides, float sizeWidth, fl
     setSelectedShapeId(shape.id());
 
     if (!m_blockTableUpdates) {
-        emit vertexInfoUpdated();
+        notifyVertexInfoUpdated();
     }
     update();
     return shape.id();
 }
 
+// Пакетная вставка (загрузка документа, генератор сцен): id назначаются
+// заново, столкновения не разрешаются, сигналы отправляются один раз.
+// Возвращает id первой добавленной фигуры или -1.
+int VKCanvas::addShapes(const QVector<Shape> &shapes)
+{
+    if (shapes.isEmpty())
+        return -1;
+
+    const int firstId = c_nextShapeId;
+    c_snapshotBuilder.markDirtyFrom(c_shapes.size());
+    polish();
+    c_shapes.reserve(c_shapes.size() + shapes.size());
+    c_undoStack.beginGroup();
+    for (const Shape &source : shapes) {
+        Shape shape = source;
+        shape.setId(c_nextShapeId++);
+        c_shapes.append(shape);
+        c_sceneStore.append(shape);
+        c_undoStack.recordInsert(c_shapes.size() - 1, shape);
+    }
+    c_undoStack.endGroup();
+    updateHistoryState();
+    if (c_simulation) {
+        SimulationWorker::Command command;
+        command.type = SimulationWorker::Command::Insert;
+        command.shapes = c_shapes.mid(c_shapes.size() - shapes.size());
+        c_simulation->post(std::move(command));
+    }
+
+    emit shapeCountChanged();
+    if (!m_blockTableUpdates) {
+        notifyVertexInfoUpdated();
+    }
+    update();
+    return firstId;
+}
+
 void VKCanvas::removeShape(int id) {
     for (int i = 0; i < c_shapes.size(); ++i) {
         if (c_shapes[i].id() == id) {
             bool wasSelected = (c_selectedShapeId == id);
 
+            postSimulation(SimulationWorker::Command::Remove, c_shapes[i]);
+            c_pendingResolves.remove(id);
+            c_undoStack.recordRemove(i, c_shapes[i]);
+            updateHistoryState();
             c_shapes.removeAt(i);
+            c_sceneStore.removeAt(i);
+            c_snapshotBuilder.markDirtyFrom(i);
+            polish();
             emit shapeRemoved(id);
             emit shapeCountChanged();
 
@@ -142,7 +263,7 @@ void VKCanvas::removeShape(int id) {
             }
 
             if (!m_blockTableUpdates) {
-                emit vertexInfoUpdated();
+                notifyVertexInfoUpdated();
             }
             update();
             return;
@@ -207,7 +328,721 @@ Shape* VKCanvas::getShapeById(int id)
     return nullptr;
 }
 
-VKCanvas::~VKCanvas() {}
+int VKCanvas::shapeIndex(const Shape *shape) const
+{
+    return shape ? int(shape - c_shapes.constData()) : -1;
+}
+
+void VKCanvas::syncShape(const Shape *shape)
+{
+    c_sceneStore.update(shapeIndex(shape), *shape);
+    markShapeDirty(shapeIndex(shape));
+    postSimulation(SimulationWorker::Command::Update, *shape);
+}
+
+// В потоковом режиме фигура остаётся на месте, пока поток симуляции
+// не вернёт разрешённую позицию (applySimulationResults)
+void VKCanvas::resolveCollisions(Shape *shape)
+{
+    const int index = shapeIndex(shape);
+    c_sceneStore.update(index, *shape);
+    markShapeDirty(index);
+
+    if (!c_collisionsEnabled || !shape->collisionsEnabled()) {
+        postSimulation(SimulationWorker::Command::Update, *shape);
+        return;
+    }
+
+    if (c_simulation) {
+        postSimulation(SimulationWorker::Command::Resolve, *shape);
+        return;
+    }
+
+    SimulationWorker::resolveCollisions(c_sceneStore, index, *shape);
+}
+
+void VKCanvas::setThreadedSimulation(bool enabled)
+{
+    if (threadedSimulation() == enabled)
+        return;
+
+    if (enabled) {
+        c_simulation = std::make_unique<SimulationWorker>([this]() {
+            QMetaObject::invokeMethod(this, &VKCanvas::applySimulationResults, Qt::QueuedConnection);
+        });
+        resetSimulation();
+    } else {
+        c_simulation.reset();
+        c_pendingResolves.clear();
+    }
+
+    emit threadedSimulationChanged();
+}
+
+void VKCanvas::setAutosave(bool enabled)
+{
+    if (autosave() == enabled)
+        return;
+
+    if (!enabled) {
+        c_undoStack.setObserver(nullptr);
+        c_autosave->discard();
+        c_autosave.reset();
+        emit autosaveChanged();
+        return;
+    }
+
+    QString directory = qEnvironmentVariable("PAINTSHAPE_AUTOSAVE_DIR");
+    if (directory.isEmpty())
+        directory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + QStringLiteral("/autosave");
+
+    QString error;
+    if (AutosaveJournal::hasRecovery(directory)) {
+        QElapsedTimer timer;
+        timer.start();
+        QVector<Shape> shapes;
+        if (AutosaveJournal::recover(directory, &shapes, &error)) {
+            replaceShapes(shapes);
+            c_selectedShapeId = -1;
+            c_selectedVertexIndex = -1;
+            c_selectedEdgeIndex = -1;
+            qDebug() << "Сцена восстановлена после сбоя:" << c_shapes.size() << "фигур за"
+                     << timer.elapsed() << "мс";
+            emit shapeCountChanged();
+            emit selectedShapeIdChanged();
+            emit selectedVertexIndexChanged();
+            emit selectedEdgeIndexChanged();
+            emit sceneRecovered(c_shapes.size());
+            notifyVertexInfoUpdated();
+            update();
+        } else {
+            qWarning() << "Не удалось восстановить сцену из" << directory << ":" << error;
+        }
+    }
+
+    auto journal = std::make_unique<AutosaveJournal>(directory);
+    if (!journal->start(c_shapes, &error)) {
+        qWarning() << "Автосохранение недоступно:" << error;
+        return;
+    }
+    c_autosave = std::move(journal);
+    c_undoStack.setObserver(c_autosave.get());
+    emit autosaveChanged();
+}
+
+void VKCanvas::setTiledRendering(bool enabled)
+{
+    if (tiledRendering() == enabled)
+        return;
+
+    if (enabled) {
+        c_tileCache = std::make_unique<TileCache>(OutlineWidth, [this]() {
+            QMetaObject::invokeMethod(this, &QQuickItem::update, Qt::QueuedConnection);
+        });
+    } else {
+        c_tileCache.reset();
+    }
+
+    emit tiledRenderingChanged();
+    update();
+}
+
+void VKCanvas::postSimulation(SimulationWorker::Command::Type type, const Shape &shape)
+{
+    if (!c_simulation)
+        return;
+
+    SimulationWorker::Command command;
+    command.type = type;
+    if (type == SimulationWorker::Command::Insert) {
+        command.shapes.append(shape);
+    } else {
+        command.shape = shape;
+    }
+    if (type == SimulationWorker::Command::Resolve) {
+        command.sequence = ++c_resolveSequence;
+        c_pendingResolves.insert(shape.id(), PendingResolve { command.sequence, 0 });
+    }
+    c_simulation->post(std::move(command));
+}
+
+void VKCanvas::resetSimulation()
+{
+    c_pendingResolves.clear();
+    if (!c_simulation)
+        return;
+
+    SimulationWorker::Command command;
+    command.type = SimulationWorker::Command::Reset;
+    command.shapes = c_shapes;
+    c_simulation->post(std::move(command));
+}
+
+void VKCanvas::applySimulationResults()
+{
+    if (!c_simulation)
+        return;
+
+    const std::shared_ptr<const SimulationWorker::Snapshot> snapshot = c_simulation->takeSnapshot();
+    if (!snapshot)
+        return;
+
+    bool changed = false;
+    for (const SimulationWorker::Placement &placement : snapshot->placements) {
+        auto pending = c_pendingResolves.find(placement.id);
+        if (pending == c_pendingResolves.end() || pending->sequence != placement.sequence)
+            continue;
+        const quint64 command = pending->command;
+        c_pendingResolves.erase(pending);
+
+        Shape *shape = getShapeById(placement.id);
+        if (!shape || shape->position() == placement.position)
+            continue;
+
+        const UndoStack::Transform before = UndoStack::Transform::of(*shape);
+        shape->setPosition(placement.position);
+        c_sceneStore.updateTransform(shapeIndex(shape), *shape);
+        markShapeDirty(shapeIndex(shape));
+        c_undoStack.amendTransform(command, placement.id, shapeIndex(shape), before, UndoStack::Transform::of(*shape));
+        notifyShapeUpdated(placement.id);
+        changed = true;
+    }
+
+    if (changed) {
+        if (c_dragMode == NoDrag && !m_blockTableUpdates)
+            notifyVertexInfoUpdated();
+        update();
+    }
+}
+
+VKCanvas::~VKCanvas()
+{
+    // Штатное завершение: журнал больше не нужен
+    setAutosave(false);
+    c_simulation.reset();
+    c_tileCache.reset();
+    stopInputRecording();
+    if (c_profilerOverlay)
+        Profiler::removeSink(&c_profileStats);
+    if (c_tracer)
+        stopTrace(c_tracePath);
+}
+
+// Синхронные обработчики QML (обновление таблиц) выполняются внутри emit
+void VKCanvas::notifyVertexInfoUpdated()
+{
+    ProfileScope profile(Profiler::ModelRefresh);
+    emit vertexInfoUpdated();
+}
+
+void VKCanvas::notifyShapeUpdated(int shapeId)
+{
+    ProfileScope profile(Profiler::ModelRefresh);
+    emit shapeUpdated(shapeId);
+}
+
+void VKCanvas::setProfilerOverlay(bool enabled)
+{
+    if (c_profilerOverlay == enabled)
+        return;
+
+    c_profilerOverlay = enabled;
+
+    if (enabled) {
+        if (!c_profileTimer) {
+            c_profileTimer = new QTimer(this);
+            c_profileTimer->setInterval(250);
+            connect(c_profileTimer, &QTimer::timeout, this, &VKCanvas::collectProfile);
+        }
+        c_profileStats.reset();
+        Profiler::addSink(&c_profileStats);
+        c_profileTimer->start();
+    } else {
+        if (c_profileTimer)
+            c_profileTimer->stop();
+        Profiler::removeSink(&c_profileStats);
+    }
+
+    emit profilerOverlayChanged();
+    update();
+}
+
+// Сигналы окна приходят из рендер-потока; замеры пишутся прямо там,
+// в буфер этого потока. Пока профилировщик выключен, обработчики
+// стоят одну проверку флага.
+void VKCanvas::connectWindowTiming(QQuickWindow *window)
+{
+    if (!window)
+        return;
+
+    auto begin = [](std::atomic<qint64> &start) {
+        start = Profiler::isEnabled() ? Profiler::now() : -1;
+    };
+    auto end = [](std::atomic<qint64> &start, Profiler::Stage stage) {
+        const qint64 begun = start.exchange(-1);
+        if (begun >= 0 && Profiler::isEnabled())
+            Profiler::submit(stage, begun, Profiler::now() - begun);
+    };
+
+    connect(window, &QQuickWindow::beforeSynchronizing, this,
+            [this, begin]() { begin(c_syncStart); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterSynchronizing, this,
+            [this, end]() { end(c_syncStart, Profiler::Sync); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::beforeRendering, this,
+            [this, begin]() { begin(c_renderStart); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterRendering, this,
+            [this, end]() { end(c_renderStart, Profiler::Render); }, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this, [this]() {
+        if (!Profiler::isEnabled()) {
+            c_lastFrameSwap = -1;
+            return;
+        }
+        const qint64 now = Profiler::now();
+        const qint64 previous = c_lastFrameSwap.exchange(now);
+        if (previous >= 0)
+            Profiler::submit(Profiler::Frame, previous, now - previous);
+    }, Qt::DirectConnection);
+}
+
+void VKCanvas::collectProfile()
+{
+    Profiler::collect();
+
+    c_profileStatsMap = c_profileStats.toVariantMap();
+    c_profileStats.reset();
+    emit profileStatsChanged();
+}
+
+void VKCanvas::startTrace()
+{
+    if (c_tracer)
+        return;
+
+    c_tracer = std::make_unique<Tracer>();
+    c_tracePath.clear();
+    qDebug() << "Трассировка запущена";
+    emit tracingChanged();
+}
+
+bool VKCanvas::stopTrace(const QString &path)
+{
+    if (!c_tracer)
+        return false;
+
+    const QString tracePath = !path.isEmpty()
+        ? path
+        : QStringLiteral("paintshape-trace-%1.json")
+              .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss")));
+
+    QString error;
+    const bool saved = c_tracer->save(tracePath, &error);
+    if (saved)
+        qDebug() << "Трасса сохранена:" << tracePath << c_tracer->eventCount() << "событий,"
+                 << c_tracer->droppedCount() << "потеряно";
+    else
+        qWarning() << "Не удалось сохранить трассу" << tracePath << ":" << error;
+
+    c_tracer.reset();
+    emit tracingChanged();
+    return saved;
+}
+
+bool VKCanvas::startInputRecording(const QString &path)
+{
+    stopInputRecording();
+    c_inputRecorder = std::make_unique<InputRecorder>(path, saveState());
+    qDebug() << "Запись ввода:" << path;
+    return true;
+}
+
+bool VKCanvas::stopInputRecording()
+{
+    if (!c_inputRecorder)
+        return false;
+
+    QString error;
+    const bool saved = c_inputRecorder->save(&error);
+    if (!saved)
+        qWarning() << "Не удалось сохранить запись ввода" << c_inputRecorder->path() << error;
+    c_inputRecorder.reset();
+    return saved;
+}
+
+InputLog::CanvasState VKCanvas::saveState() const
+{
+    InputLog::CanvasState state;
+    state.size = size();
+    state.offset = QPointF(c_offsetX, c_offsetY);
+    state.globalScale = c_globalScale;
+    state.activeTab = c_activeTab;
+    state.showGrid = c_showGrid;
+    state.collisionsEnabled = c_collisionsEnabled;
+    state.selectedShapeId = c_selectedShapeId;
+    state.shapes = c_shapes;
+    return state;
+}
+
+// Размер холста выставляется до смещения: geometryChange центрирует вид
+void VKCanvas::restoreState(const InputLog::CanvasState &state)
+{
+    setSize(state.size);
+
+    replaceShapes(state.shapes);
+
+    c_offsetX = state.offset.x();
+    c_offsetY = state.offset.y();
+    c_globalScale = state.globalScale;
+    c_activeTab = state.activeTab;
+    c_showGrid = state.showGrid;
+    c_collisionsEnabled = state.collisionsEnabled;
+    c_selectedShapeId = state.selectedShapeId;
+    c_selectedVertexIndex = -1;
+    c_selectedEdgeIndex = -1;
+    c_dragMode = NoDrag;
+    c_transformMode = NoTransform;
+    endDragEdit();
+
+    emit shapeCountChanged();
+    emit offsetChanged();
+    emit globalScaleChanged();
+    emit activeTabChanged();
+    emit showGridChanged();
+    emit collisionsEnabledChanged();
+    emit selectedShapeIdChanged();
+    emit selectedVertexIndexChanged();
+    emit selectedEdgeIndexChanged();
+    notifyVertexInfoUpdated();
+    update();
+}
+
+// Документ заменён целиком: индексы, симуляция и история начинаются
+// заново, журнал автосохранения — с нового снимка
+void VKCanvas::replaceShapes(const QVector<Shape> &shapes)
+{
+    c_shapes = shapes;
+    c_sceneStore.rebuild(c_shapes);
+    c_snapshotBuilder.markAllDirty();
+    polish();
+    resetSimulation();
+    c_undoStack.clear();
+    updateHistoryState();
+    c_nextShapeId = 0;
+    for (const Shape &shape : std::as_const(c_shapes))
+        c_nextShapeId = qMax(c_nextShapeId, shape.id() + 1);
+    if (c_autosave)
+        c_autosave->reset(c_shapes);
+}
+
+bool VKCanvas::saveScene(const QString &path)
+{
+    const QString filePath = localScenePath(path);
+    QString error;
+    if (!SceneFile::save(filePath, c_shapes, &error)) {
+        qWarning() << "Не удалось сохранить сцену" << filePath << ":" << error;
+        return false;
+    }
+    qDebug() << "Сцена сохранена:" << filePath << c_shapes.size() << "фигур";
+    return true;
+}
+
+bool VKCanvas::loadScene(const QString &path)
+{
+    if (c_dragMode != NoDrag)
+        return false;
+
+    const QString filePath = localScenePath(path);
+    QElapsedTimer timer;
+    timer.start();
+
+    SceneFile file;
+    QString error;
+    if (!file.open(filePath, &error)) {
+        qWarning() << "Не удалось открыть сцену" << filePath << ":" << error;
+        return false;
+    }
+
+    replaceShapes(file.shapes());
+
+    c_selectedShapeId = -1;
+    c_selectedVertexIndex = -1;
+    c_selectedEdgeIndex = -1;
+    c_transformMode = NoTransform;
+
+    qDebug() << "Сцена загружена:" << filePath << c_shapes.size() << "фигур за"
+             << timer.elapsed() << "мс" << (file.isMapped() ? "(отображение)" : "(чтение)");
+
+    emit shapeCountChanged();
+    emit selectedShapeIdChanged();
+    emit selectedVertexIndexChanged();
+    emit selectedEdgeIndexChanged();
+    notifyVertexInfoUpdated();
+    update();
+    return true;
+}
+
+bool VKCanvas::exportSvg(const QString &path)
+{
+    const QString filePath = localScenePath(path);
+    QElapsedTimer timer;
+    timer.start();
+
+    QString error;
+    if (!SvgExport::save(filePath, c_shapes, &error)) {
+        qWarning() << "Не удалось экспортировать SVG" << filePath << ":" << error;
+        return false;
+    }
+    qDebug() << "SVG сохранён:" << filePath << c_shapes.size() << "фигур за" << timer.elapsed() << "мс";
+    return true;
+}
+
+bool VKCanvas::exportImage(const QString &path, int maxSide)
+{
+    const QString filePath = localScenePath(path);
+    QElapsedTimer timer;
+    timer.start();
+
+    const QImage image = Rasterizer::renderScene(c_shapes, maxSide);
+    if (!image.save(filePath)) {
+        qWarning() << "Не удалось сохранить изображение" << filePath;
+        return false;
+    }
+    qDebug() << "Изображение сохранено:" << filePath << image.width() << "x" << image.height()
+             << "за" << timer.elapsed() << "мс";
+    return true;
+}
+
+int VKCanvas::importShapes(const QString &path)
+{
+    if (c_dragMode != NoDrag)
+        return 0;
+
+    const QString filePath = localScenePath(path);
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<Shape> shapes;
+    SceneImport::Stats stats;
+    QString error;
+    if (!SceneImport::load(filePath, &shapes, &error, &stats)) {
+        qWarning() << "Не удалось импортировать" << filePath << ":" << error;
+        return 0;
+    }
+
+    addShapes(shapes);
+    qDebug() << "Импортировано:" << filePath << stats.shapes << "фигур," << stats.vertices << "вершин,"
+             << stats.skipped << "пропущено, за" << timer.elapsed() << "мс";
+    if (stats.oversized > 0) {
+        qWarning() << "Пропущено" << stats.oversized << "многоугольников больше" << SceneImport::MaxVertices
+                   << "точек:" << filePath;
+    }
+    return stats.shapes;
+}
+
+void VKCanvas::undo()
+{
+    if (c_dragMode != NoDrag)
+        return;
+    if (const UndoStack::Command *command = c_undoStack.undo())
+        applyHistory(*command, true);
+}
+
+void VKCanvas::redo()
+{
+    if (c_dragMode != NoDrag)
+        return;
+    if (const UndoStack::Command *command = c_undoStack.redo())
+        applyHistory(*command, false);
+}
+
+void VKCanvas::beginEdit()
+{
+    c_undoStack.beginGroup();
+    updateHistoryState();
+}
+
+void VKCanvas::endEdit()
+{
+    c_undoStack.endGroup();
+    updateHistoryState();
+}
+
+void VKCanvas::recordTransform(const Shape *shape, const UndoStack::Transform &before, HistoryProperty property)
+{
+    const UndoStack::Transform after = UndoStack::Transform::of(*shape);
+    if (after.position == before.position && after.rotation == before.rotation && after.scale == before.scale)
+        return;
+
+    if (c_applyingHistory) {
+        journalEcho(shape, true);
+        return;
+    }
+
+    const quint64 mergeKey = property == NoMerge ? 0 : UndoStack::mergeKey(property, shape->id());
+    c_undoStack.recordTransform(shape->id(), shapeIndex(shape), before, after, mergeKey);
+    bindPendingResolve(shape->id());
+    updateHistoryState();
+}
+
+void VKCanvas::recordShape(const Shape &before, const Shape *shape, HistoryProperty property)
+{
+    if (c_applyingHistory) {
+        journalEcho(shape, false);
+        return;
+    }
+
+    const quint64 mergeKey = property == NoMerge ? 0 : UndoStack::mergeKey(property, shape->id());
+    c_undoStack.recordShape(shapeIndex(shape), before, *shape, mergeKey);
+    bindPendingResolve(shape->id());
+    updateHistoryState();
+}
+
+// Эхо сеттеров во время applyHistory в историю не попадает, но сцену
+// меняет (округление до float в QML, разрешение столкновений). Журнал
+// получает его напрямую, иначе его копия сцены разойдётся с холстом.
+void VKCanvas::journalEcho(const Shape *shape, bool transformOnly)
+{
+    if (!c_autosave)
+        return;
+
+    UndoStack::Delta delta;
+    delta.type = transformOnly ? UndoStack::Delta::ChangeTransform : UndoStack::Delta::ChangeShape;
+    delta.id = shape->id();
+    delta.index = shapeIndex(shape);
+    delta.after = UndoStack::Transform::of(*shape);
+    c_autosave->deltaRecorded(delta, shape);
+}
+
+// Запрос Resolve отправляется до записи правки в историю; команда,
+// куда попала правка, становится известна только здесь
+void VKCanvas::bindPendingResolve(int id)
+{
+    const auto pending = c_pendingResolves.find(id);
+    if (pending != c_pendingResolves.end())
+        pending->command = c_undoStack.lastCommand();
+}
+
+// Группа открывается первым движением, чтобы клик без перетаскивания
+// не оставлял пустой команды
+void VKCanvas::beginDragEdit()
+{
+    if (c_dragEditOpen)
+        return;
+    c_dragEditOpen = true;
+    c_undoStack.beginGroup();
+}
+
+void VKCanvas::endDragEdit()
+{
+    if (!c_dragEditOpen)
+        return;
+    c_dragEditOpen = false;
+    c_undoStack.endGroup();
+    updateHistoryState();
+}
+
+// Дельты применяются по порядку записи (при отмене — в обратном), и
+// фигура находится по сохранённому индексу, так что отмена стоит
+// O(изменений). Вставка и удаление сдвигают индексы; тогда хранилище
+// и поток симуляции перестраиваются один раз в конце.
+void VKCanvas::applyHistory(const UndoStack::Command &command, bool undo)
+{
+    // Обработчики QML отвечают на сигналы вызовом сеттеров; это эхо,
+    // а не новая правка, и оно не должно стирать историю повтора
+    c_applyingHistory = true;
+    const bool structural = command.isStructural();
+    const int count = command.deltas.size();
+    QVector<int> addedIds;
+    QVector<int> removedIds;
+    int focusId = -1;
+
+    for (int step = 0; step < count; ++step) {
+        const UndoStack::Delta &delta = command.deltas[undo ? count - 1 - step : step];
+        c_pendingResolves.remove(delta.id);
+
+        if (delta.type == UndoStack::Delta::InsertShape || delta.type == UndoStack::Delta::RemoveShape) {
+            const bool insert = (delta.type == UndoStack::Delta::InsertShape) != undo;
+            if (insert) {
+                const Shape &shape = command.states[delta.state];
+                c_shapes.insert(qBound(0, delta.index, int(c_shapes.size())), shape);
+                c_nextShapeId = qMax(c_nextShapeId, shape.id() + 1);
+                addedIds.append(shape.id());
+                focusId = shape.id();
+            } else {
+                const int index = historyIndex(delta);
+                if (index < 0)
+                    continue;
+                c_shapes.removeAt(index);
+                removedIds.append(delta.id);
+            }
+            continue;
+        }
+
+        const int index = historyIndex(delta);
+        if (index < 0)
+            continue;
+
+        Shape &shape = c_shapes[index];
+        const bool transformOnly = delta.type == UndoStack::Delta::ChangeTransform;
+        if (transformOnly)
+            (undo ? delta.before : delta.after).applyTo(shape);
+        else
+            shape = command.states[delta.state + (undo ? 0 : 1)];
+
+        if (!structural) {
+            if (transformOnly)
+                c_sceneStore.updateTransform(index, shape);
+            else
+                c_sceneStore.update(index, shape);
+            markShapeDirty(index);
+            postSimulation(SimulationWorker::Command::Update, shape);
+        }
+        notifyShapeUpdated(delta.id);
+        focusId = delta.id;
+    }
+
+    if (structural) {
+        c_sceneStore.rebuild(c_shapes);
+        c_snapshotBuilder.markAllDirty();
+        polish();
+        resetSimulation();
+        for (int id : std::as_const(removedIds))
+            emit shapeRemoved(id);
+        for (int id : std::as_const(addedIds))
+            emit shapeAdded(id);
+        emit shapeCountChanged();
+    }
+
+    // Правка одной фигуры выделяет её; выделение исчезнувшей фигуры снимается
+    if (count == 1 && focusId != -1)
+        setSelectedShapeId(focusId);
+    else if (c_selectedShapeId != -1 && !getShapeById(c_selectedShapeId))
+        setSelectedShapeId(-1);
+    setSelectedVertexIndex(-1);
+    setSelectedEdgeIndex(-1);
+
+    if (!m_blockTableUpdates) {
+        notifyVertexInfoUpdated();
+    }
+    c_applyingHistory = false;
+    update();
+    updateHistoryState();
+}
+
+int VKCanvas::historyIndex(const UndoStack::Delta &delta) const
+{
+    if (delta.index >= 0 && delta.index < c_shapes.size() && c_shapes[delta.index].id() == delta.id)
+        return delta.index;
+    return shapeIndex(getShapeById(delta.id));
+}
+
+void VKCanvas::updateHistoryState()
+{
+    if (c_canUndo == c_undoStack.canUndo() && c_canRedo == c_undoStack.canRedo())
+        return;
+    c_canUndo = c_undoStack.canUndo();
+    c_canRedo = c_undoStack.canRedo();
+    emit historyChanged();
+}
 
 void VKCanvas::centerOnZero()
 {
@@ -279,8 +1114,11 @@ void VKCanvas::setShapeRotation(int id, float rotation)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const UndoStack::Transform before = UndoStack::Transform::of(*shape);
         shape->setRotation(rotation);
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordTransform(shape, before, HistoryRotation);
+        notifyShapeUpdated(id);
         update();
     }
 }
@@ -289,8 +1127,11 @@ void VKCanvas::setShapeScale(int id, float scale)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const UndoStack::Transform before = UndoStack::Transform::of(*shape);
         shape->setScale(scale);
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordTransform(shape, before, HistoryScale);
+        notifyShapeUpdated(id);
         update();
     }
 }
@@ -299,8 +1140,11 @@ void VKCanvas::setShapeColor(int id, const QColor &color)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setColor(color);
-        emit shapeUpdated(id);
+        markShapeDirty(shapeIndex(shape));
+        recordShape(before, shape, HistoryColor);
+        notifyShapeUpdated(id);
         update();
     }
 }
@@ -309,11 +1153,14 @@ void VKCanvas::setShapeSides(int id, int sides)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setSides(sides);
         shape->updateVertices(sides, shape->size());
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordShape(before, shape, HistorySides);
+        notifyShapeUpdated(id);
         if (!m_blockTableUpdates) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
         update();
     }
@@ -323,11 +1170,14 @@ void VKCanvas::setShapeSizeWidgth(int id, float sizeWidgth)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setSizeWidth(sizeWidgth);
         shape->updateVertices(shape->sides(), sizeWidgth);
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordShape(before, shape, HistorySizeWidth);
+        notifyShapeUpdated(id);
         if (!m_blockTableUpdates) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
         update();
     }
@@ -337,11 +1187,14 @@ void VKCanvas::setShapeSizeHeight(int id, float sizeHeight)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setSizeHeigth(sizeHeight);
         shape->updateVertices(shape->sides(), sizeHeight);
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordShape(before, shape, HistorySizeHeight);
+        notifyShapeUpdated(id);
         if (!m_blockTableUpdates) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
         update();
     }
@@ -351,8 +1204,10 @@ void VKCanvas::setShapeName(int id, const QString &name)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setName(name);
-        emit shapeUpdated(id);
+        recordShape(before, shape, HistoryName);
+        notifyShapeUpdated(id);
         update();
     }
 }
@@ -361,8 +1216,11 @@ void VKCanvas::setShapeCollisionsEnabled(int id, bool enabled)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setCollisionsEnabled(enabled);
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordShape(before, shape, HistoryCollisions);
+        notifyShapeUpdated(id);
         update();
     }
 }
@@ -440,7 +1298,18 @@ QPointF VKCanvas::vertexToWorld(int shapeId, int vertexIndex) const
 
 void VKCanvas::clear()
 {
+    // С конца, чтобы индексы удалений оставались верными при отмене
+    c_undoStack.beginGroup();
+    for (int i = c_shapes.size() - 1; i >= 0; --i)
+        c_undoStack.recordRemove(i, c_shapes[i]);
+    c_undoStack.endGroup();
+    updateHistoryState();
+
     c_shapes.clear();
+    c_sceneStore.clear();
+    c_snapshotBuilder.markAllDirty();
+    polish();
+    resetSimulation();
     c_nextShapeId = 0;
     c_selectedShapeId = -1;
     c_selectedVertexIndex = -1;
@@ -450,7 +1319,7 @@ void VKCanvas::clear()
     emit selectedVertexIndexChanged();
     emit selectedEdgeIndexChanged();
     if (!m_blockTableUpdates) {
-        emit vertexInfoUpdated();
+        notifyVertexInfoUpdated();
     }
     update();
 }
@@ -513,16 +1382,6 @@ QPointF VKCanvas::worldToScreenNoRotation(const QPointF &worldPos) const
     return screenPos;
 }
 
-QPolygonF VKCanvas::createPolygon(const Shape &shape) const
-{
-    QPolygonF polygon = shape.getWorldPolygon(c_globalScale);
-    for (int i = 0; i < polygon.size(); ++i) {
-        polygon[i] = worldToScreenNoRotation(polygon[i]);
-    }
-
-    return polygon;
-}
-
 float VKCanvas::getShapeRadius(const Shape &shape) const
 {
     return shape.boundingRadius(c_globalScale);
@@ -612,46 +1471,19 @@ QPointF VKCanvas::findClosestEdge(const Shape &shape, const QPointF &screenPos,
 int VKCanvas::findShapeAtPoint(const QPointF &screenPos)
 {
     QPointF worldPos = screenToWorldNoRotation(screenPos);
-    for (int i = c_shapes.size() - 1; i >= 0; --i) {
-        const Shape &shape = c_shapes[i];
-        if (!shape.isVisible()) continue;
-        QPolygonF worldPolygon = shape.getWorldPolygon(c_globalScale);
-        if (pointInPolygon(worldPos, worldPolygon)) {
-            return shape.id();
-        }
-    }
-
-    return -1;
-}
-
-bool VKCanvas::pointInPolygon(const QPointF& point, const QPolygonF& polygon) const
-{
-    if (polygon.size() < 3)
-        return false;
-
-    bool inside = false;
-    int n = polygon.size();
-
-    for (int i = 0, j = n - 1; i < n; j = i++) {
-        QPointF pi = polygon[i];
-        QPointF pj = polygon[j];
-
-        if (((pi.y() > point.y()) != (pj.y() > point.y())) &&
-            (point.x() < (pj.x() - pi.x()) * (point.y() - pi.y()) / (pj.y() - pi.y()) + pi.x())) {
-            inside = !inside;
-        }
-    }
-
-    return inside;
+    c_sceneStore.updateWorldVertices();
+    const int index = c_sceneStore.hitTest(worldPos);
+    return index >= 0 ? c_sceneStore.id(index) : -1;
 }
 
 QSGGeometryNode* VKCanvas::createShapeNode()
 {
     QSGGeometryNode *node = new QSGGeometryNode();
-    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0, 0,
+                                            QSGGeometry::UnsignedShortType);
     QSGFlatColorMaterial *material = new QSGFlatColorMaterial();
 
-    geometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangles);
     node->setGeometry(geometry);
     node->setMaterial(material);
     node->setFlag(QSGNode::OwnsGeometry);
@@ -660,109 +1492,191 @@ QSGGeometryNode* VKCanvas::createShapeNode()
     return node;
 }
 
-QSGGeometryNode* VKCanvas::createVertexNode(const QPointF &position, const QColor &color, float size)
+QSGGeometryNode* VKCanvas::createOutlineNode()
 {
     QSGGeometryNode *node = new QSGGeometryNode();
-    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 4);
-    QSGFlatColorMaterial *material = new QSGFlatColorMaterial();
+    QSGGeometry *geometry = new QSGGeometry(OutlineMaterial::attributes(), 0, 0, QSGGeometry::UnsignedShortType);
+    OutlineMaterial *material = new OutlineMaterial();
 
-    geometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangles);
     node->setGeometry(geometry);
     node->setMaterial(material);
     node->setFlag(QSGNode::OwnsGeometry);
     node->setFlag(QSGNode::OwnsMaterial);
 
-    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
-
-    vertices[0].set(position.x() - size/2, position.y() - size/2);
-    vertices[1].set(position.x() + size/2, position.y() - size/2);
-    vertices[2].set(position.x() + size/2, position.y() + size/2);
-    vertices[3].set(position.x() - size/2, position.y() + size/2);
-
-    material->setColor(color);
-
     return node;
 }
 
-QSGGeometryNode* VKCanvas::createEdgeNode(const QPointF &start, const QPointF &end, const QColor &color, float width)
+void VKCanvas::markShapeDirty(int index)
 {
-    QSGGeometryNode *node = new QSGGeometryNode();
-    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 2);
-    QSGFlatColorMaterial *material = new QSGFlatColorMaterial();
+    c_snapshotBuilder.markDirty(index);
+    polish();
+}
 
-    geometry->setDrawingMode(QSGGeometry::DrawLines);
-    geometry->setLineWidth(width);
-    node->setGeometry(geometry);
-    node->setMaterial(material);
-    node->setFlag(QSGNode::OwnsGeometry);
-    node->setFlag(QSGNode::OwnsMaterial);
+void VKCanvas::publishSnapshot()
+{
+    if (c_snapshotBuilder.hasChanges(c_selectedShapeId))
+        c_publishedSnapshot = c_snapshotBuilder.publish(c_shapes, c_sceneStore, c_selectedShapeId);
+}
 
-    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
-    vertices[0].set(start.x(), start.y());
-    vertices[1].set(end.x(), end.y());
+// Снимок собирается в потоке GUI перед синхронизацией, чтобы
+// updatePaintNode не держал GUI-поток заблокированным на копировании
+void VKCanvas::updatePolish()
+{
+    publishSnapshot();
+}
+
+// Страница перезаписывается целиком: не больше ChunkSize фигур, у каждой
+// пара узлов — заливка и обводка. Узлы переиспользуются, вершины
+// перезаписываются на месте; узлы создаются и удаляются, только если
+// изменилось число фигур на странице. tiled — узлами рисуются только
+// фигуры, которых нет в плитках: выделенная, изменившиеся после
+// отрисовки плиток (c_liveShapes) и не попадающие в плитки. Возвращает
+// число записанных фигур, созданные узлы добавляются к allocated, в
+// bounds — рамка страницы.
+int VKCanvas::updateChunkNode(QSGNode *chunkNode, const SceneSnapshot::Chunk &chunk, bool tiled,
+                              QRectF &bounds, int &allocated)
+{
+    bounds = QRectF();
+    int built = 0;
+    QSGNode *child = chunkNode->firstChild();
+    for (const SceneSnapshot::Entry &entry : chunk.entries) {
+        if (!entry.visible)
+            continue;
+        if (tiled && TileCache::isCached(entry) && !c_liveShapes.contains(entry.id))
+            continue;
+        // Индексы 16-битные: заливке хватает 0xFFFF вершин, обводке (8
+        // вершин на точку) — в восемь раз меньше. Импорт ограничивает
+        // число точек (SceneImport::MaxVertices), больше может прийти
+        // только из стороннего файла сцены
+        if (entry.x.size() > 0xFFFF)
+            continue;
+        bounds = bounds.isNull() ? entry.bounds : bounds.united(entry.bounds);
 
-    material->setColor(color);
+        if (!child) {
+            chunkNode->appendChildNode(createShapeNode());
+            chunkNode->appendChildNode(createOutlineNode());
+            allocated += 2;
+            child = chunkNode->lastChild()->previousSibling();
+        }
+        QSGGeometryNode *shapeNode = static_cast<QSGGeometryNode *>(child);
+        QSGGeometryNode *outlineNode = static_cast<QSGGeometryNode *>(child->nextSibling());
+        updateShapeGeometry(shapeNode, entry);
+        updateOutlineGeometry(outlineNode, entry);
+        child = outlineNode->nextSibling();
+        ++built;
+    }
 
-    return node;
+    while (child) {
+        QSGNode *next = child->nextSibling();
+        delete child;
+        child = next;
+    }
+    return built;
 }
 
-QSGGeometryNode* VKCanvas::createTransformHandle(const QPointF &position, const QColor &color, float size)
+void VKCanvas::updateShapeGeometry(QSGGeometryNode *node, const SceneSnapshot::Entry &entry)
 {
-    QSGGeometryNode *node = new QSGGeometryNode();
-    QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 4);
-    QSGFlatColorMaterial *material = new QSGFlatColorMaterial();
-
-    geometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
-    node->setGeometry(geometry);
-    node->setMaterial(material);
-    node->setFlag(QSGNode::OwnsGeometry);
-    node->setFlag(QSGNode::OwnsMaterial);
+    const int count = entry.x.size();
+    const int indexCount = entry.indices.size();
+    QSGGeometry *geometry = node->geometry();
+    if (geometry->vertexCount() != count || geometry->indexCount() != indexCount)
+        geometry->allocate(count, indexCount);
 
+    // Мировые координаты: вид задаёт матрица узла над страницами
     QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+    for (int i = 0; i < count; ++i)
+        vertices[i].set(entry.x[i], entry.y[i]);
 
-    vertices[0].set(position.x() - size/2, position.y() - size/2);
-    vertices[1].set(position.x() + size/2, position.y() - size/2);
-    vertices[2].set(position.x() + size/2, position.y() + size/2);
-    vertices[3].set(position.x() - size/2, position.y() + size/2);
+    std::copy_n(entry.indices.constData(), indexCount, geometry->indexDataAsUShort());
+    node->markDirty(QSGNode::DirtyGeometry);
 
-    material->setColor(color);
-
-    return node;
+    QColor color;
+    if (entry.selected) {
+        color = entry.color.lighter(150);
+        color.setAlpha(200);
+    } else {
+        color = entry.color;
+        color.setAlpha(Shape::FillAlpha);
+    }
+    QSGFlatColorMaterial *material = static_cast<QSGFlatColorMaterial *>(node->material());
+    if (material->color() != color) {
+        material->setColor(color);
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
 }
 
-void VKCanvas::updateShapeGeometry(QSGGeometryNode *node, const Shape &shape)
+// Обводка — полоса из треугольников вдоль контура. В каждом стыке два
+// поперечных сечения (конец входящего ребра и начало исходящего), в
+// сечении четыре точки: край сглаживания, сплошная часть слева, справа
+// и снова край. Между сечениями три полосы по два треугольника; в
+// острых углах сечения расходятся, и полоса между ними даёт срез.
+void VKCanvas::updateOutlineGeometry(QSGGeometryNode *node, const SceneSnapshot::Entry &entry)
 {
-    if (!shape.isVisible()) {
-        node->geometry()->allocate(0);
-        return;
-    }
-
-    QPolygonF polygon = createPolygon(shape);
+    // Обводка не строится для отрезков и для контуров, чьи 8 вершин на
+    // точку не помещаются в 16-битные индексы; узел остаётся пустым
+    const int count = entry.x.size() >= 2 && entry.x.size() * 8 <= 0xFFFF ? entry.x.size() : 0;
     QSGGeometry *geometry = node->geometry();
-    geometry->allocate(polygon.size());
-
-    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
-
-    for (int i = 0; i < polygon.size(); ++i) {
-        vertices[i].set(polygon[i].x(), polygon[i].y());
+    // Индексы зависят только от числа точек
+    const bool reallocated = geometry->vertexCount() != count * 8;
+    if (reallocated)
+        geometry->allocate(count * 8, count * 36);
+
+    const float halfWidth = (entry.selected ? SelectedOutlineWidth : OutlineWidth) / 2;
+    const float solid = qMax(halfWidth - 0.5f, 0.0f);
+    const float edge = halfWidth + 0.5f;
+    const QRgb color = qPremultiply(entry.selected ? qRgba(255, 255, 255, 230)
+                                                   : entry.color.darker(Rasterizer::OutlineDarkness).rgba());
+    const uchar r = qRed(color);
+    const uchar g = qGreen(color);
+    const uchar b = qBlue(color);
+    const uchar a = qAlpha(color);
+
+    // Точка контура в мировых координатах, смещение в пикселях переводит
+    // в координаты узла шейдер (OutlineMaterial)
+    OutlineMaterial::Vertex *vertices = static_cast<OutlineMaterial::Vertex *>(geometry->vertexData());
+    const float *joins = entry.joins.constData();
+    for (int i = 0; i < count; ++i) {
+        const float x = entry.x[i];
+        const float y = entry.y[i];
+        for (int side = 0; side < 2; ++side) {
+            const float *left = joins + i * SceneStore::JoinStride + side * 2;
+            const float *right = left + 4;
+            OutlineMaterial::Vertex *section = vertices + i * 8 + side * 4;
+            section[0].set(x, y, left[0] * edge, left[1] * edge, 0, 0, 0, 0);
+            section[1].set(x, y, left[0] * solid, left[1] * solid, r, g, b, a);
+            section[2].set(x, y, right[0] * solid, right[1] * solid, r, g, b, a);
+            section[3].set(x, y, right[0] * edge, right[1] * edge, 0, 0, 0, 0);
+        }
     }
 
-    QSGFlatColorMaterial *material = static_cast<QSGFlatColorMaterial *>(node->material());
-    if (shape.id() == c_selectedShapeId) {
-        QColor selectedColor = shape.color().lighter(150);
-        selectedColor.setAlpha(200);
-        material->setColor(selectedColor);
-    } else {
-        QColor normalColor = shape.color();
-        normalColor.setAlpha(180);
-        material->setColor(normalColor);
+    quint16 *indices = geometry->indexDataAsUShort();
+    for (int i = 0; reallocated && i < count; ++i) {
+        const int join = i * 8;
+        const int next = ((i + 1) % count) * 8;
+        // Стык: сечение 0 -> 1 той же вершины; ребро: сечение 1 -> 0 следующей
+        const int sections[2][2] = { { join, join + 4 }, { join + 4, next } };
+        for (const auto &pair : sections) {
+            for (int row = 0; row < 3; ++row) {
+                const quint16 a0 = quint16(pair[0] + row);
+                const quint16 b0 = quint16(pair[1] + row);
+                *indices++ = a0;
+                *indices++ = quint16(a0 + 1);
+                *indices++ = b0;
+                *indices++ = quint16(a0 + 1);
+                *indices++ = quint16(b0 + 1);
+                *indices++ = b0;
+            }
+        }
     }
+    node->markDirty(QSGNode::DirtyGeometry);
 }
 
 void VKCanvas::addVertexToShape(int id, float x, float y)
 {
     Shape* shape = getShapeById(id);
     if (shape && shape->vertices().size() < 20) {
+        const Shape before = *shape;
         if (c_selectedEdgeIndex != -1) {
             QVector<QPointF> vertices = shape->vertices();
             int vertexCount = vertices.size();
@@ -777,20 +1691,24 @@ void VKCanvas::addVertexToShape(int id, float x, float y)
                     );
                 vertices.insert(nextIndex, newVertex);
                 shape->setVertices(vertices);
+                syncShape(shape);
+                recordShape(before, shape);
 
                 emit vertexAdded(id, nextIndex);
-                emit shapeUpdated(id);
+                notifyShapeUpdated(id);
                 if (!m_blockTableUpdates) {
-                    emit vertexInfoUpdated();
+                    notifyVertexInfoUpdated();
                 }
                 update();
             }
         } else {
             shape->addVertex(QPointF(x, y));
+            syncShape(shape);
+            recordShape(before, shape);
             emit vertexAdded(id, shape->vertices().size() - 1);
-            emit shapeUpdated(id);
+            notifyShapeUpdated(id);
             if (!m_blockTableUpdates) {
-                emit vertexInfoUpdated();
+                notifyVertexInfoUpdated();
             }
             update();
         }
@@ -801,11 +1719,14 @@ void VKCanvas::removeVertexFromShape(int id, int vertexIndex)
 {
     Shape* shape = getShapeById(id);
     if (shape && shape->vertices().size() > 3) {
+        const Shape before = *shape;
         shape->removeVertex(vertexIndex);
+        syncShape(shape);
+        recordShape(before, shape);
         emit vertexRemoved(id, vertexIndex);
-        emit shapeUpdated(id);
+        notifyShapeUpdated(id);
         if (!m_blockTableUpdates) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
         update();
     }
@@ -815,24 +1736,58 @@ void VKCanvas::resetShapeVertices(int id)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->resetVertices();
-        emit shapeUpdated(id);
+        syncShape(shape);
+        recordShape(before, shape);
+        notifyShapeUpdated(id);
         if (!m_blockTableUpdates) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
         update();
     }
 }
 
+void VKCanvas::moveShapes(const QList<int> &ids, float dx, float dy)
+{
+    const QSet<int> moved(ids.cbegin(), ids.cend());
+    const QPointF offset(dx, dy);
+
+    c_undoStack.beginGroup();
+    for (int index = 0; index < c_shapes.size(); ++index) {
+        Shape &shape = c_shapes[index];
+        if (!moved.contains(shape.id()))
+            continue;
+
+        const UndoStack::Transform before = UndoStack::Transform::of(shape);
+        shape.setPosition(shape.position() + offset);
+        c_sceneStore.updateTransform(index, shape);
+        markShapeDirty(index);
+        postSimulation(SimulationWorker::Command::Update, shape);
+        c_undoStack.recordTransform(shape.id(), index, before, UndoStack::Transform::of(shape));
+        notifyShapeUpdated(shape.id());
+    }
+    c_undoStack.endGroup();
+    updateHistoryState();
+
+    if (!m_blockTableUpdates) {
+        notifyVertexInfoUpdated();
+    }
+    update();
+}
+
 void VKCanvas::setShapeVertex(int id, int vertexIndex, float x, float y)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const Shape before = *shape;
         shape->setVertex(vertexIndex, QPointF(x, y));
+        syncShape(shape);
+        recordShape(before, shape, HistoryVertex);
         emit vertexMoved(id, vertexIndex);
-        emit shapeUpdated(id);
+        notifyShapeUpdated(id);
         if (!m_blockTableUpdates) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
         update();
     }
@@ -867,159 +1822,184 @@ void VKCanvas::setEdgeLength(int shapeId, int edgeIndex, float newLength)
     QPointF newP1 = midPoint - dir * halfNewLength;
     QPointF newP2 = midPoint + dir * halfNewLength;
 
+    const Shape before = *shape;
     shape->setVertex(v1, newP1);
     shape->setVertex(v2, newP2);
 
     shape->setUseCustomVertices(true);
 
-    if (c_collisionsEnabled && shape->collisionsEnabled()) {
-        const int maxIterations = 5;
-        for (int iter = 0; iter < maxIterations; ++iter) {
-            bool anyCollision = false;
-
-            for (Shape &otherShape : c_shapes) {
-                if (otherShape.id() == shape->id()) continue;
-                if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                if (shape->checkCollision(otherShape)) {
-                    shape->resolveCollision(otherShape);
-                    anyCollision = true;
-                }
-            }
-
-            if (!anyCollision) break;
-        }
-    }
+    resolveCollisions(shape);
+    recordShape(before, shape, HistoryEdgeLength);
 
     emit vertexMoved(shapeId, v1);
     emit vertexMoved(shapeId, v2);
-    emit shapeUpdated(shapeId);
+    notifyShapeUpdated(shapeId);
     if (!m_blockTableUpdates) {
-        emit vertexInfoUpdated();
+        notifyVertexInfoUpdated();
     }
     update();
 }
 
-void VKCanvas::updateAxisXGeometry(QSGGeometry *geometry, QSGFlatColorMaterial *material)
+// Геометрия — прямоугольник элемента, меняется только с размером;
+// прокрутка и масштаб обновляют параметры материала
+void VKCanvas::updateGridNode(QSGGeometryNode *node)
 {
-    if (!c_showGrid) {
-        geometry->allocate(0);
-        return;
+    QSGGeometry *geometry = node->geometry();
+    const int vertexCount = c_showGrid ? 4 : 0;
+    const QRectF rect = boundingRect();
+    if (geometry->vertexCount() != vertexCount || c_renderedSize != size()) {
+        geometry->allocate(vertexCount);
+        if (vertexCount) {
+            QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+            vertices[0].set(rect.left(), rect.top());
+            vertices[1].set(rect.right(), rect.top());
+            vertices[2].set(rect.left(), rect.bottom());
+            vertices[3].set(rect.right(), rect.bottom());
+        }
+        node->markDirty(QSGNode::DirtyGeometry);
     }
 
-    const float gridSize = 50.0;
-    const float axisWidth = 1.0;
-
-    QPointF topLeft = screenToWorldNoRotation(QPointF(0, 0));
-    QPointF bottomRight = screenToWorldNoRotation(QPointF(width(), height()));
-
-    int startX = floor(topLeft.x() / gridSize) * gridSize;
-    int endX = ceil(bottomRight.x() / gridSize) * gridSize;
-    if (topLeft.y() <= 0 && bottomRight.y() >= 0) {
-        geometry->allocate(2);
-        geometry->setDrawingMode(QSGGeometry::DrawLines);
-        geometry->setLineWidth(axisWidth);
-
-        QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
-        QPointF p1 = worldToScreenNoRotation(QPointF(startX - gridSize, 0));
-        QPointF p2 = worldToScreenNoRotation(QPointF(endX + gridSize, 0));
-
-        vertices[0].set(p1.x(), p1.y());
-        vertices[1].set(p2.x(), p2.y());
-
-        material->setColor(QColor(255, 0, 0, 200));
-    } else {
-        geometry->allocate(0);
+    GridMaterial *material = static_cast<GridMaterial *>(node->material());
+    const QPointF offset(c_offsetX, c_offsetY);
+    if (material->offset() != offset || material->scale() != c_globalScale) {
+        material->setView(offset, c_globalScale);
+        node->markDirty(QSGNode::DirtyMaterial);
     }
 }
 
-void VKCanvas::updateAxisYGeometry(QSGGeometry *geometry, QSGFlatColorMaterial *material)
+// Плитки лежат в пикселях своего уровня, на экран их переводит матрица
+// узла: прокрутка и масштаб в пределах уровня не трогают текстуры.
+// Текстура загружается, только когда в кэше появилось новое
+// изображение. Возвращает число загруженных текстур.
+int VKCanvas::updateTileNodes(QSGTransformNode *node, const std::shared_ptr<const SceneSnapshot> &snapshot,
+                              const QRectF &viewRect, bool viewChanged, int &allocated)
 {
-    if (!c_showGrid) {
-        geometry->allocate(0);
-        return;
+    if (!c_tileCache || !window()) {
+        qDeleteAll(c_tileNodes);
+        c_tileNodes.clear();
+        c_liveShapes.clear();
+        return 0;
     }
 
-    const float gridSize = 50.0;
-    const float axisWidth = 1.0;
-
-    QPointF topLeft = screenToWorldNoRotation(QPointF(0, 0));
-    QPointF bottomRight = screenToWorldNoRotation(QPointF(width(), height()));
-
-    int startY = floor(topLeft.y() / gridSize) * gridSize;
-    int endY = ceil(bottomRight.y() / gridSize) * gridSize;
-    if (topLeft.x() <= 0 && bottomRight.x() >= 0) {
-        geometry->allocate(2);
-        geometry->setDrawingMode(QSGGeometry::DrawLines);
-        geometry->setLineWidth(axisWidth);
-
-        QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
-        QPointF p1 = worldToScreenNoRotation(QPointF(0, startY - gridSize));
-        QPointF p2 = worldToScreenNoRotation(QPointF(0, endY + gridSize));
-
-        vertices[0].set(p1.x(), p1.y());
-        vertices[1].set(p2.x(), p2.y());
+    const int level = TileCache::levelForScale(c_globalScale);
+    if (viewChanged) {
+        QMatrix4x4 view;
+        view.translate(c_offsetX, c_offsetY);
+        view.scale(c_globalScale / TileCache::levelScale(level));
+        node->setMatrix(view);
+    }
+    c_tileCache->setSnapshot(snapshot);
+    c_tileCache->request(viewRect, c_globalScale, c_visibleTiles);
+
+    ++c_tileFrame;
+    int uploaded = 0;
+    for (const TileCache::Key &key : std::as_const(c_visibleTiles)) {
+        TileNode *tileNode = static_cast<TileNode *>(c_tileNodes.value(key));
+        if (tileNode)
+            tileNode->frame = c_tileFrame;
+        const TileCache::Image tile = c_tileCache->find(key);
+        if (tile.image.isNull())
+            continue;
+        if (!tileNode) {
+            tileNode = new TileNode();
+            tileNode->setOwnsTexture(true);
+            tileNode->setFiltering(QSGTexture::Linear);
+            tileNode->setRect(QRectF(key.x * TileCache::TilePixels, key.y * TileCache::TilePixels,
+                                     TileCache::TilePixels, TileCache::TilePixels));
+            tileNode->frame = c_tileFrame;
+            node->appendChildNode(tileNode);
+            c_tileNodes.insert(key, tileNode);
+            ++allocated;
+        }
+        if (tileNode->source != tile.key || tileNode->revision != tile.revision) {
+            tileNode->setTexture(window()->createTextureFromImage(tile.image));
+            tileNode->setSourceRect(tile.source);
+            tileNode->source = tile.key;
+            tileNode->revision = tile.revision;
+            tileNode->version = tile.version;
+            ++uploaded;
+        }
+    }
 
-        material->setColor(QColor(0, 0, 255, 200));
-    } else {
-        geometry->allocate(0);
+    // Ушедшие с экрана плитки и плитки прошлого уровня
+    for (auto it = c_tileNodes.begin(); it != c_tileNodes.end();) {
+        if (static_cast<TileNode *>(it.value())->frame != c_tileFrame) {
+            delete it.value();
+            it = c_tileNodes.erase(it);
+        } else {
+            ++it;
+        }
     }
+    updateLiveShapes(level);
+    return uploaded;
 }
 
-void VKCanvas::updateGridGeometry(QSGGeometry *geometry, QSGFlatColorMaterial *material)
+// Решение принимается по текстурам, загруженным в этом же кадре: фигура
+// уходит из узлов ровно тогда, когда появляется в плитках, и не
+// рисуется ни дважды, ни ни разу
+void VKCanvas::updateLiveShapes(int level)
 {
-    if (!c_showGrid) {
-        geometry->allocate(0);
+    const QHash<int, TileCache::Change> &changes = c_tileCache->changes();
+    if (changes.isEmpty() && c_liveShapes.isEmpty())
         return;
-    }
 
-    const float gridSize = 50.0;
-    const float gridWidth = 1.0;
-
-    QPointF topLeft = screenToWorldNoRotation(QPointF(0, 0));
-    QPointF bottomRight = screenToWorldNoRotation(QPointF(width(), height()));
-
-    int startX = floor(topLeft.x() / gridSize) * gridSize;
-    int endX = ceil(bottomRight.x() / gridSize) * gridSize;
-    int startY = floor(topLeft.y() / gridSize) * gridSize;
-    int endY = ceil(bottomRight.y() / gridSize) * gridSize;
+    QHash<int, int> live;
+    QVector<int> settled;
+    for (auto it = changes.cbegin(); it != changes.cend(); ++it) {
+        if (tilesCurrent(it.value(), level))
+            settled.append(it.key());
+        else
+            live.insert(it.key(), it->chunk);
+    }
+    for (int id : std::as_const(settled))
+        c_tileCache->settle(id);
 
-    int numLinesX = (endX - startX) / gridSize + 1;
-    int numLinesY = (endY - startY) / gridSize + 1;
-    int vertexCount = 0;
-    for (float x = startX; x <= endX; x += gridSize) {
-        if (!qFuzzyIsNull(x)) vertexCount += 2;
+    for (auto it = live.cbegin(); it != live.cend(); ++it) {
+        if (c_liveShapes.value(it.key(), -1) != it.value())
+            c_rebuildChunks.insert(it.value());
     }
-    for (float y = startY; y <= endY; y += gridSize) {
-        if (!qFuzzyIsNull(y)) vertexCount += 2;
+    for (auto it = c_liveShapes.cbegin(); it != c_liveShapes.cend(); ++it) {
+        if (live.value(it.key(), -1) != it.value())
+            c_rebuildChunks.insert(it.value());
     }
-
-    geometry->allocate(vertexCount);
-    geometry->setDrawingMode(QSGGeometry::DrawLines);
-    geometry->setLineWidth(gridWidth);
-
-    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
-    int vertexIndex = 0;
-    for (float x = startX; x <= endX; x += gridSize) {
-        if (qFuzzyIsNull(x)) continue;
-
-        QPointF p1 = worldToScreenNoRotation(QPointF(x, startY - gridSize));
-        QPointF p2 = worldToScreenNoRotation(QPointF(x, endY + gridSize));
-
-        vertices[vertexIndex++].set(p1.x(), p1.y());
-        vertices[vertexIndex++].set(p2.x(), p2.y());
+    c_liveShapes = std::move(live);
+}
+
+// Видимые плитки под рамкой фигуры нарисованы из снимка не старше
+// изменения. Плитки за краем экрана не проверяются: они перерисуются,
+// когда на них прокрутят, и до того покажут прежнее изображение.
+bool VKCanvas::tilesCurrent(const TileCache::Change &change, int level) const
+{
+    if (c_visibleTiles.isEmpty())
+        return true;
+
+    int left = c_visibleTiles.first().x;
+    int right = left;
+    int top = c_visibleTiles.first().y;
+    int bottom = top;
+    for (const TileCache::Key &key : c_visibleTiles) {
+        left = qMin(left, key.x);
+        right = qMax(right, key.x);
+        top = qMin(top, key.y);
+        bottom = qMax(bottom, key.y);
     }
-    for (float y = startY; y <= endY; y += gridSize) {
-        if (qFuzzyIsNull(y)) continue;
-
-        QPointF p1 = worldToScreenNoRotation(QPointF(startX - gridSize, y));
-        QPointF p2 = worldToScreenNoRotation(QPointF(endX + gridSize, y));
 
-        vertices[vertexIndex++].set(p1.x(), p1.y());
-        vertices[vertexIndex++].set(p2.x(), p2.y());
+    const double scale = TileCache::levelScale(level);
+    const double size = TileCache::TilePixels / scale;
+    const double margin = (OutlineWidth + 1) / scale;
+    left = qMax(left, int(std::floor((change.bounds.left() - margin) / size)));
+    right = qMin(right, int(std::floor((change.bounds.right() + margin) / size)));
+    top = qMax(top, int(std::floor((change.bounds.top() - margin) / size)));
+    bottom = qMin(bottom, int(std::floor((change.bounds.bottom() + margin) / size)));
+
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            const TileNode *tileNode = static_cast<const TileNode *>(c_tileNodes.value(TileCache::Key { level, x, y }));
+            if (!tileNode || tileNode->version < change.version)
+                return false;
+        }
     }
-
-    material->setColor(QColor(100, 100, 100, 80));
+    return true;
 }
 
 void VKCanvas::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
@@ -1037,6 +2017,10 @@ void VKCanvas::geometryChange(const QRectF &newGeometry, const QRectF &oldGeomet
 
 void VKCanvas::mouseMoveEvent(QMouseEvent *event)
 {
+    ProfileScope profile(Profiler::Input);
+    if (c_inputRecorder)
+        c_inputRecorder->record(event);
+
     QPointF delta = event->position() - c_lastMousePos;
     c_lastMousePos = event->position();
 
@@ -1049,6 +2033,8 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
     } else if (c_dragMode == DragShape && c_draggingShapeId != -1) {
         Shape *shape = getShapeById(c_draggingShapeId);
         if (shape) {
+            beginDragEdit();
+            const Shape before = *shape;
             bool shapeChanged = false;
 
             if (c_transformMode == Rotate) {
@@ -1086,24 +2072,7 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
                 QPointF newPos = c_dragShapeStartPos + worldDelta;
                 shape->setPosition(newPos);
 
-                if (c_collisionsEnabled && shape->collisionsEnabled()) {
-                    const int maxIterations = 5;
-                    for (int iter = 0; iter < maxIterations; ++iter) {
-                        bool anyCollision = false;
-
-                        for (Shape &otherShape : c_shapes) {
-                            if (otherShape.id() == shape->id()) continue;
-                            if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                            if (shape->checkCollision(otherShape)) {
-                                shape->resolveCollision(otherShape);
-                                anyCollision = true;
-                            }
-                        }
-
-                        if (!anyCollision) break;
-                    }
-                }
+                resolveCollisions(shape);
                 shapeChanged = true;
             } else if (c_transformMode == sWidth) {
                 QPointF center = worldToScreenNoRotation(shape->position());
@@ -1148,24 +2117,7 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
 
                 shape->setPosition(newPos);
 
-                if (c_collisionsEnabled && shape->collisionsEnabled()) {
-                    const int maxIterations = 5;
-                    for (int iter = 0; iter < maxIterations; ++iter) {
-                        bool anyCollision = false;
-
-                        for (Shape &otherShape : c_shapes) {
-                            if (otherShape.id() == shape->id()) continue;
-                            if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                            if (shape->checkCollision(otherShape)) {
-                                shape->resolveCollision(otherShape);
-                                anyCollision = true;
-                            }
-                        }
-
-                        if (!anyCollision) break;
-                    }
-                }
+                resolveCollisions(shape);
                 shapeChanged = true;
             }
             else if (c_transformMode == MoveY) {
@@ -1179,29 +2131,17 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
 
                 shape->setPosition(newPos);
 
-                if (c_collisionsEnabled && shape->collisionsEnabled()) {
-                    const int maxIterations = 5;
-                    for (int iter = 0; iter < maxIterations; ++iter) {
-                        bool anyCollision = false;
-
-                        for (Shape &otherShape : c_shapes) {
-                            if (otherShape.id() == shape->id()) continue;
-                            if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                            if (shape->checkCollision(otherShape)) {
-                                shape->resolveCollision(otherShape);
-                                anyCollision = true;
-                            }
-                        }
-
-                        if (!anyCollision) break;
-                    }
-                }
+                resolveCollisions(shape);
                 shapeChanged = true;
             }
 
             if (shapeChanged) {
-                emit shapeUpdated(c_draggingShapeId);
+                syncShape(shape);
+                if (c_transformMode == sWidth || c_transformMode == sHeight)
+                    recordShape(before, shape);
+                else
+                    recordTransform(shape, UndoStack::Transform::of(before));
+                notifyShapeUpdated(c_draggingShapeId);
                 update();
             }
         }
@@ -1209,33 +2149,19 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
     } else if (c_dragMode == DragVertex && c_draggingShapeId != -1 && c_draggingVertexIndex != -1) {
         Shape *shape = getShapeById(c_draggingShapeId);
         if (shape && c_draggingVertexIndex >= 0 && c_draggingVertexIndex < shape->vertices().size()) {
+            beginDragEdit();
+            const Shape before = *shape;
 
             QPointF worldPos = screenToWorldNoRotation(event->position());
             QPointF localPos = shape->worldToLocal(worldPos, c_globalScale);
             shape->setVertex(c_draggingVertexIndex, localPos);
 
-            if (c_collisionsEnabled && shape->collisionsEnabled()) {
-                const int maxIterations = 5;
-                for (int iter = 0; iter < maxIterations; ++iter) {
-                    bool anyCollision = false;
-
-                    for (Shape &otherShape : c_shapes) {
-                        if (otherShape.id() == shape->id()) continue;
-                        if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                        if (shape->checkCollision(otherShape)) {
-                            shape->resolveCollision(otherShape);
-                            anyCollision = true;
-                        }
-                    }
-
-                    if (!anyCollision) break;
-                }
-            }
+            resolveCollisions(shape);
+            recordShape(before, shape);
 
             if (shape->vertices()[c_draggingVertexIndex] != c_dragVertexStartPos) {
                 emit vertexMoved(shape->id(), c_draggingVertexIndex);
-                emit shapeUpdated(shape->id());
+                notifyShapeUpdated(shape->id());
                 update();
             }
         }
@@ -1243,6 +2169,8 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
     } else if (c_dragMode == DragEdge && c_draggingShapeId != -1 && c_draggingEdgeIndex != -1) {
         Shape *shape = getShapeById(c_draggingShapeId);
         if (shape && c_draggingEdgeIndex >= 0 && !c_dragEdgeVertices.isEmpty()) {
+            beginDragEdit();
+            const Shape before = *shape;
             QPointF worldDelta = screenToWorldNoRotation(event->position()) -
                                  screenToWorldNoRotation(c_dragStartPos);
 
@@ -1256,28 +2184,12 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
 
             shape->setVertices(vertices);
 
-            if (c_collisionsEnabled && shape->collisionsEnabled()) {
-                const int maxIterations = 5;
-                for (int iter = 0; iter < maxIterations; ++iter) {
-                    bool anyCollision = false;
-
-                    for (Shape &otherShape : c_shapes) {
-                        if (otherShape.id() == shape->id()) continue;
-                        if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                        if (shape->checkCollision(otherShape)) {
-                            shape->resolveCollision(otherShape);
-                            anyCollision = true;
-                        }
-                    }
-
-                    if (!anyCollision) break;
-                }
-            }
+            resolveCollisions(shape);
+            recordShape(before, shape);
 
             emit vertexMoved(shape->id(), c_draggingEdgeIndex);
             emit vertexMoved(shape->id(), nextIndex);
-            emit shapeUpdated(shape->id());
+            notifyShapeUpdated(shape->id());
             update();
         }
         event->accept();
@@ -1288,6 +2200,10 @@ void VKCanvas::mouseMoveEvent(QMouseEvent *event)
 
 void VKCanvas::mousePressEvent(QMouseEvent *event)
 {
+    ProfileScope profile(Profiler::Input);
+    if (c_inputRecorder)
+        c_inputRecorder->record(event);
+
     c_lastMousePos = event->position();
     c_dragStartPos = c_lastMousePos;
 
@@ -1391,8 +2307,7 @@ void VKCanvas::mousePressEvent(QMouseEvent *event)
                     float rotation = shape->rotation();
                     QTransform transform;
                     transform.rotate(rotation);
-                    float maxSize = qMax(sizeWidthShape, sizeHeightShape);
-                    float ringRadius = maxSize + 40.0;
+                    float ringRadius = GizmoNode::ringRadius(sizeWidthShape, sizeHeightShape);
                     float ringThickness = 3.0;
 
                     float distance = QLineF(event->position(), center).length();
@@ -1540,10 +2455,14 @@ void VKCanvas::mousePressEvent(QMouseEvent *event)
 
 void VKCanvas::mouseReleaseEvent(QMouseEvent *event)
 {
+    ProfileScope profile(Profiler::Input);
+    if (c_inputRecorder)
+        c_inputRecorder->record(event);
+
     if ((event->button() == Qt::RightButton && c_dragMode == PanCanvas) ||
         (event->button() == Qt::LeftButton && (c_dragMode == DragShape || c_dragMode == DragVertex || c_dragMode == DragEdge))) {
         if (c_dragMode == DragVertex || c_dragMode == DragEdge || c_dragMode == DragShape) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
 
         c_dragMode = NoDrag;
@@ -1552,6 +2471,7 @@ void VKCanvas::mouseReleaseEvent(QMouseEvent *event)
         c_draggingEdgeIndex = -1;
         c_transformMode = NoTransform;
         c_dragEdgeVertices.clear();
+        endDragEdit();
         if (m_dragging) {
             m_dragging = false;
             emit draggingChanged();
@@ -1575,190 +2495,143 @@ void VKCanvas::mouseReleaseEvent(QMouseEvent *event)
 
 QSGNode *VKCanvas::updatePaintNode(QSGNode *node, UpdatePaintNodeData *)
 {
+    ProfileScope profile(Profiler::PaintNode);
+    AllocationCounter::Scope allocations;
+    c_frameArena.reset();
     QSGNode *rootNode = node;
 
     if (!rootNode) {
         rootNode = new QSGNode();
+        // Сетка и оси — один прямоугольник с GridMaterial
         QSGGeometryNode *gridNode = new QSGGeometryNode();
         QSGGeometry *gridGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
-        QSGFlatColorMaterial *gridMaterial = new QSGFlatColorMaterial();
+        gridGeometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
         gridNode->setGeometry(gridGeometry);
-        gridNode->setMaterial(gridMaterial);
+        gridNode->setMaterial(new GridMaterial());
         gridNode->setFlag(QSGNode::OwnsGeometry);
         gridNode->setFlag(QSGNode::OwnsMaterial);
         rootNode->appendChildNode(gridNode);
-        QSGGeometryNode *axisXNode = new QSGGeometryNode();
-        QSGGeometry *axisXGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
-        QSGFlatColorMaterial *axisXMaterial = new QSGFlatColorMaterial();
-        axisXNode->setGeometry(axisXGeometry);
-        axisXNode->setMaterial(axisXMaterial);
-        axisXNode->setFlag(QSGNode::OwnsGeometry);
-        axisXNode->setFlag(QSGNode::OwnsMaterial);
-        rootNode->appendChildNode(axisXNode);
-        QSGGeometryNode *axisYNode = new QSGGeometryNode();
-        QSGGeometry *axisYGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
-        QSGFlatColorMaterial *axisYMaterial = new QSGFlatColorMaterial();
-        axisYNode->setGeometry(axisYGeometry);
-        axisYNode->setMaterial(axisYMaterial);
-        axisYNode->setFlag(QSGNode::OwnsGeometry);
-        axisYNode->setFlag(QSGNode::OwnsMaterial);
-        rootNode->appendChildNode(axisYNode);
-    } else {
-        while (rootNode->childCount() > 3) {
-            delete rootNode->lastChild();
-        }
+        // Плитки неподвижных фигур, страницы фигур и маркеры выделенной
+        rootNode->appendChildNode(new QSGTransformNode());
+        rootNode->appendChildNode(new QSGTransformNode());
+        rootNode->appendChildNode(new GizmoNode());
+        c_renderedSnapshot.reset();
+        c_tileNodes.clear();
     }
 
     if (!c_initialized && width() > 0 && height() > 0) {
         centerOnZero();
         c_initialized = true;
     }
-    QSGGeometryNode *gridNode = static_cast<QSGGeometryNode *>(rootNode->childAtIndex(0));
-    QSGGeometryNode *axisXNode = static_cast<QSGGeometryNode *>(rootNode->childAtIndex(1));
-    QSGGeometryNode *axisYNode = static_cast<QSGGeometryNode *>(rootNode->childAtIndex(2));
-
-    updateGridGeometry(gridNode->geometry(),
-                       static_cast<QSGFlatColorMaterial *>(gridNode->material()));
-    updateAxisXGeometry(axisXNode->geometry(),
-                        static_cast<QSGFlatColorMaterial *>(axisXNode->material()));
-    updateAxisYGeometry(axisYNode->geometry(),
-                        static_cast<QSGFlatColorMaterial *>(axisYNode->material()));
-
-    for (const Shape &shape : c_shapes) {
-        QSGGeometryNode *shapeNode = createShapeNode();
-        updateShapeGeometry(shapeNode, shape);
-        rootNode->appendChildNode(shapeNode);
-        if (shape.id() == c_selectedShapeId) {
-            if (c_activeTab == 1) {
-                int vertexCount = shape.vertices().size();
-                for (int i = 0; i < vertexCount; ++i) {
-                    int nextI = (i + 1) % vertexCount;
-                    QPointF p1 = vertexToScreen(shape.id(), i);
-                    QPointF p2 = vertexToScreen(shape.id(), nextI);
-
-                    QColor edgeColor;
-                    if (i == c_selectedEdgeIndex) {
-                        edgeColor = QColor(255, 255, 0, 180);
-                    } else {
-                        edgeColor = QColor(255, 255, 255, 120);
-                    }
+    {
+        ProfileScope gridProfile(Profiler::Grid);
+        updateGridNode(static_cast<QSGGeometryNode *>(rootNode->childAtIndex(0)));
+    }
 
-                    QSGGeometryNode *edgeNode = createEdgeNode(p1, p2, edgeColor);
-                    rootNode->appendChildNode(edgeNode);
-                }
-                for (int i = 0; i < vertexCount; ++i) {
-                    QPointF vertexScreenPos = vertexToScreen(shape.id(), i);
-                    QColor vertexColor;
-
-                    if (i == c_selectedVertexIndex) {
-                        vertexColor = QColor(255, 0, 0);
-                    } else {
-                        vertexColor = QColor(255, 255, 255);
-                    }
+    const QRectF viewRect(screenToWorldNoRotation(QPointF(0, 0)),
+                          screenToWorldNoRotation(QPointF(width(), height())));
+
+    // Без окна (бенчмарки) updatePolish не вызывается. GUI-поток здесь
+    // заблокирован, так что публиковать снимок безопасно.
+    publishSnapshot();
+    const std::shared_ptr<const SceneSnapshot> snapshot = c_publishedSnapshot;
+
+    const bool viewChanged = c_renderedScale != c_globalScale || c_renderedOffset != QPointF(c_offsetX, c_offsetY)
+                             || c_renderedSize != size();
+    int allocated = node ? 0 : 6;
+    int shapesRebuilt = 0;
+
+    // При смене режима страницы перестраиваются: с плитками в них только
+    // фигуры, которых в плитках нет (см. updateChunkNode)
+    const bool tiled = c_tileCache != nullptr;
+    if (tiled != c_renderedTiled)
+        c_renderedSnapshot.reset();
+    const int tilesUploaded = updateTileNodes(static_cast<QSGTransformNode *>(rootNode->childAtIndex(1)), snapshot,
+                                              viewRect, viewChanged || tiled != c_renderedTiled || !node,
+                                              allocated);
+
+    // Страницы хранят мировые координаты: прокрутка и масштаб — одна
+    // матрица, перестраиваются только страницы с изменившимися фигурами
+    QSGTransformNode *shapesNode = static_cast<QSGTransformNode *>(rootNode->childAtIndex(2));
+    if (viewChanged || !node) {
+        QMatrix4x4 view;
+        view.translate(c_offsetX, c_offsetY);
+        view.scale(c_globalScale);
+        shapesNode->setMatrix(view);
+    }
+    for (int count = shapesNode->childCount(); count > snapshot->chunkCount(); --count)
+        delete shapesNode->lastChild();
+
+    // Обводка выходит за рамку фигур на несколько пикселей
+    const qreal cullMargin = (SelectedOutlineWidth / 2 + 1) / c_globalScale;
+    const QRectF cullRect = viewRect.adjusted(-cullMargin, -cullMargin, cullMargin, cullMargin);
+    ChunkNode *chunkNode = static_cast<ChunkNode *>(shapesNode->firstChild());
+    for (int chunk = 0; chunk < snapshot->chunkCount(); ++chunk) {
+        const bool reused = chunkNode && c_renderedSnapshot
+                            && chunk < c_renderedSnapshot->chunkCount()
+                            && c_renderedSnapshot->chunk(chunk) == snapshot->chunk(chunk);
+        if (!chunkNode) {
+            chunkNode = new ChunkNode();
+            shapesNode->appendChildNode(chunkNode);
+            ++allocated;
+        }
+        if (!reused || c_rebuildChunks.contains(chunk))
+            shapesRebuilt += updateChunkNode(chunkNode, *snapshot->chunk(chunk), tiled, chunkNode->bounds, allocated);
 
-                    QSGGeometryNode *vertexNode = createVertexNode(vertexScreenPos, vertexColor);
-                    rootNode->appendChildNode(vertexNode);
-                }
-            } else {
-                QPointF center = worldToScreenNoRotation(shape.position());
-                float sizeHeightShape = shape.sizeHeigth() * shape.scale() * c_globalScale;
-                float sizeWidthShape = shape.sizeWidth() * shape.scale() * c_globalScale;
-                float rotation = shape.rotation();
-                QTransform transform;
-                transform.rotate(rotation);
-                float maxSize = qMax(sizeWidthShape, sizeHeightShape);
-                float ringRadius = maxSize + 40.0;
-                const int ringSegments = 64;
-                QSGGeometryNode *ringNode = new QSGGeometryNode();
-                QSGGeometry *ringGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), ringSegments * 2);
-                QSGFlatColorMaterial *ringMaterial = new QSGFlatColorMaterial();
-                ringGeometry->setDrawingMode(QSGGeometry::DrawLines);
-                ringGeometry->setLineWidth(3.0);
-                ringNode->setGeometry(ringGeometry);
-                ringNode->setMaterial(ringMaterial);
-                ringNode->setFlag(QSGNode::OwnsGeometry);
-                ringNode->setFlag(QSGNode::OwnsMaterial);
-
-                QSGGeometry::Point2D *ringVertices = ringGeometry->vertexDataAsPoint2D();
-                for (int i = 0; i < ringSegments; ++i) {
-                    float angle1 = 2.0 * PI * i / ringSegments;
-                    float angle2 = 2.0 * PI * (i + 1) / ringSegments;
-
-                    QPointF p1(cos(angle1) * ringRadius, sin(angle1) * ringRadius);
-                    QPointF p2(cos(angle2) * ringRadius, sin(angle2) * ringRadius);
-
-                    p1 += center;
-                    p2 += center;
-
-                    ringVertices[i * 2].set(p1.x(), p1.y());
-                    ringVertices[i * 2 + 1].set(p2.x(), p2.y());
-                }
-                ringMaterial->setColor(QColor(0, 200, 0, 150));
-                rootNode->appendChildNode(ringNode);
-                QPointF scaleHandleLocal = QPointF(sizeWidthShape + 20, 0);
-                QPointF scaleHandle = center + transform.map(scaleHandleLocal);
-                QSGGeometryNode *scaleNode = createTransformHandle(scaleHandle, QColor(200, 200, 200));
-                rootNode->appendChildNode(scaleNode);
-                QPointF sizeWidthLocal = QPointF(0, sizeHeightShape + 20);
-                QPointF sizeWidthPoint = center + transform.map(sizeWidthLocal);
-                QSGGeometryNode *sizeWidthNode = createTransformHandle(sizeWidthPoint, QColor(0, 0, 200));
-                rootNode->appendChildNode(sizeWidthNode);
-                QPointF sizeHeightLocal = QPointF(-sizeWidthShape - 20, 0);
-                QPointF sizeHeightPoint = center + transform.map(sizeHeightLocal);
-                QSGGeometryNode *sizeHeightNode = createTransformHandle(sizeHeightPoint, QColor(200, 0, 0));
-                rootNode->appendChildNode(sizeHeightNode);
-                QPointF moveXLocal = QPointF(ringRadius + 20, 0);
-                QPointF moveXPoint = center + transform.map(moveXLocal);
-                QSGGeometryNode *moveXNode = new QSGGeometryNode();
-                QSGGeometry *moveXGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 3);
-                QSGFlatColorMaterial *moveXMaterial = new QSGFlatColorMaterial();
-                moveXGeometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
-                moveXNode->setGeometry(moveXGeometry);
-                moveXNode->setMaterial(moveXMaterial);
-                moveXNode->setFlag(QSGNode::OwnsGeometry);
-                moveXNode->setFlag(QSGNode::OwnsMaterial);
-
-                QSGGeometry::Point2D *moveXVertices = moveXGeometry->vertexDataAsPoint2D();
-                const float triangleSize = 10.0;
-                QPointF dirX = transform.map(QPointF(1, 0));
-                QPointF perpX = transform.map(QPointF(0, 1));
-                moveXVertices[0].set(moveXPoint.x(), moveXPoint.y());
-                moveXVertices[1].set(moveXPoint.x() - dirX.x() * triangleSize + perpX.x() * triangleSize/2,
-                                     moveXPoint.y() - dirX.y() * triangleSize + perpX.y() * triangleSize/2);
-                moveXVertices[2].set(moveXPoint.x() - dirX.x() * triangleSize - perpX.x() * triangleSize/2,
-                                     moveXPoint.y() - dirX.y() * triangleSize - perpX.y() * triangleSize/2);
-                moveXMaterial->setColor(QColor(255, 0, 0));
-                rootNode->appendChildNode(moveXNode);
-                QPointF moveYLocal = QPointF(0, -ringRadius - 20);
-                QPointF moveYPoint = center + transform.map(moveYLocal);
-                QSGGeometryNode *moveYNode = new QSGGeometryNode();
-                QSGGeometry *moveYGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 3);
-                QSGFlatColorMaterial *moveYMaterial = new QSGFlatColorMaterial();
-                moveYGeometry->setDrawingMode(QSGGeometry::DrawTriangleFan);
-                moveYNode->setGeometry(moveYGeometry);
-                moveYNode->setMaterial(moveYMaterial);
-                moveYNode->setFlag(QSGNode::OwnsGeometry);
-                moveYNode->setFlag(QSGNode::OwnsMaterial);
-
-                QSGGeometry::Point2D *moveYVertices = moveYGeometry->vertexDataAsPoint2D();
-                QPointF dirY = transform.map(QPointF(0, 1));
-                QPointF perpY = transform.map(QPointF(1, 0));
-                moveYVertices[0].set(moveYPoint.x(), moveYPoint.y());
-                moveYVertices[1].set(moveYPoint.x() + dirY.x() * triangleSize + perpY.x() * triangleSize/2,
-                                     moveYPoint.y() + dirY.y() * triangleSize + perpY.y() * triangleSize/2);
-                moveYVertices[2].set(moveYPoint.x() + dirY.x() * triangleSize - perpY.x() * triangleSize/2,
-                                     moveYPoint.y() + dirY.y() * triangleSize - perpY.y() * triangleSize/2);
-                moveYMaterial->setColor(QColor(0, 0, 255));
-                rootNode->appendChildNode(moveYNode);
-            }
+        const bool culled = !chunkNode->bounds.intersects(cullRect);
+        if (culled != chunkNode->culled) {
+            chunkNode->culled = culled;
+            chunkNode->markDirty(QSGNode::DirtySubtreeBlocked);
         }
+        chunkNode = static_cast<ChunkNode *>(chunkNode->nextSibling());
+    }
+    c_rebuildChunks.clear();
+
+    // Маркеры обновляются, только если изменилась сцена, вид или
+    // выделение; узлы маркеров постоянные, меняются буферы и матрица
+    const GizmoState gizmo { c_selectedShapeId, c_activeTab, c_selectedVertexIndex, c_selectedEdgeIndex };
+    const bool gizmoChanged = !node || viewChanged || snapshot != c_renderedSnapshot || !(gizmo == c_renderedGizmo);
+
+    c_renderedSnapshot = snapshot;
+    c_renderedScale = c_globalScale;
+    c_renderedOffset = QPointF(c_offsetX, c_offsetY);
+    c_renderedSize = size();
+    c_renderedTiled = tiled;
+    c_renderedGizmo = gizmo;
+
+    GizmoNode *gizmoNode = static_cast<GizmoNode *>(rootNode->childAtIndex(3));
+    const Shape *selectedShape = gizmoChanged ? getShapeById(c_selectedShapeId) : nullptr;
+    if (selectedShape && c_activeTab == 1) {
+        const Shape &shape = *selectedShape;
+        int vertexCount = shape.vertices().size();
+        std::pmr::vector<QPointF> screenVertices(vertexCount, &c_frameArena);
+        for (int i = 0; i < vertexCount; ++i)
+            screenVertices[i] = worldToScreenNoRotation(shape.getVertexWorldPosition(i));
+        gizmoNode->setEditHandles(screenVertices.data(), vertexCount, c_selectedVertexIndex, c_selectedEdgeIndex);
+    } else if (selectedShape) {
+        const Shape &shape = *selectedShape;
+        gizmoNode->setObjectHandles(worldToScreenNoRotation(shape.position()), shape.rotation(),
+                                    shape.sizeWidth() * shape.scale() * c_globalScale,
+                                    shape.sizeHeigth() * shape.scale() * c_globalScale);
+    } else if (gizmoChanged) {
+        gizmoNode->clear();
     }
 
+    Profiler::count(Profiler::ShapesDrawn, shapesRebuilt);
+    Profiler::count(Profiler::NodesAllocated, allocated);
+    Profiler::count(Profiler::TilesUploaded, tilesUploaded);
+    Profiler::count(Profiler::Allocations, allocations.count());
+    Profiler::count(Profiler::AllocatedBytes, allocations.bytes());
+    Profiler::count(Profiler::ArenaBytes, c_frameArena.bytesUsed());
     return rootNode;
 }
 
 void VKCanvas::hoverMoveEvent(QHoverEvent *event)
 {
+    ProfileScope profile(Profiler::Input);
+    if (c_inputRecorder)
+        c_inputRecorder->record(event);
+
     if (c_dragMode == NoDrag) {
         if (c_activeTab == 1) {
             // Режим редактирования
@@ -1799,8 +2672,7 @@ void VKCanvas::hoverMoveEvent(QHoverEvent *event)
                     float rotation = shape->rotation();
                     QTransform transform;
                     transform.rotate(rotation);
-                    float maxSize = qMax(sizeWidthShape, sizeHeightShape);
-                    float ringRadius = maxSize + 40.0;
+                    float ringRadius = GizmoNode::ringRadius(sizeWidthShape, sizeHeightShape);
                     float ringThickness = 3.0;
 
                     float distance = QLineF(event->position(), center).length();
@@ -1853,6 +2725,10 @@ void VKCanvas::hoverMoveEvent(QHoverEvent *event)
 
 void VKCanvas::wheelEvent(QWheelEvent *event)
 {
+    ProfileScope profile(Profiler::Input);
+    if (c_inputRecorder)
+        c_inputRecorder->record(event);
+
     QPointF angleDelta = event->angleDelta();
 
     if (!angleDelta.isNull()) {
@@ -1886,7 +2762,7 @@ void VKCanvas::wheelEvent(QWheelEvent *event)
 
 void VKCanvas::requestVertexInfoUpdate()
 {
-    emit vertexInfoUpdated();
+    notifyVertexInfoUpdated();
 }
 
 void VKCanvas::setSelectedVertexIndex(int index)
@@ -1901,7 +2777,7 @@ void VKCanvas::setSelectedVertexIndex(int index)
                 c_selectedEdgeIndex = -1;
                 emit selectedVertexIndexChanged();
                 emit selectedEdgeIndexChanged();
-                emit vertexInfoUpdated();
+                notifyVertexInfoUpdated();
                 update();
                 return;
             }
@@ -1910,7 +2786,7 @@ void VKCanvas::setSelectedVertexIndex(int index)
     if (c_selectedVertexIndex != -1) {
         c_selectedVertexIndex = -1;
         emit selectedVertexIndexChanged();
-        emit vertexInfoUpdated();
+        notifyVertexInfoUpdated();
         update();
     }
 }
@@ -1925,29 +2801,14 @@ void VKCanvas::setShapePosition(int id, float x, float y)
 {
     Shape* shape = getShapeById(id);
     if (shape) {
+        const UndoStack::Transform before = UndoStack::Transform::of(*shape);
         shape->setPosition(QPointF(x, y));
 
-        if (c_collisionsEnabled && shape->collisionsEnabled()) {
-            const int maxIterations = 5;
-            for (int iter = 0; iter < maxIterations; ++iter) {
-                bool anyCollision = false;
-
-                for (Shape &otherShape : c_shapes) {
-                    if (otherShape.id() == shape->id()) continue;
-                    if (!otherShape.isVisible() || !otherShape.collisionsEnabled()) continue;
-
-                    if (shape->checkCollision(otherShape)) {
-                        shape->resolveCollision(otherShape);
-                        anyCollision = true;
-                    }
-                }
-
-                if (!anyCollision) break;
-            }
-        }
+        resolveCollisions(shape);
+        recordTransform(shape, before, HistoryPosition);
 
-        emit shapeUpdated(id);
-        emit vertexInfoUpdated();
+        notifyShapeUpdated(id);
+        notifyVertexInfoUpdated();
         update();
     }
 }
@@ -1966,7 +2827,7 @@ void VKCanvas::setSelectedEdgeIndex(int index)
                 c_selectedVertexIndex = -1;
                 emit selectedEdgeIndexChanged();
                 emit selectedVertexIndexChanged();
-                emit vertexInfoUpdated();
+                notifyVertexInfoUpdated();
                 update();
                 return;
             }
@@ -1976,7 +2837,7 @@ void VKCanvas::setSelectedEdgeIndex(int index)
     if (c_selectedEdgeIndex != -1) {
         c_selectedEdgeIndex = -1;
         emit selectedEdgeIndexChanged();
-        emit vertexInfoUpdated();
+        notifyVertexInfoUpdated();
         update();
     }
 }
@@ -1985,7 +2846,7 @@ void VKCanvas::setBlockTableUpdates(bool block)
     if (m_blockTableUpdates != block) {
         m_blockTableUpdates = block;
         if (!block) {
-            emit vertexInfoUpdated();
+            notifyVertexInfoUpdated();
         }
     }
 }
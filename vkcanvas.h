@@ -2,10 +2,31 @@
 #define VKCANVAS_H
 
 #include <QQuickItem>
+#include <QHash>
+#include <QSet>
 #include <QVector>
 #include <qsgflatcolormaterial.h>
 #include <qsgnode.h>
+#include <QVariantMap>
+#include <atomic>
+#include <memory>
 #include "shape.h"
+#include "scenestore.h"
+#include "scenesnapshot.h"
+#include "inputlog.h"
+#include "profiler.h"
+#include "tracer.h"
+#include "simulationworker.h"
+#include "framearena.h"
+#include "undostack.h"
+#include "scenefile.h"
+#include "svgexport.h"
+#include "sceneimport.h"
+#include "autosavejournal.h"
+#include "rasterizer.h"
+#include "tilecache.h"
+
+class QTimer;
 
 class VKCanvas : public QQuickItem
 {
@@ -21,6 +42,14 @@ class VKCanvas : public QQuickItem
     Q_PROPERTY(int selectedVertexIndex READ selectedVertexIndex WRITE setSelectedVertexIndex NOTIFY selectedVertexIndexChanged)
     Q_PROPERTY(int selectedEdgeIndex READ selectedEdgeIndex WRITE setSelectedEdgeIndex NOTIFY selectedEdgeIndexChanged)
     Q_PROPERTY(int shapeCount READ shapeCount NOTIFY shapeCountChanged)
+    Q_PROPERTY(bool profilerOverlay READ profilerOverlay WRITE setProfilerOverlay NOTIFY profilerOverlayChanged)
+    Q_PROPERTY(QVariantMap profileStats READ profileStats NOTIFY profileStatsChanged)
+    Q_PROPERTY(bool tracing READ isTracing NOTIFY tracingChanged)
+    Q_PROPERTY(bool threadedSimulation READ threadedSimulation WRITE setThreadedSimulation NOTIFY threadedSimulationChanged)
+    Q_PROPERTY(bool autosave READ autosave WRITE setAutosave NOTIFY autosaveChanged)
+    Q_PROPERTY(bool tiledRendering READ tiledRendering WRITE setTiledRendering NOTIFY tiledRenderingChanged)
+    Q_PROPERTY(bool canUndo READ canUndo NOTIFY historyChanged)
+    Q_PROPERTY(bool canRedo READ canRedo NOTIFY historyChanged)
 
 public:
     explicit VKCanvas(QQuickItem *parent = nullptr);
@@ -37,6 +66,14 @@ public:
     int selectedVertexIndex() const { return c_selectedVertexIndex; }
     int selectedEdgeIndex() const { return c_selectedEdgeIndex; }
     int shapeCount() const { return c_shapes.size(); }
+    bool profilerOverlay() const { return c_profilerOverlay; }
+    QVariantMap profileStats() const { return c_profileStatsMap; }
+    bool isTracing() const { return c_tracer != nullptr; }
+    bool threadedSimulation() const { return c_simulation != nullptr; }
+    bool autosave() const { return c_autosave != nullptr; }
+    bool tiledRendering() const { return c_tileCache != nullptr; }
+    bool canUndo() const { return c_undoStack.canUndo(); }
+    bool canRedo() const { return c_undoStack.canRedo(); }
 
     Q_INVOKABLE void centerOnZero();
     Q_INVOKABLE void resetView();
@@ -46,7 +83,19 @@ public:
     void setSelectedShapeId(int id);
     void setSelectedVertexIndex(int index);
     void setSelectedEdgeIndex(int index);
+    void setProfilerOverlay(bool enabled);
+    // Разрешение столкновений в отдельном потоке (см. SimulationWorker).
+    // Без него столкновения считаются синхронно внутри обработчиков ввода.
+    void setThreadedSimulation(bool enabled);
+    // Журнал автосохранения (см. AutosaveJournal) в PAINTSHAPE_AUTOSAVE_DIR
+    // или в каталоге данных приложения. Если там остался журнал
+    // аварийно завершённого сеанса, сцена сначала восстанавливается.
+    void setAutosave(bool enabled);
+    // Неподвижные фигуры рисуются из кэша растровых плиток (см.
+    // TileCache), векторными узлами — только выделенная
+    void setTiledRendering(bool enabled);
     Q_INVOKABLE int addShapeWithSides(float x, float y, int sides, float sizeWidth, float sizeHeight);
+    int addShapes(const QVector<Shape> &shapes);
     Q_INVOKABLE int addTriangle(float x, float y, float sizeWidth, float sizeHeight);
     Q_INVOKABLE int addSquare(float x, float y, float sizeWidth, float sizeHeight);
     Q_INVOKABLE int addPentagon(float x, float y, float sizeWidth, float sizeHeight);
@@ -69,6 +118,8 @@ public:
     Q_INVOKABLE void addVertexToShape(int id, float x, float y);
     Q_INVOKABLE void removeVertexFromShape(int id, int vertexIndex);
     Q_INVOKABLE void resetShapeVertices(int id);
+    // Пакетный сдвиг без разрешения столкновений, одна команда истории
+    Q_INVOKABLE void moveShapes(const QList<int> &ids, float dx, float dy);
     Q_INVOKABLE float getShapeRotation(int id);
     Q_INVOKABLE float getShapeScale(int id);
     Q_INVOKABLE QColor getShapeColor(int id);
@@ -93,6 +144,39 @@ public:
     Q_INVOKABLE QPointF getShapeVertexWorld(int shapeId, int vertexIndex) const;
     Q_INVOKABLE QPointF worldToLocal(int shapeId, const QPointF &worldPos) const;
 
+    // Запись ввода для воспроизведения (см. InputLog). Запись также
+    // включается переменной окружения PAINTSHAPE_RECORD_INPUT=<файл>.
+    Q_INVOKABLE bool startInputRecording(const QString &path);
+    Q_INVOKABLE bool stopInputRecording();
+    bool isRecordingInput() const { return c_inputRecorder != nullptr; }
+    // Трасса для chrome://tracing / Perfetto (см. Tracer). Трассировка
+    // также включается переменной PAINTSHAPE_TRACE=<файл>, тогда трасса
+    // пишется при закрытии холста. Пустой путь — файл с меткой времени
+    // в текущем каталоге.
+    Q_INVOKABLE void startTrace();
+    Q_INVOKABLE bool stopTrace(const QString &path = QString());
+    // История правок (см. UndoStack). Перетаскивание записывается одной
+    // командой; несколько вызовов из QML объединяются beginEdit/endEdit.
+    Q_INVOKABLE void undo();
+    Q_INVOKABLE void redo();
+    Q_INVOKABLE void beginEdit();
+    Q_INVOKABLE void endEdit();
+    // Двоичный файл сцены (см. SceneFile). Принимают путь или file:// URL
+    // из FileDialog. Загрузка заменяет документ и очищает историю.
+    Q_INVOKABLE bool saveScene(const QString &path);
+    Q_INVOKABLE bool loadScene(const QString &path);
+    // Экспорт в SVG (см. SvgExport), путь — как у saveScene
+    Q_INVOKABLE bool exportSvg(const QString &path);
+    // Вся сцена в PNG программным растеризатором (см. Rasterizer);
+    // maxSide — большая сторона изображения в пикселях
+    Q_INVOKABLE bool exportImage(const QString &path, int maxSide = 4096);
+    // Импорт многоугольников из SVG или JSON (см. SceneImport): фигуры
+    // добавляются одной вставкой и одной командой истории.
+    // Возвращает число добавленных фигур.
+    Q_INVOKABLE int importShapes(const QString &path);
+    InputLog::CanvasState saveState() const;
+    void restoreState(const InputLog::CanvasState &state);
+
 signals:
     void draggingChanged();
     void offsetChanged();
@@ -104,6 +188,14 @@ signals:
     void selectedVertexIndexChanged();
     void selectedEdgeIndexChanged();
     void shapeCountChanged();
+    void profilerOverlayChanged();
+    void profileStatsChanged();
+    void tracingChanged();
+    void threadedSimulationChanged();
+    void historyChanged();
+    void autosaveChanged();
+    void tiledRenderingChanged();
+    void sceneRecovered(int shapeCount);
     void shapeAdded(int shapeId);
     void shapeRemoved(int shapeId);
     void shapeUpdated(int shapeId);
@@ -120,30 +212,71 @@ protected:
     void mouseReleaseEvent(QMouseEvent *event) override;
     void wheelEvent(QWheelEvent *event) override;
     void hoverMoveEvent(QHoverEvent *event) override;
+    void updatePolish() override;
     QSGNode *updatePaintNode(QSGNode *node, UpdatePaintNodeData *) override;
 
 private:
     QPointF screenToWorldNoRotation(const QPointF &screenPos) const;
     QPointF worldToScreenNoRotation(const QPointF &worldPos) const;
-    QPolygonF createPolygon(const Shape &shape) const;
     float getShapeRadius(const Shape &shape) const;
     QPointF applyRotation(const QPointF &point, const QPointF &center, float rotation) const;
     QPointF applyInverseRotation(const QPointF &point, const QPointF &center, float rotation) const;
     QPointF findClosestVertex(const Shape &shape, const QPointF &screenPos, int &vertexIndex, float searchRadius) const;
     QPointF findClosestEdge(const Shape &shape, const QPointF &screenPos, int &edgeIndex, float searchRadius) const;
     int findShapeAtPoint(const QPointF &screenPos);
-    bool pointInPolygon(const QPointF& point, const QPolygonF& polygon) const;
     Shape* getShapeById(int id);
     const Shape* getShapeById(int id) const;
+    int shapeIndex(const Shape *shape) const;
+    void syncShape(const Shape *shape);
+    void resolveCollisions(Shape *shape);
     QSGGeometryNode* createShapeNode();
-    QSGGeometryNode* createVertexNode(const QPointF &position, const QColor &color, float size = 8.0);
-    QSGGeometryNode* createEdgeNode(const QPointF &start, const QPointF &end, const QColor &color, float width = 2.0);
-    QSGGeometryNode* createTransformHandle(const QPointF &position, const QColor &color, float size = 10.0);
-    void updateShapeGeometry(QSGGeometryNode *node, const Shape &shape);
-    void updateGridGeometry(QSGGeometry *geometry, QSGFlatColorMaterial *material);
-    void updateAxisXGeometry(QSGGeometry *geometry, QSGFlatColorMaterial *material);
-    void updateAxisYGeometry(QSGGeometry *geometry, QSGFlatColorMaterial *material);
+    QSGGeometryNode* createOutlineNode();
+    void markShapeDirty(int index);
+    void publishSnapshot();
+    int updateChunkNode(QSGNode *chunkNode, const SceneSnapshot::Chunk &chunk, bool tiled, QRectF &bounds,
+                        int &allocated);
+    void updateShapeGeometry(QSGGeometryNode *node, const SceneSnapshot::Entry &entry);
+    void updateOutlineGeometry(QSGGeometryNode *node, const SceneSnapshot::Entry &entry);
+    void updateGridNode(QSGGeometryNode *node);
+    int updateTileNodes(QSGTransformNode *node, const std::shared_ptr<const SceneSnapshot> &snapshot,
+                        const QRectF &viewRect, bool viewChanged, int &allocated);
+    void updateLiveShapes(int level);
+    bool tilesCurrent(const TileCache::Change &change, int level) const;
     void setBlockTableUpdates(bool block);
+    void notifyVertexInfoUpdated();
+    void notifyShapeUpdated(int shapeId);
+    void connectWindowTiming(QQuickWindow *window);
+    void postSimulation(SimulationWorker::Command::Type type, const Shape &shape);
+    void resetSimulation();
+    void applySimulationResults();
+    void collectProfile();
+
+    // Ненулевое значение разрешает сливать подряд идущие правки одного
+    // свойства одной фигуры
+    enum HistoryProperty {
+        NoMerge,
+        HistoryRotation,
+        HistoryScale,
+        HistoryPosition,
+        HistoryColor,
+        HistorySides,
+        HistorySizeWidth,
+        HistorySizeHeight,
+        HistoryName,
+        HistoryCollisions,
+        HistoryVertex,
+        HistoryEdgeLength
+    };
+    void recordTransform(const Shape *shape, const UndoStack::Transform &before, HistoryProperty property = NoMerge);
+    void recordShape(const Shape &before, const Shape *shape, HistoryProperty property = NoMerge);
+    void bindPendingResolve(int id);
+    void journalEcho(const Shape *shape, bool transformOnly);
+    void beginDragEdit();
+    void endDragEdit();
+    void applyHistory(const UndoStack::Command &command, bool undo);
+    int historyIndex(const UndoStack::Delta &delta) const;
+    void updateHistoryState();
+    void replaceShapes(const QVector<Shape> &shapes);
     bool m_dragging = false;
 
     float c_offsetX = 0;
@@ -157,6 +290,42 @@ private:
     int c_selectedEdgeIndex = -1;
     bool c_initialized = false;
     QVector<Shape> c_shapes;
+    SceneStore c_sceneStore;
+    SceneSnapshotBuilder c_snapshotBuilder;
+    // Передаётся в рендер-поток во время синхронизации
+    std::shared_ptr<const SceneSnapshot> c_publishedSnapshot;
+    // Принадлежат рендер-потоку: что уже отражено в узлах
+    std::shared_ptr<const SceneSnapshot> c_renderedSnapshot;
+    float c_renderedScale = 0;
+    QPointF c_renderedOffset;
+    QSizeF c_renderedSize;
+    bool c_renderedTiled = false;
+    // Ключи видимых плиток, буфер переиспользуется между кадрами
+    QVector<TileCache::Key> c_visibleTiles;
+    QHash<TileCache::Key, QSGSimpleTextureNode *> c_tileNodes;
+    quint64 c_tileFrame = 0;
+    // Изменившиеся фигуры, которые рисуются узлами поверх устаревших
+    // плиток: id -> страница. Страницы, где фигура появилась в этом
+    // наборе или ушла из него, перестраиваются.
+    QHash<int, int> c_liveShapes;
+    QSet<int> c_rebuildChunks;
+
+    struct GizmoState
+    {
+        int shapeId = -1;
+        int activeTab = 0;
+        int vertexIndex = -1;
+        int edgeIndex = -1;
+
+        bool operator==(const GizmoState &other) const
+        {
+            return shapeId == other.shapeId && activeTab == other.activeTab
+                   && vertexIndex == other.vertexIndex && edgeIndex == other.edgeIndex;
+        }
+    };
+    GizmoState c_renderedGizmo;
+    // Временные данные updatePaintNode, сбрасывается каждый кадр
+    FrameArena c_frameArena;
     int c_nextShapeId = 0;
     bool m_blockTableUpdates;
 
@@ -189,6 +358,40 @@ private:
     QPointF c_dragShapeStartPos;
     QPointF c_dragVertexStartPos;
     QVector<QPointF> c_dragEdgeVertices;
+
+    std::unique_ptr<InputRecorder> c_inputRecorder;
+
+    bool c_profilerOverlay = false;
+    QTimer *c_profileTimer = nullptr;
+    ProfileStats c_profileStats;
+    QVariantMap c_profileStatsMap;
+    std::atomic<qint64> c_lastFrameSwap { -1 };
+    std::atomic<qint64> c_syncStart { -1 };
+    std::atomic<qint64> c_renderStart { -1 };
+
+    std::unique_ptr<Tracer> c_tracer;
+    QString c_tracePath;
+
+    std::unique_ptr<SimulationWorker> c_simulation;
+    struct PendingResolve
+    {
+        quint32 sequence = 0;
+        // Команда истории с правкой, вызвавшей запрос (lastCommand()
+        // после записи); в неё дописывается результат
+        quint64 command = 0;
+    };
+    // id фигуры -> последний запрос Resolve; более старые результаты
+    // отбрасываются
+    QHash<int, PendingResolve> c_pendingResolves;
+    quint32 c_resolveSequence = 0;
+
+    UndoStack c_undoStack;
+    std::unique_ptr<AutosaveJournal> c_autosave;
+    std::unique_ptr<TileCache> c_tileCache;
+    bool c_dragEditOpen = false;
+    bool c_applyingHistory = false;
+    bool c_canUndo = false;
+    bool c_canRedo = false;
 };
 
 #endif // VKCANVAS_H